@@ -0,0 +1,100 @@
+/*
+ * bandit.h - Online Contextual-Bandit Policy
+ *
+ * A migration_policy_fn that learns while it runs. For each page the
+ * choice is between keeping it and moving it (promote from NVM, demote
+ * from DRAM); the value of moving is a linear function of the features
+ * in page_features.h, one model per direction. Keeping is the zero
+ * baseline.
+ *
+ * Every executed migration is an experiment: BANDIT_REWARD_WINDOW_NS
+ * later its reward is measured from the page's accesses since the
+ * decision and the model takes one normalized-LMS step towards it. A
+ * small exploration budget moves pages the model would keep, so
+ * directions the priors undervalue still get feedback.
+ *
+ * Install with set_migration_policy(bandit_policy), or TM_BANDIT_POLICY=1.
+ * State is global: use one instance, from the policy thread only.
+ *
+ * LDOS Research Project, UT Austin
+ */
+
+#ifndef BANDIT_H
+#define BANDIT_H
+
+#include "page_features.h"
+#include "tiered_memory.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/*============================================================================
+ * CONFIGURATION
+ *===========================================================================*/
+
+#define BANDIT_REWARD_WINDOW_NS 200000000ULL /* 200ms outcome horizon */
+#define BANDIT_MAX_PENDING 4096   /* Migrations awaiting their reward */
+#define BANDIT_RECENT_SLOTS 8192  /* Direct-mapped dedup of pending pages */
+#define BANDIT_EXPLORE_RATE 0.002 /* Per-page chance of a forced move */
+#define BANDIT_MAX_EXPLORE_PER_CYCLE 2
+#define BANDIT_LEARNING_RATE 0.05
+#define BANDIT_PRIOR_GAIN 4.0 /* Slope of the heat_score prior */
+
+/*
+ * Rewards, in log2(1 + accesses in the window) units: a promotion pays
+ * off once the page is used again in DRAM, a demotion once it stays idle.
+ */
+#define BANDIT_PROMOTE_COST 1.0
+#define BANDIT_DEMOTE_GAIN 1.0
+
+/*============================================================================
+ * DATA STRUCTURES
+ *===========================================================================*/
+
+typedef enum {
+  BANDIT_ARM_PROMOTE = 0, /* NVM -> DRAM */
+  BANDIT_ARM_DEMOTE,      /* DRAM -> NVM */
+  BANDIT_ARM_COUNT
+} bandit_arm_t;
+
+typedef struct bandit_arm_stats {
+  uint64_t decisions;    /* Moves proposed (greedy + explored) */
+  uint64_t explorations; /* Of those, against the model's estimate */
+  uint64_t updates;      /* Outcomes learned from */
+  uint64_t unexecuted;   /* Proposed but never carried out */
+  double reward_sum;
+  double abs_error_sum; /* |reward - estimate| before each update */
+} bandit_arm_stats_t;
+
+typedef struct bandit_stats {
+  bandit_arm_stats_t arms[BANDIT_ARM_COUNT];
+  uint64_t dropped; /* Outcomes not tracked (pending ring full) */
+  size_t pending;
+} bandit_stats_t;
+
+/*============================================================================
+ * PUBLIC API
+ *===========================================================================*/
+
+/**
+ * migration_policy_fn that proposes a move when its estimated value is
+ * positive (or when exploring), and learns from the outcomes.
+ */
+bool bandit_policy(const page_stats_t *stats, migration_decision_t *decision);
+
+/**
+ * Forget learned weights and pending outcomes; the models restart from
+ * priors equivalent to the heat_score thresholds in g_policy_config.
+ */
+void bandit_policy_reset(void);
+
+/**
+ * Copy of the learning counters.
+ */
+void bandit_policy_get_stats(bandit_stats_t *out);
+
+/**
+ * Print counters and learned weights (nothing if the policy never ran).
+ */
+void print_bandit_policy_report(void);
+
+#endif /* BANDIT_H */
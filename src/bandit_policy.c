@@ -0,0 +1,312 @@
+/*
+ * bandit_policy.c - Online Contextual-Bandit Policy
+ *
+ * Two linear value models over page_features.h, trained online from the
+ * outcomes of the migrations they propose. See bandit.h.
+ *
+ * Outcomes are tracked in a FIFO of pending moves. An entry is settled
+ * once BANDIT_REWARD_WINDOW_NS has passed: if the page did not actually
+ * move (budget exhausted, tier full, ...) it is discarded, otherwise the
+ * accesses it received since the decision determine the reward.
+ *
+ * LDOS Research Project, UT Austin
+ */
+
+#define _GNU_SOURCE
+#include "bandit.h"
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+/*============================================================================
+ * STATE
+ *===========================================================================*/
+
+#define BANDIT_INPUTS (TM_FEATURE_COUNT + 1) /* Features plus bias */
+
+/* A proposed move whose reward is measured BANDIT_REWARD_WINDOW_NS later */
+typedef struct bandit_pending {
+  const page_stats_t *stats;
+  float x[BANDIT_INPUTS];
+  uint64_t access_count; /* At decision time */
+  uint64_t decided_ns;
+  bandit_arm_t arm;
+} bandit_pending_t;
+
+static const char *const g_arm_names[BANDIT_ARM_COUNT] = {"promote",
+                                                          "demote"};
+
+static const char *const g_input_names[BANDIT_INPUTS] = {
+    [FEAT_HEAT_SCORE] = "heat_score",
+    [FEAT_LOG_ACCESS_RATE] = "log_access_rate",
+    [FEAT_LOG_ACCESS_COUNT] = "log_access_count",
+    [FEAT_WRITE_FRACTION] = "write_fraction",
+    [FEAT_LOG_ACCESS_DELTA] = "log_access_delta",
+    [FEAT_LOG_IDLE_MS] = "log_idle_ms",
+    [FEAT_IN_NVM] = "in_nvm",
+    [FEAT_LOG_MIGRATIONS] = "log_migrations",
+    [FEAT_NET_BENEFIT] = "net_benefit",
+    [TM_FEATURE_COUNT] = "bias"};
+_Static_assert(TM_FEATURE_COUNT == 9, "name new features in g_input_names");
+
+static struct {
+  bool initialized;
+  double weights[BANDIT_ARM_COUNT][BANDIT_INPUTS];
+  bandit_stats_t stats;
+
+  uint64_t rng;
+  uint64_t explore_cycle; /* Cycle the exploration budget belongs to */
+  uint32_t explored_this_cycle;
+
+  bandit_pending_t pending[BANDIT_MAX_PENDING];
+  size_t head, count;
+
+  /* Page -> decision time of its pending entry, so a page proposed every
+   * cycle while it waits for budget is only tracked once per window */
+  struct {
+    const page_stats_t *stats;
+    uint64_t decided_ns;
+  } recent[BANDIT_RECENT_SLOTS];
+} g_bandit;
+
+/*============================================================================
+ * MODEL
+ *===========================================================================*/
+
+/* Priors reproduce the heuristic: move once heat crosses its threshold */
+static void bandit_init(void) {
+  memset(&g_bandit, 0, sizeof(g_bandit));
+
+  g_bandit.weights[BANDIT_ARM_PROMOTE][FEAT_HEAT_SCORE] = BANDIT_PRIOR_GAIN;
+  g_bandit.weights[BANDIT_ARM_PROMOTE][TM_FEATURE_COUNT] =
+      -BANDIT_PRIOR_GAIN * g_policy_config.hot_threshold;
+  g_bandit.weights[BANDIT_ARM_DEMOTE][FEAT_HEAT_SCORE] = -BANDIT_PRIOR_GAIN;
+  g_bandit.weights[BANDIT_ARM_DEMOTE][TM_FEATURE_COUNT] =
+      BANDIT_PRIOR_GAIN * g_policy_config.cold_threshold;
+
+  g_bandit.rng = get_time_ns() | 1;
+  g_bandit.initialized = true;
+}
+
+static double bandit_estimate(bandit_arm_t arm, const float x[BANDIT_INPUTS]) {
+  double value = 0.0;
+  for (int i = 0; i < BANDIT_INPUTS; i++)
+    value += g_bandit.weights[arm][i] * x[i];
+  return value;
+}
+
+/* Normalized LMS: step size independent of the feature vector's scale */
+static void bandit_update(bandit_arm_t arm, const float x[BANDIT_INPUTS],
+                          double reward) {
+  double error = reward - bandit_estimate(arm, x);
+  double norm = 1.0;
+  for (int i = 0; i < BANDIT_INPUTS; i++)
+    norm += (double)x[i] * x[i];
+
+  double step = BANDIT_LEARNING_RATE * error / norm;
+  for (int i = 0; i < BANDIT_INPUTS; i++)
+    g_bandit.weights[arm][i] += step * x[i];
+
+  bandit_arm_stats_t *s = &g_bandit.stats.arms[arm];
+  s->updates++;
+  s->reward_sum += reward;
+  s->abs_error_sum += fabs(error);
+}
+
+static double bandit_reward(bandit_arm_t arm, uint64_t accesses) {
+  double used = fast_log2p1((float)accesses);
+  return arm == BANDIT_ARM_PROMOTE ? used - BANDIT_PROMOTE_COST
+                                   : BANDIT_DEMOTE_GAIN - used;
+}
+
+/* xorshift64*, uniform in [0, 1) */
+static double bandit_random(void) {
+  g_bandit.rng ^= g_bandit.rng >> 12;
+  g_bandit.rng ^= g_bandit.rng << 25;
+  g_bandit.rng ^= g_bandit.rng >> 27;
+  return (double)((g_bandit.rng * 0x2545F4914F6CDD1DULL) >> 11) * 0x1.0p-53;
+}
+
+static bool bandit_should_explore(void) {
+  uint64_t cycle = atomic_load(&g_manager.policy_cycles);
+  if (cycle != g_bandit.explore_cycle) {
+    g_bandit.explore_cycle = cycle;
+    g_bandit.explored_this_cycle = 0;
+  }
+  if (g_bandit.explored_this_cycle >= BANDIT_MAX_EXPLORE_PER_CYCLE ||
+      bandit_random() >= BANDIT_EXPLORE_RATE)
+    return false;
+  g_bandit.explored_this_cycle++;
+  return true;
+}
+
+/*============================================================================
+ * OUTCOME TRACKING
+ *===========================================================================*/
+
+static size_t bandit_recent_slot(const page_stats_t *stats) {
+  return ((uintptr_t)stats->page_addr / PAGE_SIZE) % BANDIT_RECENT_SLOTS;
+}
+
+/* True if `stats` has a pending entry whose window is still open */
+static bool bandit_pending_page(const page_stats_t *stats, uint64_t now) {
+  size_t r = bandit_recent_slot(stats);
+  return g_bandit.recent[r].stats == stats &&
+         g_bandit.recent[r].decided_ns + BANDIT_REWARD_WINDOW_NS > now;
+}
+
+static void bandit_track(const page_stats_t *stats, bandit_arm_t arm,
+                         const float x[BANDIT_INPUTS], uint64_t now) {
+  if (bandit_pending_page(stats, now))
+    return; /* Outcome already being measured */
+
+  if (g_bandit.count == BANDIT_MAX_PENDING) {
+    g_bandit.stats.dropped++;
+    return;
+  }
+  bandit_pending_t *p =
+      &g_bandit.pending[(g_bandit.head + g_bandit.count++) % BANDIT_MAX_PENDING];
+  p->stats = stats;
+  memcpy(p->x, x, sizeof(p->x));
+  p->access_count = atomic_load(&stats->access_count);
+  p->decided_ns = now;
+  p->arm = arm;
+  size_t r = bandit_recent_slot(stats);
+  g_bandit.recent[r].stats = stats;
+  g_bandit.recent[r].decided_ns = now;
+}
+
+/* Learn from every pending move whose reward window has elapsed */
+static void bandit_settle(uint64_t now) {
+  while (g_bandit.count > 0) {
+    bandit_pending_t *p = &g_bandit.pending[g_bandit.head];
+    if (p->decided_ns + BANDIT_REWARD_WINDOW_NS > now)
+      break; /* FIFO: everything after is younger */
+
+    memory_tier_t target =
+        p->arm == BANDIT_ARM_PROMOTE ? TIER_DRAM : TIER_NVM;
+    if (p->stats->current_tier == target &&
+        p->stats->last_migration_ns >= p->decided_ns) {
+      uint64_t now_count = atomic_load(&p->stats->access_count);
+      uint64_t accesses =
+          now_count > p->access_count ? now_count - p->access_count : 0;
+      bandit_update(p->arm, p->x, bandit_reward(p->arm, accesses));
+    } else {
+      g_bandit.stats.arms[p->arm].unexecuted++;
+    }
+
+    g_bandit.head = (g_bandit.head + 1) % BANDIT_MAX_PENDING;
+    g_bandit.count--;
+  }
+}
+
+/*============================================================================
+ * POLICY
+ *===========================================================================*/
+
+bool bandit_policy(const page_stats_t *stats, migration_decision_t *decision) {
+  if (stats == NULL || decision == NULL)
+    return false;
+  if (!g_bandit.initialized)
+    bandit_init();
+
+  uint64_t now = get_time_ns();
+  bandit_settle(now);
+
+  /* Anti-thrashing: don't migrate recently migrated (or bouncing) pages */
+  if (!page_residence_elapsed(stats, now))
+    return false;
+
+  /* Moving a page back before its reward is measured would void it */
+  if (bandit_pending_page(stats, now) &&
+      stats->last_migration_ns >= g_bandit.recent[bandit_recent_slot(stats)]
+                                      .decided_ns)
+    return false;
+
+  bandit_arm_t arm;
+  memory_tier_t target;
+  if (stats->current_tier == TIER_NVM) {
+    arm = BANDIT_ARM_PROMOTE;
+    target = TIER_DRAM;
+  } else if (stats->current_tier == TIER_DRAM) {
+    arm = BANDIT_ARM_DEMOTE;
+    target = TIER_NVM;
+  } else {
+    return false;
+  }
+
+  float x[BANDIT_INPUTS];
+  extract_page_features(stats, now, x);
+  x[TM_FEATURE_COUNT] = 1.0f;
+
+  double value = bandit_estimate(arm, x);
+  bool explore = false;
+  if (value <= 0.0) {
+    if (!bandit_should_explore())
+      return false;
+    explore = true;
+  }
+
+  /* Confidence must clear the gate in predict_migration()'s caller */
+  double confidence = 1.0 / (1.0 + exp(-value));
+  if (confidence < g_policy_config.confidence_min)
+    confidence = g_policy_config.confidence_min;
+
+  decision->page_addr = stats->page_addr;
+  decision->from_tier = stats->current_tier;
+  decision->to_tier = target;
+  decision->confidence = confidence;
+  if (arm == BANDIT_ARM_PROMOTE)
+    decision->reason = explore ? "Bandit exploratory promotion"
+                               : "Bandit promotion";
+  else
+    decision->reason = explore ? "Bandit exploratory demotion"
+                               : "Bandit demotion";
+
+  bandit_arm_stats_t *s = &g_bandit.stats.arms[arm];
+  s->decisions++;
+  if (explore)
+    s->explorations++;
+  bandit_track(stats, arm, x, now);
+  return true;
+}
+
+void bandit_policy_reset(void) {
+  bandit_init();
+  TM_INFO("Bandit policy reset to priors");
+}
+
+void bandit_policy_get_stats(bandit_stats_t *out) {
+  if (out == NULL)
+    return;
+  *out = g_bandit.stats;
+  out->pending = g_bandit.count;
+}
+
+/*============================================================================
+ * REPORTING
+ *===========================================================================*/
+
+void print_bandit_policy_report(void) {
+  if (!g_bandit.initialized)
+    return;
+
+  printf("\nBandit policy:\n");
+  for (int a = 0; a < BANDIT_ARM_COUNT; a++) {
+    const bandit_arm_stats_t *s = &g_bandit.stats.arms[a];
+    double mean_reward = s->updates > 0 ? s->reward_sum / s->updates : 0.0;
+    double mean_error = s->updates > 0 ? s->abs_error_sum / s->updates : 0.0;
+    printf("  %-7s proposed: %" PRIu64 " (%" PRIu64 " explored)"
+           "  learned: %" PRIu64 "  unexecuted: %" PRIu64
+           "  mean reward: %+.3f  mean |error|: %.3f\n",
+           g_arm_names[a], s->decisions, s->explorations, s->updates,
+           s->unexecuted, mean_reward, mean_error);
+    printf("    weights:");
+    for (int i = 0; i < BANDIT_INPUTS; i++)
+      printf(" %s=%+.3f", g_input_names[i], g_bandit.weights[a][i]);
+    printf("\n");
+  }
+  printf("  Pending outcomes: %zu (%" PRIu64 " dropped)\n", g_bandit.count,
+         g_bandit.stats.dropped);
+}
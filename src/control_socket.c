@@ -0,0 +1,706 @@
+/*
+ * control_socket.c - Runtime Control Socket
+ *
+ * Local Unix-domain socket for inspecting and tuning a running manager
+ * without a rebuild or restart. Enabled with TM_CONTROL_SOCKET=<path>.
+ * Text protocol, one command per line; every reply ends with a line
+ * "OK [...]" or "ERR <message>":
+ *
+ *   get [name...]          Print parameters as name=value lines
+ *   set name=value [...]   Update parameters, all or nothing
+ *   stats                  Counters and tier usage
+ *   flush                  Flush the dataset export, print the status report
+ *   scan                   Run a complete policy pass now
+ *   pause | resume         Stop or restart all migrations
+ *   plugin load <path>     Load a policy plugin, active from the next cycle
+ *   plugin unload          Unload it and restore the previous policy
+ *
+ * Parameters are the fields of g_policy_config, tier capacities and
+ * watermarks ("dram.capacity", ...) and the PEBS sampling period. A `set`
+ * is validated as a whole and staged; the policy thread applies it between
+ * two cycles, so no cycle sees half an update. The reply is sent once the
+ * update is applied (or after CONTROL_APPLY_TIMEOUT_MS, as "OK pending").
+ *
+ * Clients are served one at a time from a single thread. tools/tmctl.c
+ * is a command-line client.
+ *
+ * LDOS Research Project, UT Austin
+ */
+
+#define _GNU_SOURCE
+#include "pebs.h"
+#include "tiered_memory.h"
+#include <errno.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+/*============================================================================
+ * CONFIGURATION
+ *===========================================================================*/
+
+#define CONTROL_POLL_MS 200           /* Shutdown check while idle */
+#define CONTROL_CLIENT_TIMEOUT_S 10   /* Idle client is disconnected */
+#define CONTROL_APPLY_TIMEOUT_MS 1000 /* Wait for the policy thread */
+#define CONTROL_LINE_MAX 4096
+
+/* Policy thread hooks (policy_thread.c) */
+extern void policy_thread_request_scan(void);
+extern void policy_thread_flush_dataset(void);
+
+/*============================================================================
+ * PARAMETERS
+ *===========================================================================*/
+
+typedef enum {
+  PARAM_DOUBLE,
+  PARAM_U32,
+  PARAM_U64,
+  PARAM_SIZE, /* _Atomic size_t: tier fields, read without a lock */
+  PARAM_BOOL
+} param_type_t;
+
+typedef enum {
+  SCOPE_POLICY, /* Field of policy_config_t */
+  SCOPE_TIER,   /* Field of tier_config_t */
+  SCOPE_PEBS
+} param_scope_t;
+
+typedef struct control_param {
+  const char *name;
+  param_type_t type;
+  param_scope_t scope;
+  size_t offset;
+  memory_tier_t tier;
+  double min, max; /* Accepted range */
+  bool read_only;  /* Only takes effect at startup */
+} control_param_t;
+
+#define POLICY_PARAM(field, type, min, max)                                    \
+  {#field, type, SCOPE_POLICY, offsetof(policy_config_t, field), TIER_UNKNOWN, \
+   min, max, false}
+#define TIER_PARAM(name, tier, field)                                          \
+  {name, PARAM_SIZE, SCOPE_TIER, offsetof(tier_config_t, field), tier, 0,      \
+   1e18, false}
+
+static const control_param_t g_params[] = {
+    POLICY_PARAM(hot_threshold, PARAM_DOUBLE, 0, 1),
+    POLICY_PARAM(cold_threshold, PARAM_DOUBLE, 0, 1),
+    POLICY_PARAM(confidence_min, PARAM_DOUBLE, 0, 1),
+    POLICY_PARAM(min_residence_ns, PARAM_U64, 0, 60e9),
+    POLICY_PARAM(max_migrations_per_cycle, PARAM_U32, 0, 1 << 20),
+    POLICY_PARAM(max_demotions_per_batch, PARAM_U32, 0, 1 << 20),
+    POLICY_PARAM(demotion_interval_ms, PARAM_U32, 0, 60000),
+    {"stage_threads", PARAM_BOOL, SCOPE_POLICY,
+     offsetof(policy_config_t, stage_threads), TIER_UNKNOWN, 0, 1, true},
+    POLICY_PARAM(swap_when_full, PARAM_BOOL, 0, 1),
+    POLICY_PARAM(swap_margin, PARAM_DOUBLE, 0, 1),
+    POLICY_PARAM(interval_min_ms, PARAM_U32, 1, 10000),
+    POLICY_PARAM(interval_max_ms, PARAM_U32, 1, 10000),
+    POLICY_PARAM(cycle_budget_pct, PARAM_U32, 0, 100),
+    POLICY_PARAM(benefit_horizon_ns, PARAM_U64, 1, 3600e9),
+    POLICY_PARAM(heat_decay_per_s, PARAM_DOUBLE, 0, 100),
+    POLICY_PARAM(phase_boost_factor, PARAM_U32, 1, 64),
+    {"export_incremental", PARAM_BOOL, SCOPE_POLICY,
+     offsetof(policy_config_t, export_incremental), TIER_UNKNOWN, 0, 1, true},
+    POLICY_PARAM(export_heat_epsilon, PARAM_DOUBLE, 0, 1),
+    POLICY_PARAM(export_keyframe_interval, PARAM_U32, 1, 1 << 20),
+    {"export_label_cycles", PARAM_U32, SCOPE_POLICY,
+     offsetof(policy_config_t, export_label_cycles), TIER_UNKNOWN, 0, 1 << 20,
+     true},
+    {"feature_history", PARAM_BOOL, SCOPE_POLICY,
+     offsetof(policy_config_t, feature_history), TIER_UNKNOWN, 0, 1, true},
+    {"uffd_threads", PARAM_U32, SCOPE_POLICY,
+     offsetof(policy_config_t, uffd_threads), TIER_UNKNOWN, 1, 64, true},
+    {"uffd_per_region", PARAM_BOOL, SCOPE_POLICY,
+     offsetof(policy_config_t, uffd_per_region), TIER_UNKNOWN, 0, 1, true},
+    TIER_PARAM("dram.capacity", TIER_DRAM, capacity),
+    TIER_PARAM("dram.watermark_low", TIER_DRAM, watermark_low),
+    TIER_PARAM("dram.watermark_high", TIER_DRAM, watermark_high),
+    TIER_PARAM("nvm.capacity", TIER_NVM, capacity),
+    {"pebs.sample_period", PARAM_U64, SCOPE_PEBS, 0, TIER_UNKNOWN, 1, 1e12,
+     false},
+};
+
+#define CONTROL_PARAM_COUNT (sizeof(g_params) / sizeof(g_params[0]))
+
+/* One complete set of parameter values: live, staged or being parsed */
+typedef struct param_values {
+  policy_config_t policy;
+  tier_config_t tiers[TIER_COUNT];
+  uint64_t pebs_period;
+} param_values_t;
+
+static void *param_field(const control_param_t *p, param_values_t *values) {
+  switch (p->scope) {
+  case SCOPE_POLICY:
+    return (char *)&values->policy + p->offset;
+  case SCOPE_TIER:
+    return (char *)&values->tiers[p->tier] + p->offset;
+  default:
+    return &values->pebs_period;
+  }
+}
+
+static size_t param_size(const control_param_t *p) {
+  switch (p->type) {
+  case PARAM_DOUBLE:
+    return sizeof(double);
+  case PARAM_U32:
+    return sizeof(uint32_t);
+  case PARAM_U64:
+    return sizeof(uint64_t);
+  case PARAM_SIZE:
+    return sizeof(size_t);
+  default:
+    return sizeof(bool);
+  }
+}
+
+static const control_param_t *find_param(const char *name) {
+  for (size_t i = 0; i < CONTROL_PARAM_COUNT; i++)
+    if (strcmp(g_params[i].name, name) == 0)
+      return &g_params[i];
+  return NULL;
+}
+
+/* A tier parameter's live field in g_manager */
+static _Atomic size_t *live_tier_field(const control_param_t *p) {
+  return (_Atomic size_t *)((char *)&g_manager.tiers[p->tier] + p->offset);
+}
+
+static void snapshot_values(param_values_t *values) {
+  values->policy = g_policy_config;
+  for (size_t i = 0; i < CONTROL_PARAM_COUNT; i++) {
+    const control_param_t *p = &g_params[i];
+    if (p->scope == SCOPE_TIER)
+      atomic_store_explicit((_Atomic size_t *)param_field(p, values),
+                            atomic_load(live_tier_field(p)),
+                            memory_order_relaxed);
+  }
+  values->pebs_period = pebs_get_sample_period();
+}
+
+static void format_param(FILE *out, const control_param_t *p,
+                         param_values_t *values) {
+  void *field = param_field(p, values);
+  fprintf(out, "%s=", p->name);
+  switch (p->type) {
+  case PARAM_DOUBLE:
+    fprintf(out, "%g", *(double *)field);
+    break;
+  case PARAM_U32:
+    fprintf(out, "%" PRIu32, *(uint32_t *)field);
+    break;
+  case PARAM_U64:
+    fprintf(out, "%" PRIu64, *(uint64_t *)field);
+    break;
+  case PARAM_SIZE:
+    fprintf(out, "%zu", atomic_load((_Atomic size_t *)field));
+    break;
+  case PARAM_BOOL:
+    fprintf(out, "%d", *(bool *)field ? 1 : 0);
+    break;
+  }
+  fprintf(out, "%s\n", p->read_only ? " (read-only)" : "");
+}
+
+/* Parse `text` into the parameter's field; returns an error or NULL */
+static const char *parse_param(const control_param_t *p, const char *text,
+                               param_values_t *values) {
+  void *field = param_field(p, values);
+  char *end;
+  errno = 0;
+
+  if (p->type == PARAM_BOOL) {
+    if (strcmp(text, "1") == 0 || strcasecmp(text, "true") == 0 ||
+        strcasecmp(text, "on") == 0)
+      *(bool *)field = true;
+    else if (strcmp(text, "0") == 0 || strcasecmp(text, "false") == 0 ||
+             strcasecmp(text, "off") == 0)
+      *(bool *)field = false;
+    else
+      return "expected a boolean";
+    return NULL;
+  }
+
+  if (p->type == PARAM_DOUBLE) {
+    double v = strtod(text, &end);
+    if (end == text || *end != '\0' || errno != 0)
+      return "expected a number";
+    if (v < p->min || v > p->max)
+      return "out of range";
+    *(double *)field = v;
+    return NULL;
+  }
+
+  if (text[0] == '-')
+    return "expected an unsigned integer";
+  unsigned long long v = strtoull(text, &end, 0);
+  if (end == text || *end != '\0' || errno != 0)
+    return "expected an unsigned integer";
+  if ((double)v < p->min || (double)v > p->max)
+    return "out of range";
+  if (p->type == PARAM_U32)
+    *(uint32_t *)field = (uint32_t)v;
+  else if (p->type == PARAM_U64)
+    *(uint64_t *)field = (uint64_t)v;
+  else
+    atomic_store((_Atomic size_t *)field, (size_t)v);
+  return NULL;
+}
+
+/* Constraints between parameters; returns an error or NULL */
+static const char *validate_values(const param_values_t *values) {
+  const policy_config_t *c = &values->policy;
+  if (c->cold_threshold > c->hot_threshold)
+    return "cold_threshold above hot_threshold";
+  if (c->interval_min_ms > c->interval_max_ms)
+    return "interval_min_ms above interval_max_ms";
+  const tier_config_t *dram = &values->tiers[TIER_DRAM];
+  if (dram->watermark_low > dram->watermark_high ||
+      dram->watermark_high > dram->capacity)
+    return "DRAM watermarks must satisfy low <= high <= capacity";
+  return NULL;
+}
+
+/*============================================================================
+ * STAGED UPDATES
+ *===========================================================================*/
+
+static struct {
+  pthread_mutex_t lock;
+  pthread_cond_t applied_cond;
+  _Atomic bool pending;
+  param_values_t staged;
+  bool staged_set[CONTROL_PARAM_COUNT];
+  uint64_t staged_generation;
+  uint64_t applied_generation;
+
+  /* Server */
+  int listen_fd;
+  pthread_t thread;
+  _Atomic bool running;
+  char path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+
+  /* Reporting */
+  uint64_t commands;
+  uint64_t errors;
+  uint64_t updates;
+} g_control = {.lock = PTHREAD_MUTEX_INITIALIZER,
+               .applied_cond = PTHREAD_COND_INITIALIZER,
+               .listen_fd = -1};
+
+/* Apply a staged `set`; called by the policy thread between cycles */
+void control_socket_apply_pending(void) {
+  if (!atomic_load(&g_control.pending))
+    return;
+
+  pthread_mutex_lock(&g_control.lock);
+  bool tiers_changed = false;
+
+  for (size_t i = 0; i < CONTROL_PARAM_COUNT; i++) {
+    if (!g_control.staged_set[i])
+      continue;
+    const control_param_t *p = &g_params[i];
+    void *from = param_field(p, &g_control.staged);
+    switch (p->scope) {
+    case SCOPE_POLICY:
+      memcpy((char *)&g_policy_config + p->offset, from, param_size(p));
+      break;
+    case SCOPE_TIER:
+      /* Read without a lock by tier_reserve_page() and the daemon */
+      atomic_store(live_tier_field(p), atomic_load((_Atomic size_t *)from));
+      tiers_changed = true;
+      break;
+    case SCOPE_PEBS:
+      pebs_set_sample_period(g_control.staged.pebs_period);
+      break;
+    }
+    g_control.staged_set[i] = false;
+  }
+
+  g_control.applied_generation = g_control.staged_generation;
+  atomic_store(&g_control.pending, false);
+  pthread_cond_broadcast(&g_control.applied_cond);
+  pthread_mutex_unlock(&g_control.lock);
+
+  /* A smaller DRAM may now be below its low watermark */
+  if (tiers_changed)
+    wake_demotion_daemon();
+}
+
+/*============================================================================
+ * COMMANDS
+ *===========================================================================*/
+
+static void cmd_get(char **args, int nargs, FILE *out) {
+  param_values_t values;
+  snapshot_values(&values);
+
+  if (nargs == 0) {
+    for (size_t i = 0; i < CONTROL_PARAM_COUNT; i++)
+      format_param(out, &g_params[i], &values);
+    fprintf(out, "OK\n");
+    return;
+  }
+  for (int a = 0; a < nargs; a++) {
+    if (find_param(args[a]) == NULL) {
+      fprintf(out, "ERR unknown parameter %s\n", args[a]);
+      return;
+    }
+  }
+  for (int a = 0; a < nargs; a++)
+    format_param(out, find_param(args[a]), &values);
+  fprintf(out, "OK\n");
+}
+
+static void cmd_set(char **args, int nargs, FILE *out) {
+  if (nargs == 0) {
+    fprintf(out, "ERR usage: set name=value [name=value ...]\n");
+    return;
+  }
+
+  pthread_mutex_lock(&g_control.lock);
+
+  /* Live values with any update still waiting for the policy thread */
+  param_values_t values;
+  snapshot_values(&values);
+  for (size_t i = 0; i < CONTROL_PARAM_COUNT; i++)
+    if (g_control.staged_set[i])
+      memcpy(param_field(&g_params[i], &values),
+             param_field(&g_params[i], &g_control.staged),
+             param_size(&g_params[i]));
+
+  bool set[CONTROL_PARAM_COUNT] = {false};
+  for (int a = 0; a < nargs; a++) {
+    char *value = strchr(args[a], '=');
+    if (value == NULL) {
+      fprintf(out, "ERR expected name=value, got %s\n", args[a]);
+      goto out_unlock;
+    }
+    *value++ = '\0';
+    const control_param_t *p = find_param(args[a]);
+    if (p == NULL) {
+      fprintf(out, "ERR unknown parameter %s\n", args[a]);
+      goto out_unlock;
+    }
+    if (p->read_only) {
+      fprintf(out, "ERR %s is read-only\n", p->name);
+      goto out_unlock;
+    }
+    const char *error = parse_param(p, value, &values);
+    if (error != NULL) {
+      fprintf(out, "ERR %s: %s\n", p->name, error);
+      goto out_unlock;
+    }
+    if (p->scope == SCOPE_PEBS && !pebs_is_active()) {
+      fprintf(out, "ERR %s: PEBS sampling is not active\n", p->name);
+      goto out_unlock;
+    }
+    set[p - g_params] = true;
+  }
+  const char *error = validate_values(&values);
+  if (error != NULL) {
+    fprintf(out, "ERR %s\n", error);
+    goto out_unlock;
+  }
+
+  for (size_t i = 0; i < CONTROL_PARAM_COUNT; i++) {
+    if (!set[i])
+      continue;
+    memcpy(param_field(&g_params[i], &g_control.staged),
+           param_field(&g_params[i], &values), param_size(&g_params[i]));
+    g_control.staged_set[i] = true;
+  }
+  uint64_t generation = ++g_control.staged_generation;
+  g_control.updates++;
+  atomic_store(&g_control.pending, true);
+
+  struct timespec deadline;
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  deadline.tv_sec += CONTROL_APPLY_TIMEOUT_MS / 1000;
+  deadline.tv_nsec += (CONTROL_APPLY_TIMEOUT_MS % 1000) * 1000000L;
+  if (deadline.tv_nsec >= 1000000000L) {
+    deadline.tv_sec++;
+    deadline.tv_nsec -= 1000000000L;
+  }
+  while (g_control.applied_generation < generation &&
+         pthread_cond_timedwait(&g_control.applied_cond, &g_control.lock,
+                                &deadline) != ETIMEDOUT)
+    ;
+  if (g_control.applied_generation >= generation)
+    fprintf(out, "OK applied before cycle %" PRIu64 "\n",
+            (uint64_t)atomic_load(&g_manager.policy_cycles));
+  else
+    fprintf(out, "OK pending\n");
+
+out_unlock:
+  pthread_mutex_unlock(&g_control.lock);
+}
+
+static void cmd_stats(FILE *out) {
+  fprintf(out, "faults=%" PRIu64 "\n",
+          (uint64_t)atomic_load(&g_manager.total_faults));
+  fprintf(out, "migrations=%" PRIu64 "\n",
+          (uint64_t)atomic_load(&g_manager.total_migrations));
+  fprintf(out, "swaps=%" PRIu64 "\n",
+          (uint64_t)atomic_load(&g_manager.total_swaps));
+  fprintf(out, "proactive_demotions=%" PRIu64 "\n",
+          (uint64_t)atomic_load(&g_manager.proactive_demotions));
+  fprintf(out, "oscillations=%" PRIu64 "\n",
+          (uint64_t)atomic_load(&g_manager.total_oscillations));
+  fprintf(out, "cycles=%" PRIu64 "\n",
+          (uint64_t)atomic_load(&g_manager.policy_cycles));
+  fprintf(out, "pages=%" PRIu64 "\n",
+          (uint64_t)atomic_load(&g_manager.total_pages_tracked));
+  fprintf(out, "interval_ns=%" PRIu64 "\n",
+          (uint64_t)atomic_load(&g_manager.policy_interval_ns));
+  fprintf(out, "paused=%d\n",
+          atomic_load(&g_manager.migrations_paused) ? 1 : 0);
+  fprintf(out, "dram.used=%zu\n",
+          atomic_load(&g_manager.tiers[TIER_DRAM].used));
+  fprintf(out, "nvm.used=%zu\n", atomic_load(&g_manager.tiers[TIER_NVM].used));
+  fprintf(out, "pebs.active=%d\n", pebs_is_active() ? 1 : 0);
+  fprintf(out, "OK\n");
+}
+
+static void cmd_help(FILE *out) {
+  fprintf(out, "get [name...]          print parameters\n"
+               "set name=value [...]   update parameters (all or nothing)\n"
+               "stats                  counters and tier usage\n"
+               "flush                  flush the dataset, print status\n"
+               "scan                   run a complete policy pass now\n"
+               "pause | resume         stop or restart migrations\n"
+               "plugin load <path>     hot-swap in a policy plugin\n"
+               "plugin unload          restore the policy before plugins\n"
+               "OK\n");
+}
+
+static void cmd_plugin(char **args, int nargs, FILE *out) {
+  if (nargs == 2 && strcmp(args[0], "load") == 0) {
+    if (load_policy_plugin(args[1]) < 0) {
+      fprintf(out, "ERR cannot load plugin %s (see the manager's log)\n",
+              args[1]);
+      return;
+    }
+    fprintf(out, "OK plugin %s active from the next cycle\n", args[1]);
+  } else if (nargs == 1 && strcmp(args[0], "unload") == 0) {
+    unload_policy_plugin();
+    fprintf(out, "OK plugin unloaded from the next cycle\n");
+  } else {
+    fprintf(out, "ERR usage: plugin load <path> | plugin unload\n");
+  }
+}
+
+/* Run one command line, writing the complete reply to `out` */
+static void handle_command(char *line, FILE *out) {
+  char *args[64];
+  int nargs = 0;
+  char *save = NULL;
+  for (char *tok = strtok_r(line, " \t\r", &save);
+       tok != NULL && nargs < (int)(sizeof(args) / sizeof(args[0]));
+       tok = strtok_r(NULL, " \t\r", &save))
+    args[nargs++] = tok;
+  if (nargs == 0)
+    return;
+
+  g_control.commands++;
+  const char *cmd = args[0];
+  if (strcmp(cmd, "get") == 0) {
+    cmd_get(args + 1, nargs - 1, out);
+  } else if (strcmp(cmd, "set") == 0) {
+    cmd_set(args + 1, nargs - 1, out);
+  } else if (strcmp(cmd, "stats") == 0) {
+    cmd_stats(out);
+  } else if (strcmp(cmd, "flush") == 0) {
+    policy_thread_flush_dataset();
+    tiered_manager_print_status();
+    fflush(stdout);
+    fprintf(out, "OK\n");
+  } else if (strcmp(cmd, "scan") == 0) {
+    policy_thread_request_scan();
+    fprintf(out, "OK scan requested\n");
+  } else if (strcmp(cmd, "pause") == 0) {
+    atomic_store(&g_manager.migrations_paused, true);
+    TM_INFO("Migrations paused from the control socket");
+    fprintf(out, "OK paused\n");
+  } else if (strcmp(cmd, "resume") == 0) {
+    atomic_store(&g_manager.migrations_paused, false);
+    TM_INFO("Migrations resumed from the control socket");
+    fprintf(out, "OK resumed\n");
+  } else if (strcmp(cmd, "plugin") == 0) {
+    cmd_plugin(args + 1, nargs - 1, out);
+  } else if (strcmp(cmd, "help") == 0) {
+    cmd_help(out);
+  } else {
+    fprintf(out, "ERR unknown command %s (try help)\n", cmd);
+  }
+}
+
+/*============================================================================
+ * SERVER
+ *===========================================================================*/
+
+static bool send_all(int fd, const char *buf, size_t len) {
+  while (len > 0) {
+    ssize_t n = send(fd, buf, len, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    buf += n;
+    len -= (size_t)n;
+  }
+  return true;
+}
+
+/* Serve commands from one client until it disconnects or goes idle */
+static void serve_client(int fd) {
+  char line[CONTROL_LINE_MAX];
+  size_t used = 0;
+
+  while (atomic_load(&g_control.running)) {
+    ssize_t n = recv(fd, line + used, sizeof(line) - 1 - used, 0);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return;
+    used += (size_t)n;
+
+    char *start = line;
+    char *newline;
+    while ((newline = memchr(start, '\n', line + used - start)) != NULL) {
+      *newline = '\0';
+      char *reply = NULL;
+      size_t reply_len = 0;
+      FILE *out = open_memstream(&reply, &reply_len);
+      if (out == NULL)
+        return;
+      handle_command(start, out);
+      fclose(out);
+      bool sent = send_all(fd, reply, reply_len);
+      free(reply);
+      if (!sent)
+        return;
+      start = newline + 1;
+    }
+
+    used -= (size_t)(start - line);
+    memmove(line, start, used);
+    if (used == sizeof(line) - 1) {
+      static const char too_long[] = "ERR line too long\n";
+      send_all(fd, too_long, sizeof(too_long) - 1);
+      g_control.errors++;
+      return;
+    }
+  }
+}
+
+static void *control_thread_loop(void *arg) {
+  (void)arg;
+  while (atomic_load(&g_control.running)) {
+    struct pollfd pfd = {.fd = g_control.listen_fd, .events = POLLIN};
+    if (poll(&pfd, 1, CONTROL_POLL_MS) <= 0)
+      continue;
+
+    int fd = accept4(g_control.listen_fd, NULL, NULL, SOCK_CLOEXEC);
+    if (fd < 0) {
+      if (errno != EINTR && errno != EAGAIN)
+        g_control.errors++;
+      continue;
+    }
+    struct timeval timeout = {.tv_sec = CONTROL_CLIENT_TIMEOUT_S};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    serve_client(fd);
+    close(fd);
+  }
+  return NULL;
+}
+
+/*
+ * Owner-only listening socket at `path`, shared with the feature stream.
+ * `what` names the socket in error messages; `flags` is or'ed into the
+ * socket type (SOCK_NONBLOCK, ...). Only a stale socket is replaced. The
+ * node is chmod'ed between bind() and listen(): connections are refused
+ * until listen(), so nobody else can reach it first. The host's umask is
+ * left alone, since this also runs inside applications via the shim.
+ */
+int listen_unix_socket(const char *path, const char *what, int flags) {
+  struct sockaddr_un addr = {.sun_family = AF_UNIX};
+  if (path == NULL || strlen(path) >= sizeof(addr.sun_path)) {
+    TM_ERROR("%s path too long", what);
+    return -1;
+  }
+  strcpy(addr.sun_path, path);
+
+  struct stat st;
+  if (lstat(path, &st) == 0) {
+    if (!S_ISSOCK(st.st_mode)) {
+      TM_ERROR("%s path %s exists and is not a socket", what, path);
+      return -1;
+    }
+    unlink(path);
+  }
+
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | flags, 0);
+  if (fd < 0) {
+    TM_ERROR("%s: %s", what, strerror(errno));
+    return -1;
+  }
+  if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    TM_ERROR("%s %s: %s", what, path, strerror(errno));
+    close(fd);
+    return -1;
+  }
+  if (chmod(path, 0600) < 0 || listen(fd, 4) < 0) {
+    TM_ERROR("%s %s: %s", what, path, strerror(errno));
+    close(fd);
+    unlink(path);
+    return -1;
+  }
+  return fd;
+}
+
+int start_control_socket(const char *path) {
+  int fd = listen_unix_socket(path, "Control socket", 0);
+  if (fd < 0)
+    return -1;
+
+  g_control.listen_fd = fd;
+  strcpy(g_control.path, path);
+  atomic_store(&g_control.running, true);
+  if (pthread_create(&g_control.thread, NULL, control_thread_loop, NULL) !=
+      0) {
+    TM_ERROR("Failed to create control thread: %s", strerror(errno));
+    atomic_store(&g_control.running, false);
+    close(fd);
+    unlink(path);
+    g_control.listen_fd = -1;
+    return -1;
+  }
+  TM_INFO("Control socket listening on %s", path);
+  return 0;
+}
+
+void stop_control_socket(void) {
+  if (!atomic_load(&g_control.running))
+    return;
+  atomic_store(&g_control.running, false);
+  pthread_join(g_control.thread, NULL);
+  close(g_control.listen_fd);
+  unlink(g_control.path);
+  g_control.listen_fd = -1;
+  TM_INFO("Control socket closed (%" PRIu64 " commands, %" PRIu64
+          " updates)",
+          g_control.commands, g_control.updates);
+}
@@ -0,0 +1,67 @@
+/*
+ * cost_model.c - Latency-Aware Migration Cost/Benefit Model
+ *
+ * See cost_model.h for the model.
+ *
+ * LDOS Research Project, UT Austin
+ */
+
+#define _GNU_SOURCE
+#include "cost_model.h"
+#include <string.h>
+
+static bool is_real_tier(memory_tier_t tier) {
+  return tier == TIER_DRAM || tier == TIER_NVM;
+}
+
+double migration_cost_ns(memory_tier_t from, memory_tier_t to) {
+  if (!is_real_tier(from) || !is_real_tier(to) || from == to)
+    return 0.0;
+
+  const tier_config_t *src = &g_manager.tiers[from];
+  const tier_config_t *dst = &g_manager.tiers[to];
+  double lines = PAGE_SIZE / COST_CACHE_LINE;
+  return COST_MIGRATION_FIXED_NS +
+         lines * (double)(src->read_latency_ns + dst->write_latency_ns) /
+             COST_COPY_PARALLELISM;
+}
+
+void estimate_migration_benefit(const page_stats_t *stats,
+                                memory_tier_t to_tier,
+                                migration_benefit_t *out) {
+  memset(out, 0, sizeof(*out));
+  memory_tier_t from = stats->current_tier;
+  if (!is_real_tier(from) || !is_real_tier(to_tier) || from == to_tier)
+    return;
+
+  const tier_config_t *src = &g_manager.tiers[from];
+  const tier_config_t *dst = &g_manager.tiers[to_tier];
+
+  /* Split the access rate by the page's observed read/write mix */
+  uint64_t accesses =
+      atomic_load_explicit(&stats->access_count, memory_order_relaxed);
+  uint64_t writes =
+      atomic_load_explicit(&stats->write_count, memory_order_relaxed);
+  double write_fraction =
+      accesses > 0 ? (double)(writes < accesses ? writes : accesses) / accesses
+                   : 0.0;
+  double write_rate = stats->access_rate * write_fraction;
+  double read_rate = stats->access_rate - write_rate;
+
+  double read_gain =
+      (double)src->read_latency_ns - (double)dst->read_latency_ns;
+  double write_gain =
+      (double)src->write_latency_ns - (double)dst->write_latency_ns;
+  double horizon_s = g_policy_config.benefit_horizon_ns * 1e-9;
+
+  out->savings_ns = horizon_s * (read_rate * read_gain + write_rate * write_gain);
+  out->cost_ns = migration_cost_ns(from, to_tier);
+  out->net_ns = out->savings_ns - out->cost_ns;
+}
+
+double migration_net_benefit_ns(const page_stats_t *stats) {
+  migration_benefit_t benefit;
+  estimate_migration_benefit(
+      stats, stats->current_tier == TIER_NVM ? TIER_DRAM : TIER_NVM, &benefit);
+  return benefit.net_ns;
+}
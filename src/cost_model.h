@@ -0,0 +1,70 @@
+/*
+ * cost_model.h - Latency-Aware Migration Cost/Benefit Model
+ *
+ * Estimates what moving a page to the other tier is worth, in nanoseconds
+ * of memory stall time, from its read/write rates and the tiers' latencies
+ * in tier_config_t:
+ *
+ *   savings = horizon * (read_rate  * (src.read_latency  - dst.read_latency) +
+ *                        write_rate * (src.write_latency - dst.write_latency))
+ *   cost    = COST_MIGRATION_FIXED_NS +
+ *             lines per page * (src.read_latency + dst.write_latency)
+ *                            / COST_COPY_PARALLELISM
+ *   net     = savings - cost
+ *
+ * A write-heavy NVM page therefore gains more from promotion than a
+ * read-mostly one with the same access rate. Demotions have negative
+ * savings; their net benefit ranks how little they hurt.
+ *
+ * Used to rank migration candidates, to veto promotions with net <= 0,
+ * and as model feature FEAT_NET_BENEFIT.
+ *
+ * LDOS Research Project, UT Austin
+ */
+
+#ifndef COST_MODEL_H
+#define COST_MODEL_H
+
+#include "tiered_memory.h"
+
+/*============================================================================
+ * CONFIGURATION
+ *===========================================================================*/
+
+#define COST_MIGRATION_FIXED_NS 2000.0 /* Remap + TLB shootdown */
+#define COST_CACHE_LINE 64
+#define COST_COPY_PARALLELISM 8.0 /* Cache-line copies in flight */
+
+/*============================================================================
+ * DATA STRUCTURES
+ *===========================================================================*/
+
+typedef struct migration_benefit {
+  double savings_ns; /* Access latency saved over benefit_horizon_ns */
+  double cost_ns;    /* One-off cost of copying and remapping the page */
+  double net_ns;     /* savings_ns - cost_ns */
+} migration_benefit_t;
+
+/*============================================================================
+ * PUBLIC API
+ *===========================================================================*/
+
+/**
+ * One-off cost of moving a page between two tiers.
+ */
+double migration_cost_ns(memory_tier_t from, memory_tier_t to);
+
+/**
+ * Expected savings, cost and net benefit of moving `stats` to `to_tier`.
+ * All zero if the page is not in a real tier or is already in `to_tier`.
+ */
+void estimate_migration_benefit(const page_stats_t *stats,
+                                memory_tier_t to_tier,
+                                migration_benefit_t *out);
+
+/**
+ * Net benefit of moving the page to the tier it is not in.
+ */
+double migration_net_benefit_ns(const page_stats_t *stats);
+
+#endif /* COST_MODEL_H */
@@ -0,0 +1,450 @@
+/*
+ * dataset_export.c - Asynchronous Training-Dataset Export
+ *
+ * SPSC ring between the policy thread (producer) and a writer thread
+ * (consumer); see dataset_export.h. Each index lives on its own cache
+ * line and is written by one side only. The producer caches the
+ * consumer's index and rereads it only when the ring looks full. The
+ * consumer publishes its progress every EXPORT_WRITER_BATCH records.
+ *
+ * The file is either the CSV read by qmlp_calibrate_csv() and the
+ * training scripts, one row per accessed page per snapshot, or the TMDS
+ * binary format written by dataset_format.c.
+ *
+ * LDOS Research Project, UT Austin
+ */
+
+#define _GNU_SOURCE
+#include "dataset_export.h"
+#include "dataset_format.h"
+#include "dataset_labels.h"
+#include "feature_stream.h"
+#include <errno.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define EXPORT_RING_MASK (EXPORT_RING_RECORDS - 1)
+#define EXPORT_WRITER_BATCH 256 /* Records between tail updates */
+
+_Static_assert((EXPORT_RING_RECORDS & EXPORT_RING_MASK) == 0,
+               "EXPORT_RING_RECORDS must be a power of two");
+
+/*============================================================================
+ * STATE
+ *===========================================================================*/
+
+static struct {
+  bool active;
+  dataset_format_t format;
+  FILE *file;
+  tmds_writer_t *tmds;
+  label_window_t *labels; /* Rows held back for their labels */
+  pthread_t writer;
+  _Atomic bool writer_running;
+  _Atomic bool flush_requested;
+
+  /* Producer side */
+  _Alignas(64) _Atomic uint64_t head; /* Next slot to fill */
+  uint64_t cached_tail;
+  _Atomic uint64_t produced;
+  _Atomic uint64_t dropped;
+  bool keyframe;        /* Current snapshot emits every page */
+  uint64_t snapshot_ns; /* Stamped on every row of the current snapshot */
+  uint64_t snapshots;
+  uint64_t keyframes;
+  _Atomic uint64_t unchanged;
+
+  /* Consumer side */
+  _Alignas(64) _Atomic uint64_t tail; /* Next slot to write out */
+  _Atomic size_t max_depth;           /* Deepest backlog the writer saw */
+  _Atomic uint64_t written;
+  _Atomic uint64_t bytes;
+  _Atomic uint64_t raw_bytes;
+  _Atomic uint64_t labeled;
+  _Atomic uint64_t label_positive;
+  _Atomic uint64_t label_evicted;
+  _Atomic uint64_t label_held;
+
+  _Alignas(64) dataset_record_t ring[EXPORT_RING_RECORDS];
+} g_export;
+
+/*============================================================================
+ * RING
+ *===========================================================================*/
+
+/* Returns false if the ring is full */
+static bool ring_push(const dataset_record_t *record) {
+  uint64_t head = atomic_load_explicit(&g_export.head, memory_order_relaxed);
+  if (head - g_export.cached_tail == EXPORT_RING_RECORDS) {
+    g_export.cached_tail =
+        atomic_load_explicit(&g_export.tail, memory_order_acquire);
+    if (head - g_export.cached_tail == EXPORT_RING_RECORDS)
+      return false;
+  }
+
+  g_export.ring[head & EXPORT_RING_MASK] = *record;
+  atomic_store_explicit(&g_export.head, head + 1, memory_order_release);
+  return true;
+}
+
+/*============================================================================
+ * PRODUCER (POLICY THREAD)
+ *===========================================================================*/
+
+void dataset_export_begin_snapshot(void) {
+  uint32_t interval = g_policy_config.export_keyframe_interval;
+  g_export.keyframe = !g_policy_config.export_incremental || interval <= 1 ||
+                      g_export.snapshots % interval == 0;
+  g_export.snapshot_ns = get_time_ns();
+  g_export.snapshots++;
+  if (g_export.keyframe)
+    g_export.keyframes++;
+}
+
+/* Incremental mode: nothing worth a row since the page's last one */
+static bool page_unchanged(const page_stats_t *entry, uint64_t access_count) {
+  return entry->exported && access_count == entry->export_access_count &&
+         entry->current_tier == entry->export_tier &&
+         fabs(entry->heat_score - entry->export_heat) <=
+             g_policy_config.export_heat_epsilon;
+}
+
+void dataset_export_range(uint64_t cycle, size_t first_bucket,
+                          size_t end_bucket) {
+  if (!g_export.active)
+    return;
+  if (end_bucket > PAGE_STATS_HASH_SIZE)
+    end_bucket = PAGE_STATS_HASH_SIZE;
+
+  uint64_t produced = 0, dropped = 0, unchanged = 0;
+  bool keyframe = g_export.keyframe;
+  uint16_t flags = keyframe ? DATASET_RECORD_KEYFRAME : 0;
+
+  pthread_rwlock_rdlock(&g_manager.stats_lock);
+  for (size_t i = first_bucket; i < end_bucket; i++) {
+    for (page_stats_t *entry = g_manager.page_stats_table[i]; entry != NULL;
+         entry = entry->next) {
+      uint64_t access_count = atomic_load(&entry->access_count);
+      if (access_count == 0)
+        continue;
+      if (!keyframe && page_unchanged(entry, access_count)) {
+        unchanged++;
+        continue;
+      }
+
+      dataset_record_t record = {
+          .cycle = cycle,
+          .timestamp_ns = g_export.snapshot_ns,
+          .page_addr = (uint64_t)(uintptr_t)entry->page_addr,
+          .heat_score = entry->heat_score,
+          .access_count = access_count,
+          .read_count = atomic_load(&entry->read_count),
+          .write_count = atomic_load(&entry->write_count),
+          .migration_count = entry->migration_count,
+          .current_tier = (uint16_t)entry->current_tier,
+          .flags = flags};
+      if (ring_push(&record)) {
+        /* A dropped row leaves the page changed, so it is retried */
+        entry->export_access_count = access_count;
+        entry->export_heat = entry->heat_score;
+        entry->export_tier = entry->current_tier;
+        entry->exported = true;
+        produced++;
+      } else {
+        dropped++;
+      }
+    }
+  }
+  pthread_rwlock_unlock(&g_manager.stats_lock);
+
+  atomic_fetch_add_explicit(&g_export.produced, produced,
+                            memory_order_relaxed);
+  if (dropped > 0)
+    atomic_fetch_add_explicit(&g_export.dropped, dropped,
+                              memory_order_relaxed);
+  if (unchanged > 0)
+    atomic_fetch_add_explicit(&g_export.unchanged, unchanged,
+                              memory_order_relaxed);
+}
+
+/*============================================================================
+ * CONSUMER (WRITER THREAD)
+ *===========================================================================*/
+
+static void write_csv_record(const dataset_record_t *r,
+                             uint64_t future_accesses) {
+  fprintf(g_export.file,
+          "%" PRIu64 ",%" PRIu64 ",%p,%d,%f,%" PRIu64 ",%" PRIu64 ",%" PRIu64
+          ",%" PRIu32,
+          r->cycle, r->timestamp_ns, (void *)(uintptr_t)r->page_addr,
+          (int)r->current_tier, r->heat_score, r->access_count, r->read_count,
+          r->write_count, r->migration_count);
+  if (g_policy_config.export_incremental)
+    fprintf(g_export.file, ",%d", (r->flags & DATASET_RECORD_KEYFRAME) != 0);
+  if (g_export.labels != NULL)
+    fprintf(g_export.file, ",%" PRIu64, future_accesses);
+  fputc('\n', g_export.file);
+}
+
+/* Also the label window's emit callback */
+static void write_record(const dataset_record_t *r, uint64_t future_accesses) {
+  if (g_export.tmds != NULL)
+    tmds_writer_append(g_export.tmds, r, future_accesses);
+  else
+    write_csv_record(r, future_accesses);
+}
+
+static void publish_file_size(void) {
+  if (g_export.labels != NULL) {
+    label_window_stats_t labels;
+    label_window_get_stats(g_export.labels, &labels);
+    atomic_store_explicit(&g_export.labeled, labels.labeled,
+                          memory_order_relaxed);
+    atomic_store_explicit(&g_export.label_positive, labels.positive,
+                          memory_order_relaxed);
+    atomic_store_explicit(&g_export.label_evicted, labels.evicted,
+                          memory_order_relaxed);
+    atomic_store_explicit(&g_export.label_held, labels.held,
+                          memory_order_relaxed);
+  }
+  if (g_export.tmds == NULL)
+    return;
+  tmds_writer_stats_t stats;
+  tmds_writer_get_stats(g_export.tmds, &stats);
+  atomic_store_explicit(&g_export.bytes, stats.bytes, memory_order_relaxed);
+  atomic_store_explicit(&g_export.raw_bytes, stats.raw_bytes,
+                        memory_order_relaxed);
+}
+
+static void flush_output(void) {
+  if (g_export.tmds != NULL)
+    tmds_writer_flush(g_export.tmds);
+  fflush(g_export.file);
+  publish_file_size();
+}
+
+static void *writer_thread_loop(void *arg) {
+  (void)arg;
+  uint64_t tail = atomic_load_explicit(&g_export.tail, memory_order_relaxed);
+
+  for (;;) {
+    uint64_t head = atomic_load_explicit(&g_export.head, memory_order_acquire);
+
+    /*
+     * Measured here rather than in ring_push(): the producer's cached_tail
+     * is only refreshed when the ring looks full, so it overstates depth.
+     */
+    size_t depth = (size_t)(head - tail);
+    if (depth > atomic_load_explicit(&g_export.max_depth, memory_order_relaxed))
+      atomic_store_explicit(&g_export.max_depth, depth, memory_order_relaxed);
+
+    if (tail == head) {
+      feature_stream_commit(); /* A snapshot ends where the ring drains */
+      if (atomic_exchange(&g_export.flush_requested, false))
+        flush_output();
+      if (!atomic_load(&g_export.writer_running))
+        break; /* Producer has stopped and everything is written */
+      usleep(EXPORT_WRITER_IDLE_US);
+      continue;
+    }
+
+    uint64_t start = tail;
+    while (tail != head) {
+      const dataset_record_t *record = &g_export.ring[tail & EXPORT_RING_MASK];
+      if (g_export.labels != NULL)
+        label_window_push(g_export.labels, record);
+      else
+        write_record(record, 0);
+      feature_stream_append(record); /* Live consumers get it unlabeled */
+      tail++;
+      if ((tail & (EXPORT_WRITER_BATCH - 1)) == 0)
+        atomic_store_explicit(&g_export.tail, tail, memory_order_release);
+    }
+    atomic_store_explicit(&g_export.tail, tail, memory_order_release);
+    atomic_fetch_add_explicit(&g_export.written, tail - start,
+                              memory_order_relaxed);
+    publish_file_size();
+  }
+
+  flush_output();
+  return NULL;
+}
+
+/*============================================================================
+ * LIFECYCLE
+ *===========================================================================*/
+
+static dataset_format_t format_from_env(void) {
+  const char *env = getenv(EXPORT_FORMAT_ENV);
+  if (env == NULL || strcmp(env, "csv") == 0)
+    return DATASET_FORMAT_CSV;
+  if (strcmp(env, "binary") == 0 || strcmp(env, "tmds") == 0)
+    return DATASET_FORMAT_BINARY;
+  if (strcmp(env, "compressed") == 0)
+    return DATASET_FORMAT_COMPRESSED;
+  TM_ERROR("%s=%s: expected csv, binary or compressed; using csv",
+           EXPORT_FORMAT_ENV, env);
+  return DATASET_FORMAT_CSV;
+}
+
+int dataset_export_start(const char *label) {
+  if (g_export.active)
+    return 0;
+
+  g_export.format = format_from_env();
+  const char *incremental = getenv(EXPORT_INCREMENTAL_ENV);
+  if (incremental != NULL && incremental[0] != '\0')
+    g_policy_config.export_incremental = incremental[0] != '0';
+  const char *label_cycles = getenv(LABEL_CYCLES_ENV);
+  if (label_cycles != NULL && label_cycles[0] != '\0')
+    g_policy_config.export_label_cycles =
+        (uint32_t)strtoul(label_cycles, NULL, 10);
+  bool labeled = g_policy_config.export_label_cycles > 0;
+
+  char path[256];
+  snprintf(path, sizeof(path), "ml_dataset_%s.%s", label,
+           g_export.format == DATASET_FORMAT_CSV ? "csv" : "tmds");
+
+  g_export.file = fopen(path, "w");
+  if (g_export.file == NULL) {
+    TM_ERROR("Dataset export %s: %s", path, strerror(errno));
+    return -1;
+  }
+  if (g_export.format != DATASET_FORMAT_CSV) {
+    g_export.tmds = tmds_writer_open(
+        g_export.file, g_export.format == DATASET_FORMAT_COMPRESSED, labeled);
+    if (g_export.tmds == NULL) {
+      TM_ERROR("Dataset export %s: cannot write header", path);
+      fclose(g_export.file);
+      g_export.file = NULL;
+      return -1;
+    }
+  } else {
+    fprintf(g_export.file, "cycle,timestamp_ns,page_addr,current_tier,"
+                           "heat_score,access_count,read_count,write_count,"
+                           "migration_count%s%s\n",
+            g_policy_config.export_incremental ? ",keyframe" : "",
+            labeled ? ",future_accesses" : "");
+  }
+  if (labeled) {
+    g_export.labels =
+        label_window_create(g_policy_config.export_label_cycles, write_record);
+    if (g_export.labels == NULL) {
+      TM_ERROR("Dataset export: no memory for the label window");
+      tmds_writer_close(g_export.tmds);
+      g_export.tmds = NULL;
+      fclose(g_export.file);
+      g_export.file = NULL;
+      return -1;
+    }
+  }
+
+  /* Optional: the dataset file is written either way */
+  const char *stream_path = getenv(FEATURE_STREAM_ENV);
+  if (stream_path != NULL && stream_path[0] != '\0')
+    feature_stream_start(stream_path);
+
+  atomic_store(&g_export.head, 0);
+  atomic_store(&g_export.tail, 0);
+  g_export.cached_tail = 0;
+  atomic_store(&g_export.writer_running, true);
+  if (pthread_create(&g_export.writer, NULL, writer_thread_loop, NULL) != 0) {
+    TM_ERROR("Failed to create dataset writer: %s", strerror(errno));
+    feature_stream_stop();
+    label_window_destroy(g_export.labels);
+    g_export.labels = NULL;
+    tmds_writer_close(g_export.tmds);
+    g_export.tmds = NULL;
+    fclose(g_export.file);
+    g_export.file = NULL;
+    return -1;
+  }
+
+  g_export.active = true;
+  TM_INFO("Dataset output: %s (async writer, %d-record ring%s%s)", path,
+          EXPORT_RING_RECORDS,
+          g_policy_config.export_incremental ? ", incremental" : "",
+          labeled ? ", labeled" : "");
+  return 0;
+}
+
+/* Call after the producer (policy thread) has stopped */
+void dataset_export_stop(void) {
+  if (!g_export.active)
+    return;
+  g_export.active = false;
+  atomic_store(&g_export.writer_running, false);
+  pthread_join(g_export.writer, NULL);
+  feature_stream_stop();
+  label_window_destroy(g_export.labels); /* Unresolved rows are dropped */
+  g_export.labels = NULL;
+  tmds_writer_close(g_export.tmds);
+  g_export.tmds = NULL;
+  fclose(g_export.file);
+  g_export.file = NULL;
+}
+
+bool dataset_export_active(void) { return g_export.active; }
+
+void dataset_export_flush(void) {
+  atomic_store(&g_export.flush_requested, true);
+}
+
+void dataset_export_get_stats(dataset_export_stats_t *out) {
+  if (out == NULL)
+    return;
+  out->produced = atomic_load(&g_export.produced);
+  out->dropped = atomic_load(&g_export.dropped);
+  out->written = atomic_load(&g_export.written);
+  out->max_depth = atomic_load(&g_export.max_depth);
+  out->bytes = atomic_load(&g_export.bytes);
+  out->raw_bytes = atomic_load(&g_export.raw_bytes);
+  out->snapshots = g_export.snapshots;
+  out->keyframes = g_export.keyframes;
+  out->unchanged = atomic_load(&g_export.unchanged);
+  out->labeled = atomic_load(&g_export.labeled);
+  out->label_positive = atomic_load(&g_export.label_positive);
+  out->label_evicted = atomic_load(&g_export.label_evicted);
+  out->label_held = atomic_load(&g_export.label_held);
+}
+
+/*============================================================================
+ * REPORTING
+ *===========================================================================*/
+
+void print_dataset_export_report(void) {
+  dataset_export_stats_t stats;
+  dataset_export_get_stats(&stats);
+  if (stats.produced == 0 && stats.dropped == 0)
+    return;
+
+  printf("Dataset export: %" PRIu64 " records queued, %" PRIu64
+         " written, %" PRIu64 " dropped (ring full)  max depth %zu/%d\n",
+         stats.produced, stats.written, stats.dropped, stats.max_depth,
+         EXPORT_RING_RECORDS);
+  if (g_policy_config.export_incremental && stats.snapshots > 0)
+    printf("  Incremental: %" PRIu64 " snapshots (%" PRIu64
+           " keyframes), %" PRIu64 " unchanged pages skipped (%.1f%%)\n",
+           stats.snapshots, stats.keyframes, stats.unchanged,
+           100.0 * stats.unchanged /
+               (double)(stats.unchanged + stats.produced + stats.dropped));
+  if (g_policy_config.export_label_cycles > 0)
+    printf("  Labels (%" PRIu32 "-cycle horizon): %" PRIu64
+           " rows labeled, %.1f%% accessed again, %zu held, %" PRIu64
+           " evicted (window full)\n",
+           g_policy_config.export_label_cycles, stats.labeled,
+           stats.labeled > 0 ? 100.0 * stats.label_positive / stats.labeled
+                             : 0.0,
+           stats.label_held, stats.label_evicted);
+  if (stats.bytes > 0 && stats.written > 0) {
+    printf("  Binary dataset: %.1f MB, %.1f bytes/record",
+           stats.bytes / 1048576.0, (double)stats.bytes / stats.written);
+    if (stats.raw_bytes > stats.bytes)
+      printf(" (%.1fx compressed)", (double)stats.raw_bytes / stats.bytes);
+    printf("\n");
+  }
+}
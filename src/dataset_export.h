@@ -0,0 +1,146 @@
+/*
+ * dataset_export.h - Asynchronous Training-Dataset Export
+ *
+ * The policy thread snapshots page statistics into fixed-size binary
+ * records and pushes them onto a single-producer/single-consumer ring.
+ * A dedicated writer thread pops them and does all formatting and file
+ * I/O. No lock is shared between the two sides.
+ *
+ * When the ring is full, records are dropped and counted rather than
+ * waited for. A slow disk therefore never holds stats_lock, never stalls
+ * the fault path and never delays policy decisions.
+ *
+ * The writer produces ml_dataset_<label>.csv, or the binary columnar
+ * ml_dataset_<label>.tmds (dataset_format.h) when TM_DATASET_FORMAT=binary.
+ * TM_DATASET_FORMAT=compressed writes the same file in compressed chunks
+ * that can be looked up by cycle.
+ *
+ * With g_policy_config.export_incremental (or TM_DATASET_INCREMENTAL=1) a
+ * snapshot emits only pages whose access count or tier changed, or whose
+ * heat moved by more than export_heat_epsilon, since their last row. Every
+ * export_keyframe_interval-th snapshot is a keyframe and emits every
+ * accessed page. Rows carry DATASET_RECORD_KEYFRAME, so a reader can
+ * rebuild the full table: keyframe rows, then later changes applied.
+ *
+ * With g_policy_config.export_label_cycles > 0 (TM_DATASET_LABEL_CYCLES)
+ * rows are written K cycles late, each with its future_accesses label
+ * (dataset_labels.h).
+ *
+ * LDOS Research Project, UT Austin
+ */
+
+#ifndef DATASET_EXPORT_H
+#define DATASET_EXPORT_H
+
+#include "tiered_memory.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*============================================================================
+ * CONFIGURATION
+ *===========================================================================*/
+
+#define EXPORT_RING_RECORDS 65536    /* Power of two: 4MB of records */
+#define EXPORT_WRITER_IDLE_US 2000   /* Writer poll interval when empty */
+#define EXPORT_FORMAT_ENV "TM_DATASET_FORMAT"
+#define EXPORT_INCREMENTAL_ENV "TM_DATASET_INCREMENTAL"
+
+#define DATASET_RECORD_KEYFRAME 0x1 /* Row belongs to a complete snapshot */
+
+/*============================================================================
+ * DATA STRUCTURES
+ *===========================================================================*/
+
+/* One page's sample, as captured by the policy thread (64 bytes) */
+typedef struct dataset_record {
+  uint64_t cycle;            /* Cycle the snapshot started in */
+  uint64_t timestamp_ns;     /* Time the snapshot started */
+  uint64_t page_addr;
+  double heat_score;
+  uint64_t access_count;
+  uint64_t read_count;
+  uint64_t write_count;
+  uint32_t migration_count;
+  uint16_t current_tier;
+  uint16_t flags;             /* DATASET_RECORD_* */
+} dataset_record_t;
+
+_Static_assert(sizeof(dataset_record_t) == 64, "one record per cache line");
+
+typedef enum {
+  DATASET_FORMAT_CSV = 0,
+  DATASET_FORMAT_BINARY,
+  DATASET_FORMAT_COMPRESSED /* Binary, in LZ4-compressed chunks */
+} dataset_format_t;
+
+typedef struct dataset_export_stats {
+  uint64_t produced; /* Records pushed onto the ring */
+  uint64_t dropped;  /* Records lost because the ring was full */
+  uint64_t written;  /* Records written by the writer thread */
+  size_t max_depth;  /* Deepest backlog the writer found in the ring */
+  uint64_t bytes;    /* File size so far (binary format) */
+  uint64_t raw_bytes; /* Same, before compression */
+  uint64_t snapshots;
+  uint64_t keyframes;
+  uint64_t unchanged; /* Incremental: pages skipped as unchanged */
+  uint64_t labeled;   /* Labeled mode: rows written with their label */
+  uint64_t label_positive;
+  uint64_t label_evicted;
+  size_t label_held;
+} dataset_export_stats_t;
+
+/*============================================================================
+ * PUBLIC API
+ *===========================================================================*/
+
+/**
+ * Create ml_dataset_<label> in the format chosen by TM_DATASET_FORMAT
+ * ("csv", the default, "binary" or "compressed") and start the writer
+ * thread.
+ * Returns 0 on success.
+ */
+int dataset_export_start(const char *label);
+
+/**
+ * Write out everything still queued, stop the writer and close the file.
+ */
+void dataset_export_stop(void);
+
+/**
+ * True between a successful dataset_export_start() and dataset_export_stop().
+ */
+bool dataset_export_active(void);
+
+/**
+ * Start a snapshot; decides whether it is a keyframe and records the
+ * timestamp all of its rows carry. Policy thread only.
+ */
+void dataset_export_begin_snapshot(void);
+
+/**
+ * Queue a record for every accessed page (in incremental mode: every
+ * changed page, unless this is a keyframe) in hash buckets
+ * [first_bucket, end_bucket), stamped with `cycle`: the cycle the
+ * snapshot started in, and with the snapshot's start time. Producer side:
+ * policy thread only.
+ */
+void dataset_export_range(uint64_t cycle, size_t first_bucket,
+                          size_t end_bucket);
+
+/**
+ * Ask the writer to flush the file once the ring is empty.
+ */
+void dataset_export_flush(void);
+
+/**
+ * Copy of the ring and writer counters.
+ */
+void dataset_export_get_stats(dataset_export_stats_t *out);
+
+/**
+ * Print ring and writer counters (nothing if export never started).
+ */
+void print_dataset_export_report(void);
+
+#endif /* DATASET_EXPORT_H */
@@ -0,0 +1,394 @@
+/*
+ * dataset_format.c - Binary Columnar Dataset Writer (TMDS)
+ *
+ * Runs on the dataset export writer thread. Rows are buffered until the
+ * cycle changes, then sorted by address so that page-number deltas stay
+ * small. Each column is then encoded into one payload buffer and written
+ * with a single fwrite. See dataset_format.h for the layout.
+ *
+ * In compressed files the blocks collect in a chunk buffer instead, and
+ * each full chunk is compressed with lz_block_compress() here, on the
+ * writer thread.
+ *
+ * LDOS Research Project, UT Austin
+ */
+
+#define _GNU_SOURCE
+#include "dataset_format.h"
+#include "lz_block.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TMDS_VARINT_MAX 10 /* Bytes for a 64-bit LEB128 value */
+#define TMDS_ALIGN(n) (((n) + 7) & ~(size_t)7)
+
+/* Worst case: every varint at full length, plus alignment padding */
+#define TMDS_PAYLOAD_MAX                                                       \
+  (TMDS_BLOCK_MAX_RECORDS * (6 * TMDS_VARINT_MAX + 1 + 2) +                    \
+   TMDS_COLUMN_COUNT * 8)
+
+/* A chunk is closed once it reaches TMDS_CHUNK_BYTES; one more pending
+ * block (with its region block) may already have been added */
+#define TMDS_CHUNK_MAX                                                         \
+  (TMDS_CHUNK_BYTES + TMDS_PAYLOAD_MAX + 2 * sizeof(tmds_block_header_t) +    \
+   TMDS_MAX_REGIONS * sizeof(tmds_region_t))
+
+static const tmds_column_t g_schema[TMDS_COLUMN_COUNT] = {
+    [TMDS_COL_PAGE] = {"page_addr", TMDS_ENC_DELTA_VARINT, 0},
+    [TMDS_COL_TIER] = {"current_tier", TMDS_ENC_U8, 0},
+    [TMDS_COL_HEAT] = {"heat_score", TMDS_ENC_FIXED16, 0},
+    [TMDS_COL_ACCESS_COUNT] = {"access_count", TMDS_ENC_VARINT, 0},
+    [TMDS_COL_READ_COUNT] = {"read_count", TMDS_ENC_VARINT, 0},
+    [TMDS_COL_WRITE_COUNT] = {"write_count", TMDS_ENC_VARINT, 0},
+    [TMDS_COL_MIGRATION_COUNT] = {"migration_count", TMDS_ENC_VARINT, 0},
+    [TMDS_COL_FUTURE_ACCESSES] = {"future_accesses", TMDS_ENC_VARINT, 0},
+};
+
+/* A pending row and its label */
+typedef struct tmds_row {
+  dataset_record_t record;
+  uint64_t future_accesses;
+} tmds_row_t;
+
+struct tmds_writer {
+  FILE *file;
+  bool failed;
+  bool compress;
+  uint32_t column_count;
+
+  /* Pending block */
+  tmds_row_t *rows;
+  size_t row_count;
+  uint8_t *payload;
+
+  /* Current chunk (compressed files) */
+  uint8_t *chunk;
+  size_t chunk_len;
+  uint8_t *compressed;
+  uint32_t chunk_blocks;
+  uint64_t chunk_first_cycle;
+  uint64_t chunk_last_cycle;
+  tmds_index_entry_t *index;
+  size_t index_len;
+  size_t index_cap;
+
+  /* Last region map written */
+  tmds_region_t regions[TMDS_MAX_REGIONS];
+  uint32_t region_count;
+
+  tmds_writer_stats_t stats;
+};
+
+/*============================================================================
+ * ENCODING
+ *===========================================================================*/
+
+static size_t put_varint(uint8_t *out, uint64_t value) {
+  size_t n = 0;
+  while (value >= 0x80) {
+    out[n++] = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+  out[n++] = (uint8_t)value;
+  return n;
+}
+
+static int compare_page_addr(const void *a, const void *b) {
+  uint64_t x = ((const tmds_row_t *)a)->record.page_addr;
+  uint64_t y = ((const tmds_row_t *)b)->record.page_addr;
+  return (x > y) - (x < y);
+}
+
+static uint16_t encode_heat(double heat) {
+  if (!(heat > 0.0))
+    return 0;
+  if (heat >= 1.0)
+    return TMDS_HEAT_SCALE;
+  return (uint16_t)lround(heat * TMDS_HEAT_SCALE);
+}
+
+/* Encode one column of the pending rows at `out`; returns unpadded bytes */
+static size_t encode_column(const tmds_writer_t *w, int column,
+                            uint8_t *out) {
+  size_t n = 0;
+  uint64_t prev_page = 0;
+
+  for (size_t i = 0; i < w->row_count; i++) {
+    const dataset_record_t *row = &w->rows[i].record;
+    switch (column) {
+    case TMDS_COL_PAGE: {
+      uint64_t page = row->page_addr >> __builtin_ctz(PAGE_SIZE);
+      n += put_varint(out + n, page - prev_page);
+      prev_page = page;
+      break;
+    }
+    case TMDS_COL_TIER:
+      out[n++] = (uint8_t)row->current_tier;
+      break;
+    case TMDS_COL_HEAT: {
+      uint16_t heat = encode_heat(row->heat_score);
+      memcpy(out + n, &heat, sizeof(heat));
+      n += sizeof(heat);
+      break;
+    }
+    case TMDS_COL_ACCESS_COUNT:
+      n += put_varint(out + n, row->access_count);
+      break;
+    case TMDS_COL_READ_COUNT:
+      n += put_varint(out + n, row->read_count);
+      break;
+    case TMDS_COL_WRITE_COUNT:
+      n += put_varint(out + n, row->write_count);
+      break;
+    case TMDS_COL_MIGRATION_COUNT:
+      n += put_varint(out + n, row->migration_count);
+      break;
+    case TMDS_COL_FUTURE_ACCESSES:
+      n += put_varint(out + n, w->rows[i].future_accesses);
+      break;
+    }
+  }
+  return n;
+}
+
+/*============================================================================
+ * OUTPUT
+ *===========================================================================*/
+
+static void write_file(tmds_writer_t *w, const void *data, size_t len) {
+  if (w->failed)
+    return;
+  if (fwrite(data, 1, len, w->file) != len) {
+    w->failed = true;
+    return;
+  }
+  w->stats.bytes += len;
+}
+
+/* Block stream: straight to the file, or into the current chunk */
+static void write_bytes(tmds_writer_t *w, const void *data, size_t len) {
+  w->stats.raw_bytes += len;
+  if (!w->compress) {
+    write_file(w, data, len);
+    return;
+  }
+  memcpy(w->chunk + w->chunk_len, data, len);
+  w->chunk_len += len;
+}
+
+static void write_chunk(tmds_writer_t *w) {
+  if (w->chunk_len == 0)
+    return;
+
+  if (w->index_len == w->index_cap) {
+    size_t cap = w->index_cap ? 2 * w->index_cap : 256;
+    tmds_index_entry_t *index = realloc(w->index, cap * sizeof(*index));
+    if (index == NULL) {
+      w->failed = true;
+      return;
+    }
+    w->index = index;
+    w->index_cap = cap;
+  }
+  w->index[w->index_len++] =
+      (tmds_index_entry_t){.offset = w->stats.bytes,
+                           .first_cycle = w->chunk_first_cycle,
+                           .last_cycle = w->chunk_last_cycle};
+
+  size_t packed = lz_block_compress(w->chunk, w->chunk_len, w->compressed,
+                                    lz_block_bound(TMDS_CHUNK_MAX));
+  const uint8_t *payload = w->compressed;
+  if (packed == 0 || packed >= w->chunk_len) {
+    packed = w->chunk_len; /* Stored */
+    payload = w->chunk;
+  }
+
+  tmds_chunk_header_t header = {.magic = TMDS_CHUNK_MAGIC,
+                                .compressed_bytes = (uint32_t)packed,
+                                .raw_bytes = (uint32_t)w->chunk_len,
+                                .blocks = w->chunk_blocks,
+                                .first_cycle = w->chunk_first_cycle,
+                                .last_cycle = w->chunk_last_cycle};
+  write_file(w, &header, sizeof(header));
+  write_file(w, payload, packed);
+  w->stats.chunks++;
+  w->chunk_len = 0;
+  w->chunk_blocks = 0;
+}
+
+static uint32_t snapshot_regions(tmds_region_t *out) {
+  uint32_t count = 0;
+  pthread_mutex_lock(&g_manager.regions_lock);
+  for (int i = 0; i < MAX_MANAGED_REGIONS; i++) {
+    if (!g_manager.regions[i].active)
+      continue;
+    out[count++] = (tmds_region_t){
+        .base = (uint64_t)(uintptr_t)g_manager.regions[i].base_addr,
+        .length = g_manager.regions[i].length};
+  }
+  pthread_mutex_unlock(&g_manager.regions_lock);
+  return count;
+}
+
+/* Emit a region block if the managed-region set changed */
+static void write_regions_if_changed(tmds_writer_t *w, uint64_t cycle,
+                                     uint64_t timestamp_ns) {
+  tmds_region_t regions[TMDS_MAX_REGIONS];
+  uint32_t count = snapshot_regions(regions);
+  if (count == w->region_count &&
+      memcmp(regions, w->regions, count * sizeof(regions[0])) == 0)
+    return;
+
+  memcpy(w->regions, regions, count * sizeof(regions[0]));
+  w->region_count = count;
+
+  tmds_block_header_t header = {
+      .magic = TMDS_BLOCK_REGIONS,
+      .records = count,
+      .cycle = cycle,
+      .timestamp_ns = timestamp_ns,
+      .block_bytes = (uint32_t)(sizeof(header) + count * sizeof(regions[0]))};
+  write_bytes(w, &header, sizeof(header));
+  write_bytes(w, regions, count * sizeof(regions[0]));
+}
+
+static void write_pending_block(tmds_writer_t *w) {
+  if (w->row_count == 0)
+    return;
+
+  dataset_record_t first = w->rows[0].record;
+  write_regions_if_changed(w, first.cycle, first.timestamp_ns);
+
+  qsort(w->rows, w->row_count, sizeof(w->rows[0]), compare_page_addr);
+
+  tmds_block_header_t header = {.magic = TMDS_BLOCK_SAMPLES,
+                                .records = (uint32_t)w->row_count,
+                                .cycle = first.cycle,
+                                .timestamp_ns = first.timestamp_ns,
+                                .flags = (first.flags &
+                                          DATASET_RECORD_KEYFRAME)
+                                             ? TMDS_BLOCK_KEYFRAME
+                                             : 0};
+  size_t offset = 0;
+  for (uint32_t c = 0; c < w->column_count; c++) {
+    size_t len = encode_column(w, (int)c, w->payload + offset);
+    header.column_bytes[c] = (uint32_t)len;
+    memset(w->payload + offset + len, 0, TMDS_ALIGN(len) - len);
+    offset += TMDS_ALIGN(len);
+  }
+  header.block_bytes = (uint32_t)(sizeof(header) + offset);
+
+  write_bytes(w, &header, sizeof(header));
+  write_bytes(w, w->payload, offset);
+  w->stats.blocks++;
+  w->stats.records += w->row_count;
+  w->row_count = 0;
+
+  if (w->compress) {
+    if (w->chunk_blocks++ == 0)
+      w->chunk_first_cycle = header.cycle;
+    w->chunk_last_cycle = header.cycle;
+    if (w->chunk_len >= TMDS_CHUNK_BYTES)
+      write_chunk(w);
+  }
+}
+
+int tmds_writer_flush(tmds_writer_t *w) {
+  write_pending_block(w);
+  if (w->compress)
+    write_chunk(w);
+  return w->failed ? -1 : 0;
+}
+
+int tmds_writer_append(tmds_writer_t *w, const dataset_record_t *record,
+                       uint64_t future_accesses) {
+  if (w->row_count > 0) {
+    const dataset_record_t *first = &w->rows[0].record;
+    if (record->cycle != first->cycle || record->flags != first->flags ||
+        w->row_count == TMDS_BLOCK_MAX_RECORDS)
+      write_pending_block(w);
+  }
+  w->rows[w->row_count++] =
+      (tmds_row_t){.record = *record, .future_accesses = future_accesses};
+  return w->failed ? -1 : 0;
+}
+
+/*============================================================================
+ * LIFECYCLE
+ *===========================================================================*/
+
+tmds_writer_t *tmds_writer_open(FILE *file, bool compress, bool labeled) {
+  tmds_writer_t *w = calloc(1, sizeof(*w));
+  if (w == NULL)
+    return NULL;
+  w->file = file;
+  w->compress = compress;
+  w->column_count = labeled ? TMDS_COLUMN_COUNT : TMDS_COL_FUTURE_ACCESSES;
+  w->rows = malloc(TMDS_BLOCK_MAX_RECORDS * sizeof(w->rows[0]));
+  w->payload = malloc(TMDS_PAYLOAD_MAX);
+  if (compress) {
+    w->chunk = malloc(TMDS_CHUNK_MAX);
+    w->compressed = malloc(lz_block_bound(TMDS_CHUNK_MAX));
+  }
+  if (w->rows == NULL || w->payload == NULL ||
+      (compress && (w->chunk == NULL || w->compressed == NULL))) {
+    w->failed = true;
+    tmds_writer_close(w);
+    return NULL;
+  }
+
+  w->region_count = snapshot_regions(w->regions);
+  tmds_file_header_t header = {
+      .version = TMDS_VERSION,
+      .header_bytes = (uint32_t)(sizeof(header) +
+                                 w->column_count * sizeof(g_schema[0]) +
+                                 w->region_count * sizeof(tmds_region_t)),
+      .column_count = w->column_count,
+      .region_count = w->region_count,
+      .page_shift = __builtin_ctz(PAGE_SIZE),
+      .heat_scale = TMDS_HEAT_SCALE,
+      .flags = (g_policy_config.export_incremental ? TMDS_FILE_INCREMENTAL
+                                                   : 0) |
+               (compress ? TMDS_FILE_COMPRESSED : 0) |
+               (labeled ? TMDS_FILE_LABELED : 0),
+      .start_time_ns = get_time_ns()};
+  memcpy(header.magic, TMDS_MAGIC, sizeof(header.magic));
+  write_file(w, &header, sizeof(header));
+  write_file(w, g_schema, w->column_count * sizeof(g_schema[0]));
+  write_file(w, w->regions, w->region_count * sizeof(tmds_region_t));
+  w->stats.raw_bytes = w->stats.bytes; /* Never compressed */
+
+  if (w->failed) {
+    tmds_writer_close(w);
+    return NULL;
+  }
+  return w;
+}
+
+void tmds_writer_close(tmds_writer_t *w) {
+  if (w == NULL)
+    return;
+  if (!w->failed) {
+    tmds_writer_flush(w);
+    if (w->compress) {
+      tmds_footer_t footer = {.index_offset = w->stats.bytes,
+                              .chunk_count = (uint32_t)w->index_len,
+                              .magic = TMDS_FOOTER_MAGIC};
+      write_file(w, w->index, w->index_len * sizeof(w->index[0]));
+      write_file(w, &footer, sizeof(footer));
+    }
+  }
+  free(w->rows);
+  free(w->payload);
+  free(w->chunk);
+  free(w->compressed);
+  free(w->index);
+  free(w);
+}
+
+void tmds_writer_get_stats(const tmds_writer_t *w, tmds_writer_stats_t *out) {
+  if (out == NULL)
+    return;
+  *out = w != NULL ? w->stats : (tmds_writer_stats_t){0};
+}
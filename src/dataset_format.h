@@ -0,0 +1,212 @@
+/*
+ * dataset_format.h - Binary Columnar Dataset Format (TMDS)
+ *
+ * Compact alternative to the CSV dataset, written by the dataset export
+ * writer thread when TM_DATASET_FORMAT=binary (or =compressed). It is
+ * designed to be mmap'ed and decoded with numpy (tools/tmds_read.py), with
+ * no per-row parsing.
+ *
+ * File layout (little-endian):
+ *   tmds_file_header_t
+ *   tmds_column_t      columns[column_count]   schema
+ *   tmds_region_t      regions[region_count]   managed regions at start
+ *   blocks, each a tmds_block_header_t followed by its payload
+ *
+ * Blocks:
+ *   TMDS_BLOCK_SAMPLES  rows of one snapshot (same cycle, timestamp and
+ *                       keyframe flag), sorted by page address. The payload
+ *                       has one column per schema entry, in schema order.
+ *                       Each column starts 8-byte aligned and is
+ *                       column_bytes[i] long.
+ *   TMDS_BLOCK_REGIONS  tmds_region_t[records]: the managed-region set
+ *                       changed. It replaces the previous map.
+ *
+ * A labeled file (TMDS_FILE_LABELED) has an eighth column, future_accesses
+ * (dataset_labels.h); otherwise column_count is 7 and column_bytes[7] is 0.
+ * Version 1 files had seven column_bytes slots, so their block flags sit
+ * one slot earlier.
+ *
+ * In an incremental file (TMDS_FILE_INCREMENTAL) a sample block holds only
+ * pages that changed since their previous row, unless it carries
+ * TMDS_BLOCK_KEYFRAME; keyframe blocks list every accessed page.
+ *
+ * Column encodings:
+ *   TMDS_ENC_DELTA_VARINT  page number (address >> page_shift) minus the
+ *                          previous row's (0 before the first row), as an
+ *                          unsigned LEB128 varint
+ *   TMDS_ENC_VARINT        unsigned LEB128 varint
+ *   TMDS_ENC_U8            one byte per row
+ *   TMDS_ENC_FIXED16       uint16 per row; value = raw / heat_scale
+ *
+ * Every block is self-contained, so a reader can start at any block
+ * boundary by following block_bytes from the end of the header.
+ *
+ * Compressed files (TMDS_FILE_COMPRESSED) keep the header, schema and
+ * initial region map as they are. The block stream after them is cut into
+ * chunks of about TMDS_CHUNK_BYTES at block boundaries. Each chunk is
+ * stored as a tmds_chunk_header_t followed by the chunk's blocks in LZ4
+ * block format (lz_block.h); compressed_bytes == raw_bytes means they are
+ * stored as-is. Chunk headers carry their cycle range, so a reader can
+ * seek by cycle by hopping from header to header. When the writer closes
+ * cleanly it also appends an index (one tmds_index_entry_t per chunk) and
+ * a tmds_footer_t, so the chunk table can be read from the end of the
+ * file. A file cut short by a crash is still readable up to its last
+ * complete chunk.
+ *
+ * LDOS Research Project, UT Austin
+ */
+
+#ifndef DATASET_FORMAT_H
+#define DATASET_FORMAT_H
+
+#include "dataset_export.h"
+#include <stdint.h>
+#include <stdio.h>
+
+/*============================================================================
+ * CONFIGURATION
+ *===========================================================================*/
+
+#define TMDS_MAGIC "TMDS"
+#define TMDS_VERSION 2                  /* 2: eight column_bytes slots */
+#define TMDS_BLOCK_SAMPLES 0x4B4C4253u  /* "SBLK" */
+#define TMDS_BLOCK_REGIONS 0x4B4C4752u  /* "RGLK" */
+#define TMDS_BLOCK_MAX_RECORDS 65536    /* Longer cycles span blocks */
+#define TMDS_HEAT_SCALE 65535u
+#define TMDS_FILE_INCREMENTAL 0x1       /* tmds_file_header_t.flags */
+#define TMDS_FILE_COMPRESSED 0x2
+#define TMDS_FILE_LABELED 0x4           /* Has the future_accesses column */
+#define TMDS_BLOCK_KEYFRAME 0x1         /* tmds_block_header_t.flags */
+#define TMDS_MAX_REGIONS MAX_MANAGED_REGIONS
+#define TMDS_CHUNK_MAGIC 0x4B4E4843u    /* "CHNK" */
+#define TMDS_FOOTER_MAGIC 0x58444954u   /* "TIDX" */
+#define TMDS_CHUNK_BYTES (256 * 1024)   /* Raw bytes per compressed chunk */
+
+/*============================================================================
+ * ON-DISK STRUCTURES
+ *===========================================================================*/
+
+typedef enum {
+  TMDS_COL_PAGE = 0,
+  TMDS_COL_TIER,
+  TMDS_COL_HEAT,
+  TMDS_COL_ACCESS_COUNT,
+  TMDS_COL_READ_COUNT,
+  TMDS_COL_WRITE_COUNT,
+  TMDS_COL_MIGRATION_COUNT,
+  TMDS_COL_FUTURE_ACCESSES, /* Labeled files only (dataset_labels.h) */
+  TMDS_COLUMN_COUNT
+} tmds_column_index_t;
+
+typedef enum {
+  TMDS_ENC_DELTA_VARINT = 1,
+  TMDS_ENC_VARINT = 2,
+  TMDS_ENC_U8 = 3,
+  TMDS_ENC_FIXED16 = 4
+} tmds_encoding_t;
+
+typedef struct tmds_file_header {
+  char magic[4];          /* TMDS_MAGIC */
+  uint32_t version;       /* TMDS_VERSION */
+  uint32_t header_bytes;  /* Offset of the first block */
+  uint32_t column_count;
+  uint32_t region_count;
+  uint32_t page_shift;    /* log2(PAGE_SIZE) */
+  uint32_t heat_scale;    /* TMDS_HEAT_SCALE */
+  uint32_t flags;         /* TMDS_FILE_* */
+  uint64_t start_time_ns; /* CLOCK_MONOTONIC when the file was created */
+} tmds_file_header_t;
+
+typedef struct tmds_column {
+  char name[24];          /* CSV column name, NUL-padded */
+  uint32_t encoding;      /* tmds_encoding_t */
+  uint32_t reserved;
+} tmds_column_t;
+
+typedef struct tmds_region {
+  uint64_t base;
+  uint64_t length;
+} tmds_region_t;
+
+typedef struct tmds_block_header {
+  uint32_t magic;         /* TMDS_BLOCK_SAMPLES / TMDS_BLOCK_REGIONS */
+  uint32_t records;       /* Rows, or regions */
+  uint64_t cycle;
+  uint64_t timestamp_ns;
+  uint32_t block_bytes;   /* Header plus payload */
+  uint32_t column_bytes[TMDS_COLUMN_COUNT]; /* Unpadded; samples only */
+  uint32_t flags;         /* TMDS_BLOCK_* */
+} tmds_block_header_t;
+
+typedef struct tmds_chunk_header {
+  uint32_t magic;            /* TMDS_CHUNK_MAGIC */
+  uint32_t compressed_bytes; /* Payload size in the file */
+  uint32_t raw_bytes;        /* Size of the blocks it decompresses to */
+  uint32_t blocks;           /* Sample blocks in the chunk */
+  uint64_t first_cycle;      /* Cycle range of those sample blocks */
+  uint64_t last_cycle;
+} tmds_chunk_header_t;
+
+typedef struct tmds_index_entry {
+  uint64_t offset;           /* File offset of the chunk header */
+  uint64_t first_cycle;
+  uint64_t last_cycle;
+} tmds_index_entry_t;
+
+typedef struct tmds_footer {
+  uint64_t index_offset;     /* File offset of tmds_index_entry_t[] */
+  uint32_t chunk_count;
+  uint32_t magic;            /* TMDS_FOOTER_MAGIC; last bytes of the file */
+} tmds_footer_t;
+
+_Static_assert(sizeof(tmds_file_header_t) == 40, "TMDS file header layout");
+_Static_assert(sizeof(tmds_column_t) == 32, "TMDS column layout");
+_Static_assert(sizeof(tmds_block_header_t) == 64, "TMDS block header layout");
+_Static_assert(sizeof(tmds_chunk_header_t) == 32, "TMDS chunk header layout");
+_Static_assert(sizeof(tmds_footer_t) == 16, "TMDS footer layout");
+
+/*============================================================================
+ * WRITER
+ *===========================================================================*/
+
+typedef struct tmds_writer tmds_writer_t;
+
+typedef struct tmds_writer_stats {
+  uint64_t blocks;        /* Sample blocks written */
+  uint64_t records;
+  uint64_t bytes;         /* Everything written, header included */
+  uint64_t raw_bytes;     /* What `bytes` would be uncompressed */
+  uint64_t chunks;
+} tmds_writer_stats_t;
+
+/**
+ * Write the file header to `file` and return a writer for it, or NULL.
+ * With `compress`, blocks are written in LZ4-compressed chunks. With
+ * `labeled`, the schema gains the future_accesses column. The caller
+ * keeps ownership of `file`.
+ */
+tmds_writer_t *tmds_writer_open(FILE *file, bool compress, bool labeled);
+
+/**
+ * Add a row; `future_accesses` is ignored unless the file is labeled. A
+ * change of cycle or keyframe flag, or a full block, writes out the
+ * pending block first. Returns 0, or -1 on a write error.
+ */
+int tmds_writer_append(tmds_writer_t *writer, const dataset_record_t *record,
+                       uint64_t future_accesses);
+
+/**
+ * Write out the pending block, if any, and close the current chunk.
+ */
+int tmds_writer_flush(tmds_writer_t *writer);
+
+/**
+ * Flush, append the chunk index (compressed files) and free the writer;
+ * the file stays open.
+ */
+void tmds_writer_close(tmds_writer_t *writer);
+
+void tmds_writer_get_stats(const tmds_writer_t *writer,
+                           tmds_writer_stats_t *out);
+
+#endif /* DATASET_FORMAT_H */
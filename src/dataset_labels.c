@@ -0,0 +1,176 @@
+/*
+ * dataset_labels.c - Future-Access Labels for the Training Dataset
+ *
+ * A FIFO of held rows plus an open-addressing map from page to the most
+ * recent access count seen and the number of rows held for that page.
+ * The map has twice as many slots as the FIFO, and an entry is removed
+ * with its last held row, so it never fills. Deletion is by backward
+ * shift, so probes never meet tombstones. Single-threaded: only the
+ * dataset writer thread uses a window.
+ *
+ * LDOS Research Project, UT Austin
+ */
+
+#define _GNU_SOURCE
+#include "dataset_labels.h"
+#include <stdlib.h>
+
+#define LABEL_WINDOW_MASK (LABEL_WINDOW_RECORDS - 1)
+#define LABEL_MAP_SLOTS (2 * LABEL_WINDOW_RECORDS)
+#define LABEL_MAP_MASK (LABEL_MAP_SLOTS - 1)
+
+_Static_assert((LABEL_WINDOW_RECORDS & LABEL_WINDOW_MASK) == 0,
+               "LABEL_WINDOW_RECORDS must be a power of two");
+
+typedef struct label_page {
+  uint64_t page_addr;      /* 0: empty slot */
+  uint64_t access_count;   /* Latest seen */
+  uint32_t held;           /* Rows for this page in the FIFO */
+} label_page_t;
+
+struct label_window {
+  uint32_t horizon;
+  label_emit_fn emit;
+
+  dataset_record_t *rows;  /* FIFO, indexed by absolute position */
+  uint64_t head;
+  uint64_t tail;
+  uint64_t cycle;          /* Cycle of the newest row */
+
+  label_page_t *pages;
+
+  label_window_stats_t stats;
+};
+
+/*============================================================================
+ * PAGE MAP
+ *===========================================================================*/
+
+static size_t page_slot(uint64_t page_addr) {
+  uint64_t h = (page_addr >> 12) * 0x9E3779B97F4A7C15ull;
+  return (size_t)(h >> 32) & LABEL_MAP_MASK;
+}
+
+static label_page_t *page_find(label_window_t *w, uint64_t page_addr) {
+  for (size_t i = page_slot(page_addr);; i = (i + 1) & LABEL_MAP_MASK) {
+    if (w->pages[i].page_addr == page_addr)
+      return &w->pages[i];
+    if (w->pages[i].page_addr == 0)
+      return NULL;
+  }
+}
+
+static label_page_t *page_insert(label_window_t *w, uint64_t page_addr) {
+  size_t i = page_slot(page_addr);
+  while (w->pages[i].page_addr != 0)
+    i = (i + 1) & LABEL_MAP_MASK;
+  w->pages[i] = (label_page_t){.page_addr = page_addr};
+  return &w->pages[i];
+}
+
+/* Remove by shifting later entries of the probe run back into the gap */
+static void page_remove(label_window_t *w, label_page_t *entry) {
+  size_t gap = (size_t)(entry - w->pages);
+  for (size_t i = (gap + 1) & LABEL_MAP_MASK; w->pages[i].page_addr != 0;
+       i = (i + 1) & LABEL_MAP_MASK) {
+    size_t home = page_slot(w->pages[i].page_addr);
+    /* Movable unless its home lies cyclically in (gap, i] */
+    if (((i - home) & LABEL_MAP_MASK) >= ((i - gap) & LABEL_MAP_MASK)) {
+      w->pages[gap] = w->pages[i];
+      gap = i;
+    }
+  }
+  w->pages[gap].page_addr = 0;
+}
+
+/*============================================================================
+ * WINDOW
+ *===========================================================================*/
+
+/* Take the oldest row off the FIFO, emitting it if `label` */
+static void pop_oldest(label_window_t *w, bool label) {
+  const dataset_record_t *row = &w->rows[w->tail & LABEL_WINDOW_MASK];
+  label_page_t *page = page_find(w, row->page_addr);
+
+  if (label) {
+    /* Counters only grow; guard against a page that was untracked */
+    uint64_t future = page->access_count > row->access_count
+                          ? page->access_count - row->access_count
+                          : 0;
+    w->emit(row, future);
+    w->stats.labeled++;
+    if (future > 0)
+      w->stats.positive++;
+  }
+  if (--page->held == 0)
+    page_remove(w, page);
+  w->tail++;
+}
+
+void label_window_push(label_window_t *w, const dataset_record_t *record) {
+  /* The previous cycle's rows are all in: release what it resolves */
+  if (record->cycle != w->cycle) {
+    while (w->tail != w->head) {
+      const dataset_record_t *oldest = &w->rows[w->tail & LABEL_WINDOW_MASK];
+      if (oldest->cycle + w->horizon > w->cycle)
+        break;
+      pop_oldest(w, true);
+    }
+    w->cycle = record->cycle;
+  }
+  if (w->head - w->tail == LABEL_WINDOW_RECORDS) {
+    pop_oldest(w, false);
+    w->stats.evicted++;
+  }
+
+  label_page_t *page = page_find(w, record->page_addr);
+  if (page == NULL)
+    page = page_insert(w, record->page_addr);
+  page->access_count = record->access_count;
+  page->held++;
+
+  w->rows[w->head & LABEL_WINDOW_MASK] = *record;
+  w->head++;
+  if (w->head - w->tail > w->stats.max_depth)
+    w->stats.max_depth = (size_t)(w->head - w->tail);
+}
+
+/*============================================================================
+ * LIFECYCLE
+ *===========================================================================*/
+
+label_window_t *label_window_create(uint32_t horizon_cycles,
+                                    label_emit_fn emit) {
+  label_window_t *w = calloc(1, sizeof(*w));
+  if (w == NULL)
+    return NULL;
+  w->horizon = horizon_cycles;
+  w->emit = emit;
+  w->rows = malloc(LABEL_WINDOW_RECORDS * sizeof(w->rows[0]));
+  w->pages = calloc(LABEL_MAP_SLOTS, sizeof(w->pages[0]));
+  if (w->rows == NULL || w->pages == NULL) {
+    label_window_destroy(w);
+    return NULL;
+  }
+  return w;
+}
+
+void label_window_destroy(label_window_t *w) {
+  if (w == NULL)
+    return;
+  free(w->rows);
+  free(w->pages);
+  free(w);
+}
+
+void label_window_get_stats(const label_window_t *w,
+                            label_window_stats_t *out) {
+  if (out == NULL)
+    return;
+  if (w == NULL) {
+    *out = (label_window_stats_t){0};
+    return;
+  }
+  *out = w->stats;
+  out->held = (size_t)(w->head - w->tail);
+}
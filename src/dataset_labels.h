@@ -0,0 +1,82 @@
+/*
+ * dataset_labels.h - Future-Access Labels for the Training Dataset
+ *
+ * With g_policy_config.export_label_cycles = K (or
+ * TM_DATASET_LABEL_CYCLES=K), the dataset writer holds every row back for
+ * K cycles. It then writes the row with its label, future_accesses: how
+ * many accesses the page received from the row's cycle until the first
+ * snapshot at least K cycles later. Training data comes out ready for
+ * supervised learning, with no offline join across cycles.
+ *
+ * The window is bounded. It holds at most LABEL_WINDOW_RECORDS rows, and
+ * its page map only holds pages that have rows in the window. When the
+ * window is full, its oldest row is dropped and counted. A page missing
+ * from a later snapshot had no new accesses: a full snapshot lists every
+ * accessed page, and an incremental one skips only pages whose access
+ * count did not change. Rows dropped by the export ring under back-pressure
+ * make labels undercount.
+ *
+ * The window relies on each cycle value naming one complete snapshot:
+ * a row from a new cycle means every row of the previous snapshot is in.
+ * The policy thread guarantees this by stamping all rows of a snapshot
+ * with the cycle it started in, even when the CPU budget spreads it over
+ * several cycles.
+ *
+ * Rows still inside their horizon when the writer stops are discarded,
+ * because their labels are unknown.
+ *
+ * LDOS Research Project, UT Austin
+ */
+
+#ifndef DATASET_LABELS_H
+#define DATASET_LABELS_H
+
+#include "dataset_export.h"
+#include <stdint.h>
+
+/*============================================================================
+ * CONFIGURATION
+ *===========================================================================*/
+
+#define LABEL_WINDOW_RECORDS 131072 /* Power of two: 8MB of rows */
+#define LABEL_CYCLES_ENV "TM_DATASET_LABEL_CYCLES"
+
+/*============================================================================
+ * PUBLIC API
+ *===========================================================================*/
+
+typedef struct label_window label_window_t;
+
+/* Receives each row once its label is known */
+typedef void (*label_emit_fn)(const dataset_record_t *record,
+                              uint64_t future_accesses);
+
+typedef struct label_window_stats {
+  uint64_t labeled;
+  uint64_t evicted;      /* Dropped because the window was full */
+  uint64_t positive;     /* Labeled rows with future_accesses > 0 */
+  size_t held;           /* Rows in the window now */
+  size_t max_depth;
+} label_window_stats_t;
+
+/**
+ * Create a window with a horizon of `horizon_cycles`; NULL on failure.
+ */
+label_window_t *label_window_create(uint32_t horizon_cycles,
+                                    label_emit_fn emit);
+
+/**
+ * Add a row. Rows from a later cycle first release every held row whose
+ * horizon has passed, through `emit`. Writer thread only.
+ */
+void label_window_push(label_window_t *w, const dataset_record_t *record);
+
+/**
+ * Free the window, discarding the rows still held.
+ */
+void label_window_destroy(label_window_t *w);
+
+void label_window_get_stats(const label_window_t *w,
+                            label_window_stats_t *out);
+
+#endif /* DATASET_LABELS_H */
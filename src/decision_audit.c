@@ -0,0 +1,386 @@
+/*
+ * decision_audit.c - Migration Decision Audit Stream
+ *
+ * Per-thread SPSC rings (see decision_audit.h). The producer side is
+ * wait-free: a thread-local ring pointer, a slot write and a release
+ * store of head. Rings are claimed from a fixed table with one atomic
+ * increment and are never released. A thread that exits leaves its ring
+ * to be drained. Consumers serialize on drain_lock, which producers never
+ * touch.
+ *
+ * Reason strings are interned into a table once per distinct text, under
+ * reasons_lock. Each thread caches the last pointer it looked up, so the
+ * usual single-reason policy costs one comparison per record.
+ *
+ * LDOS Research Project, UT Austin
+ */
+
+#define _GNU_SOURCE
+#include "decision_audit.h"
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define AUDIT_RING_MASK (AUDIT_RING_RECORDS - 1)
+#define AUDIT_SINK_BATCH 4096
+
+_Static_assert((AUDIT_RING_RECORDS & AUDIT_RING_MASK) == 0,
+               "AUDIT_RING_RECORDS must be a power of two");
+
+/*============================================================================
+ * STATE
+ *===========================================================================*/
+
+typedef struct audit_ring {
+  _Alignas(64) _Atomic uint64_t head; /* Producer */
+  uint32_t sequence;
+  _Atomic uint64_t dropped;
+  _Alignas(64) _Atomic uint64_t tail; /* Consumer (under drain_lock) */
+  audit_record_t slots[AUDIT_RING_RECORDS];
+} audit_ring_t;
+
+static struct {
+  _Atomic bool enabled;
+  audit_ring_t *_Atomic rings[AUDIT_MAX_THREADS];
+  _Atomic uint32_t ring_claims;
+  _Atomic uint64_t unringed; /* Records from threads beyond the table */
+  _Atomic uint64_t recorded;
+  _Atomic uint64_t drained;
+  pthread_mutex_t drain_lock;
+
+  /* Interned reason strings; code 0 is "unknown" */
+  pthread_mutex_t reasons_lock;
+  char *reasons[AUDIT_MAX_REASONS];
+  _Atomic uint32_t reason_count;
+
+  /* File sink */
+  FILE *file;
+  pthread_t sink;
+  _Atomic bool sink_running;
+  uint32_t reasons_written;
+} g_audit = {.drain_lock = PTHREAD_MUTEX_INITIALIZER,
+             .reasons_lock = PTHREAD_MUTEX_INITIALIZER,
+             .reason_count = 1,
+             .reasons_written = 1};
+
+static _Thread_local audit_ring_t *tls_ring;
+static _Thread_local uint8_t tls_ring_index;
+static _Thread_local bool tls_ring_claimed;
+static _Thread_local const char *tls_last_reason;
+static _Thread_local uint16_t tls_last_code;
+
+static const char *const g_outcome_names[] = {
+    [MIGRATION_OK] = "executed",
+    [MIGRATION_ERR_NO_STATS] = "no_stats",
+    [MIGRATION_ERR_TIER_FULL] = "tier_full",
+    [MIGRATION_ERR_STALE] = "stale",
+    [MIGRATION_ERR_BACKOFF] = "backoff",
+    [MIGRATION_ERR_PAUSED] = "paused",
+    [AUDIT_SWAPPED] = "swapped",
+    [AUDIT_DEFERRED] = "deferred",
+    [AUDIT_DROPPED_BUSY] = "dropped_busy",
+    [AUDIT_UNPROFITABLE] = "unprofitable",
+};
+
+/*============================================================================
+ * REASONS
+ *===========================================================================*/
+
+static uint16_t intern_reason(const char *reason) {
+  if (reason == NULL)
+    return 0;
+  /* A plugin can be unloaded and its reason strings' memory reused, so a
+   * pointer hit is confirmed against the interned text */
+  if (reason == tls_last_reason &&
+      strcmp(g_audit.reasons[tls_last_code], reason) == 0)
+    return tls_last_code;
+
+  uint32_t count = atomic_load_explicit(&g_audit.reason_count,
+                                        memory_order_acquire);
+  uint16_t code = 0;
+  for (uint32_t i = 1; i < count; i++) {
+    if (strcmp(g_audit.reasons[i], reason) == 0) {
+      code = (uint16_t)i;
+      break;
+    }
+  }
+
+  if (code == 0) {
+    pthread_mutex_lock(&g_audit.reasons_lock);
+    count = atomic_load(&g_audit.reason_count);
+    for (uint32_t i = 1; i < count && code == 0; i++)
+      if (strcmp(g_audit.reasons[i], reason) == 0)
+        code = (uint16_t)i;
+    if (code == 0 && count < AUDIT_MAX_REASONS) {
+      g_audit.reasons[count] = strdup(reason);
+      if (g_audit.reasons[count] != NULL) {
+        code = (uint16_t)count;
+        atomic_store_explicit(&g_audit.reason_count, count + 1,
+                              memory_order_release);
+      }
+    }
+    pthread_mutex_unlock(&g_audit.reasons_lock);
+  }
+
+  if (code != 0) {
+    tls_last_reason = reason;
+    tls_last_code = code;
+  }
+  return code;
+}
+
+const char *decision_audit_intern_reason(const char *reason) {
+  uint16_t code = intern_reason(reason);
+  return code != 0 ? g_audit.reasons[code] : "unknown";
+}
+
+const char *decision_audit_reason_name(uint16_t code) {
+  if (code == 0)
+    return "unknown";
+  if (code >= atomic_load_explicit(&g_audit.reason_count,
+                                   memory_order_acquire))
+    return NULL;
+  return g_audit.reasons[code];
+}
+
+const char *decision_audit_outcome_name(int outcome) {
+  if (outcome < 0 ||
+      outcome >= (int)(sizeof(g_outcome_names) / sizeof(g_outcome_names[0])) ||
+      g_outcome_names[outcome] == NULL)
+    return "unknown";
+  return g_outcome_names[outcome];
+}
+
+/*============================================================================
+ * PRODUCERS
+ *===========================================================================*/
+
+static audit_ring_t *claim_ring(void) {
+  tls_ring_claimed = true;
+  uint32_t index = atomic_fetch_add(&g_audit.ring_claims, 1);
+  if (index >= AUDIT_MAX_THREADS)
+    return NULL;
+  audit_ring_t *ring = aligned_alloc(64, sizeof(audit_ring_t));
+  if (ring == NULL)
+    return NULL;
+  memset(ring, 0, sizeof(*ring));
+  tls_ring_index = (uint8_t)index;
+  atomic_store_explicit(&g_audit.rings[index], ring, memory_order_release);
+  return ring;
+}
+
+void decision_audit_record(const migration_decision_t *decision,
+                           int outcome) {
+  if (decision == NULL ||
+      !atomic_load_explicit(&g_audit.enabled, memory_order_relaxed))
+    return;
+
+  audit_ring_t *ring = tls_ring;
+  if (ring == NULL) {
+    if (!tls_ring_claimed)
+      ring = tls_ring = claim_ring();
+    if (ring == NULL) {
+      atomic_fetch_add_explicit(&g_audit.unringed, 1, memory_order_relaxed);
+      return;
+    }
+  }
+
+  uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  uint32_t sequence = ring->sequence++;
+  if (head - atomic_load_explicit(&ring->tail, memory_order_acquire) ==
+      AUDIT_RING_RECORDS) {
+    atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+    return;
+  }
+
+  ring->slots[head & AUDIT_RING_MASK] = (audit_record_t){
+      .timestamp_ns = get_time_ns(),
+      .page_addr = (uint64_t)(uintptr_t)decision->page_addr,
+      .confidence = (float)decision->confidence,
+      .reason = intern_reason(decision->reason),
+      .from_tier = (uint8_t)decision->from_tier,
+      .to_tier = (uint8_t)decision->to_tier,
+      .outcome = (uint8_t)outcome,
+      .thread = tls_ring_index,
+      .sequence = sequence};
+  atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+  atomic_fetch_add_explicit(&g_audit.recorded, 1, memory_order_relaxed);
+}
+
+/*============================================================================
+ * CONSUMERS
+ *===========================================================================*/
+
+size_t decision_audit_drain(audit_record_t *out, size_t max) {
+  size_t n = 0;
+  pthread_mutex_lock(&g_audit.drain_lock);
+  uint32_t claimed = atomic_load(&g_audit.ring_claims);
+  if (claimed > AUDIT_MAX_THREADS)
+    claimed = AUDIT_MAX_THREADS;
+
+  for (uint32_t r = 0; r < claimed && n < max; r++) {
+    audit_ring_t *ring =
+        atomic_load_explicit(&g_audit.rings[r], memory_order_acquire);
+    if (ring == NULL)
+      continue;
+    uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    while (tail != head && n < max)
+      out[n++] = ring->slots[tail++ & AUDIT_RING_MASK];
+    atomic_store_explicit(&ring->tail, tail, memory_order_release);
+  }
+  pthread_mutex_unlock(&g_audit.drain_lock);
+
+  atomic_fetch_add_explicit(&g_audit.drained, n, memory_order_relaxed);
+  return n;
+}
+
+/*============================================================================
+ * FILE SINK
+ *===========================================================================*/
+
+/* Names for reason codes interned since the last reasons frame */
+static void write_reasons_frame(void) {
+  uint32_t count = atomic_load_explicit(&g_audit.reason_count,
+                                        memory_order_acquire);
+  if (count <= g_audit.reasons_written)
+    return;
+
+  audit_frame_t frame = {.magic = AUDIT_FRAME_REASONS,
+                         .count = count - g_audit.reasons_written};
+  for (uint32_t i = g_audit.reasons_written; i < count; i++)
+    frame.bytes += 2 * sizeof(uint16_t) + strlen(g_audit.reasons[i]);
+  uint64_t padding = (8 - frame.bytes % 8) % 8;
+  frame.bytes += padding;
+
+  fwrite(&frame, sizeof(frame), 1, g_audit.file);
+  for (uint32_t i = g_audit.reasons_written; i < count; i++) {
+    uint16_t entry[2] = {(uint16_t)i, (uint16_t)strlen(g_audit.reasons[i])};
+    fwrite(entry, sizeof(entry), 1, g_audit.file);
+    fwrite(g_audit.reasons[i], 1, entry[1], g_audit.file);
+  }
+  static const uint8_t zeros[8];
+  fwrite(zeros, 1, padding, g_audit.file);
+  g_audit.reasons_written = count;
+}
+
+/* Returns the number of records written */
+static size_t sink_drain(audit_record_t *batch) {
+  size_t total = 0;
+  size_t n;
+  while ((n = decision_audit_drain(batch, AUDIT_SINK_BATCH)) > 0) {
+    /* Drained records only use codes interned before they were pushed */
+    write_reasons_frame();
+    audit_frame_t frame = {.magic = AUDIT_FRAME_RECORDS,
+                           .count = (uint32_t)n,
+                           .bytes = n * sizeof(audit_record_t)};
+    fwrite(&frame, sizeof(frame), 1, g_audit.file);
+    fwrite(batch, sizeof(audit_record_t), n, g_audit.file);
+    total += n;
+  }
+  return total;
+}
+
+static void *audit_sink_loop(void *arg) {
+  audit_record_t *batch = arg;
+  while (atomic_load(&g_audit.sink_running)) {
+    if (sink_drain(batch) > 0)
+      fflush(g_audit.file);
+    usleep(AUDIT_SINK_INTERVAL_MS * 1000);
+  }
+  sink_drain(batch);
+  fflush(g_audit.file);
+  free(batch);
+  return NULL;
+}
+
+/*============================================================================
+ * LIFECYCLE
+ *===========================================================================*/
+
+int decision_audit_start(const char *path) {
+  if (atomic_load(&g_audit.enabled))
+    return 0;
+
+  if (path != NULL) {
+    audit_record_t *batch = malloc(AUDIT_SINK_BATCH * sizeof(*batch));
+    g_audit.file = fopen(path, "wb");
+    if (batch == NULL || g_audit.file == NULL) {
+      TM_ERROR("Decision audit %s: %s", path, strerror(errno));
+      free(batch);
+      if (g_audit.file != NULL)
+        fclose(g_audit.file);
+      g_audit.file = NULL;
+      return -1;
+    }
+
+    audit_file_header_t header = {.version = AUDIT_VERSION,
+                                  .record_bytes = sizeof(audit_record_t),
+                                  .start_time_ns = get_time_ns()};
+    memcpy(header.magic, AUDIT_MAGIC, sizeof(header.magic));
+    fwrite(&header, sizeof(header), 1, g_audit.file);
+
+    atomic_store(&g_audit.sink_running, true);
+    if (pthread_create(&g_audit.sink, NULL, audit_sink_loop, batch) != 0) {
+      TM_ERROR("Failed to create audit sink thread: %s", strerror(errno));
+      atomic_store(&g_audit.sink_running, false);
+      free(batch);
+      fclose(g_audit.file);
+      g_audit.file = NULL;
+      return -1;
+    }
+  }
+
+  atomic_store(&g_audit.enabled, true);
+  TM_INFO("Decision audit enabled%s%s", path ? ": " : " (drain API)",
+          path ? path : "");
+  return 0;
+}
+
+/* Call after the threads that execute migrations have stopped */
+void decision_audit_stop(void) {
+  if (!atomic_exchange(&g_audit.enabled, false))
+    return;
+  if (g_audit.file == NULL)
+    return;
+  atomic_store(&g_audit.sink_running, false);
+  pthread_join(g_audit.sink, NULL);
+  fclose(g_audit.file);
+  g_audit.file = NULL;
+}
+
+void decision_audit_get_stats(decision_audit_stats_t *out) {
+  if (out == NULL)
+    return;
+  uint32_t claimed = atomic_load(&g_audit.ring_claims);
+  uint64_t dropped = atomic_load(&g_audit.unringed);
+  for (uint32_t r = 0; r < claimed && r < AUDIT_MAX_THREADS; r++) {
+    audit_ring_t *ring = atomic_load(&g_audit.rings[r]);
+    if (ring != NULL)
+      dropped += atomic_load(&ring->dropped);
+  }
+  *out = (decision_audit_stats_t){
+      .recorded = atomic_load(&g_audit.recorded),
+      .dropped = dropped,
+      .drained = atomic_load(&g_audit.drained),
+      .threads = claimed < AUDIT_MAX_THREADS ? claimed : AUDIT_MAX_THREADS,
+      .reasons = atomic_load(&g_audit.reason_count)};
+}
+
+/*============================================================================
+ * REPORTING
+ *===========================================================================*/
+
+void print_decision_audit_report(void) {
+  decision_audit_stats_t stats;
+  decision_audit_get_stats(&stats);
+  if (stats.recorded == 0 && stats.dropped == 0)
+    return;
+  printf("Decision audit: %" PRIu64 " recorded, %" PRIu64 " drained, %" PRIu64
+         " dropped  (%" PRIu32 " threads, %" PRIu32 " reasons)\n",
+         stats.recorded, stats.drained, stats.dropped, stats.threads,
+         stats.reasons > 0 ? stats.reasons - 1 : 0);
+}
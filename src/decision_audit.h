@@ -0,0 +1,158 @@
+/*
+ * decision_audit.h - Migration Decision Audit Stream
+ *
+ * Records the fate of every migration decision that reaches execution.
+ * That covers each execute_migration() result, each half of a swap, and
+ * accepted decisions the stages did not get to: deferred for lack of
+ * budget, dropped while a stage thread was busy, or discarded while
+ * migrations were paused. Offline tools can then rebuild per-page
+ * migration histories and measure policy regret.
+ *
+ * Each producing thread owns a single-producer ring, claimed on its first
+ * record. Recording is a few stores and a release; it never blocks and
+ * never allocates after the claim. A full ring drops the record and counts
+ * it. Records also carry a per-ring sequence number, so drops show up as
+ * gaps.
+ *
+ * Consumers either call decision_audit_drain() themselves or let the file
+ * sink do it. The sink (TM_AUDIT_FILE=path) drains every
+ * AUDIT_SINK_INTERVAL_MS into a framed binary file (layout below;
+ * tools/audit_read.py reads it).
+ *
+ * File layout (little-endian):
+ *   audit_file_header_t
+ *   frames, each an audit_frame_t followed by `bytes` of payload:
+ *     AUDIT_FRAME_REASONS  `count` entries of {uint16 code, uint16 len,
+ *                          char name[len]}, padded to 8 bytes; names for
+ *                          reason codes first used since the last frame
+ *     AUDIT_FRAME_RECORDS  audit_record_t[count]
+ *
+ * LDOS Research Project, UT Austin
+ */
+
+#ifndef DECISION_AUDIT_H
+#define DECISION_AUDIT_H
+
+#include "tiered_memory.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*============================================================================
+ * CONFIGURATION
+ *===========================================================================*/
+
+#define AUDIT_MAX_THREADS 32       /* Producer rings */
+#define AUDIT_RING_RECORDS 8192    /* Per thread; power of two */
+#define AUDIT_MAX_REASONS 256      /* Distinct decision->reason strings */
+#define AUDIT_SINK_INTERVAL_MS 50
+#define AUDIT_FILE_ENV "TM_AUDIT_FILE"
+
+#define AUDIT_MAGIC "TMAU"
+#define AUDIT_VERSION 1
+#define AUDIT_FRAME_RECORDS 0x53434552u /* "RECS" */
+#define AUDIT_FRAME_REASONS 0x534E5352u /* "RSNS" */
+
+/*============================================================================
+ * DATA STRUCTURES
+ *===========================================================================*/
+
+/* Outcomes beyond migration_result_t, which is used as-is for attempts */
+typedef enum {
+  AUDIT_SWAPPED = 16,  /* Executed as one half of a swap */
+  AUDIT_DEFERRED,      /* Accepted, but the stage budget ran out */
+  AUDIT_DROPPED_BUSY,  /* Stage thread still busy with the last batch */
+  AUDIT_UNPROFITABLE   /* Promotion vetoed: estimated net benefit <= 0 */
+} audit_outcome_t;
+
+typedef struct audit_record {
+  uint64_t timestamp_ns;
+  uint64_t page_addr;
+  float confidence;
+  uint16_t reason;     /* decision_audit_reason_name() */
+  uint8_t from_tier;
+  uint8_t to_tier;
+  uint8_t outcome;     /* migration_result_t or audit_outcome_t */
+  uint8_t thread;      /* Producer ring */
+  uint16_t reserved;
+  uint32_t sequence;   /* Per ring; a gap means records were dropped */
+} audit_record_t;
+
+_Static_assert(sizeof(audit_record_t) == 32, "audit record layout");
+
+typedef struct audit_file_header {
+  char magic[4];       /* AUDIT_MAGIC */
+  uint32_t version;
+  uint32_t record_bytes;
+  uint32_t reserved;
+  uint64_t start_time_ns;
+} audit_file_header_t;
+
+typedef struct audit_frame {
+  uint32_t magic;      /* AUDIT_FRAME_* */
+  uint32_t count;
+  uint64_t bytes;      /* Payload that follows */
+} audit_frame_t;
+
+typedef struct decision_audit_stats {
+  uint64_t recorded;
+  uint64_t dropped;    /* Ring full, or no ring left for the thread */
+  uint64_t drained;
+  uint32_t threads;    /* Rings claimed */
+  uint32_t reasons;
+} decision_audit_stats_t;
+
+/*============================================================================
+ * PUBLIC API
+ *===========================================================================*/
+
+/**
+ * Start recording. With a `path`, also start the file sink. Without one,
+ * the caller drains. Returns 0 on success.
+ */
+int decision_audit_start(const char *path);
+
+/**
+ * Stop recording; the sink drains what is left and closes its file.
+ */
+void decision_audit_stop(void);
+
+/**
+ * Record one decision's fate. `outcome` is a migration_result_t or an
+ * audit_outcome_t. A no-op unless recording.
+ */
+void decision_audit_record(const migration_decision_t *decision,
+                           int outcome);
+
+/**
+ * Move up to `max` records into `out`, oldest first within each thread.
+ * Records from different threads interleave in no particular order.
+ */
+size_t decision_audit_drain(audit_record_t *out, size_t max);
+
+/**
+ * Process-lifetime copy of `reason`, for decisions kept after the policy
+ * that made them may have been unloaded. "unknown" for NULL, or once
+ * AUDIT_MAX_REASONS distinct reasons exist. Works whether or not
+ * recording.
+ */
+const char *decision_audit_intern_reason(const char *reason);
+
+/**
+ * Name for a reason code, or NULL if unknown.
+ */
+const char *decision_audit_reason_name(uint16_t code);
+
+/**
+ * Name for an outcome code.
+ */
+const char *decision_audit_outcome_name(int outcome);
+
+void decision_audit_get_stats(decision_audit_stats_t *out);
+
+/**
+ * Print audit counters (nothing if recording never started).
+ */
+void print_decision_audit_report(void);
+
+#endif /* DECISION_AUDIT_H */
@@ -0,0 +1,180 @@
+/*
+ * demotion_daemon.c - Watermark-Driven Proactive Demotion
+ *
+ * kswapd-style background thread that keeps free space in the DRAM tier:
+ *   - Fault handler wakes it when free DRAM drops below watermark_low
+ *   - Daemon demotes the coldest DRAM pages to NVM until free DRAM
+ *     reaches watermark_high
+ *
+ * Keeps headroom so decide_initial_placement() can keep placing first
+ * touches in DRAM while the application grows its working set.
+ *
+ * LDOS Research Project, UT Austin
+ */
+
+#define _GNU_SOURCE
+#include "tiered_memory.h"
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/*============================================================================
+ * CONFIGURATION
+ *===========================================================================*/
+
+#define DEMOTION_BATCH_PAGES 256     /* Victims selected per table scan */
+#define DEMOTION_POLL_INTERVAL_MS 100 /* Periodic check if no wakeup arrives */
+
+static _Atomic bool g_wakeup_pending = false;
+
+/*
+ * Private to the daemon so waking it never contends on migration_lock.
+ * g_daemon_cond uses CLOCK_MONOTONIC, see start_demotion_daemon().
+ */
+static pthread_mutex_t g_daemon_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_daemon_cond;
+
+/*============================================================================
+ * WATERMARK CHECKS
+ *===========================================================================*/
+
+static size_t dram_free_bytes(void) {
+  tier_config_t *dram = &g_manager.tiers[TIER_DRAM];
+  size_t capacity = atomic_load(&dram->capacity);
+  size_t used = atomic_load(&dram->used);
+  return used < capacity ? capacity - used : 0;
+}
+
+static bool below_low_watermark(void) {
+  tier_config_t *dram = &g_manager.tiers[TIER_DRAM];
+  size_t low = atomic_load(&dram->watermark_low);
+  return low > 0 && dram_free_bytes() < low;
+}
+
+/*
+ * Called from the fault path; cheap unless DRAM is below its low watermark.
+ * Signals without g_daemon_lock so a fault never blocks on the daemon: if
+ * the signal lands just before the daemon starts waiting, it still sees
+ * g_wakeup_pending within one poll interval.
+ */
+void wake_demotion_daemon(void) {
+  if (!below_low_watermark())
+    return;
+
+  bool expected = false;
+  if (!atomic_compare_exchange_strong(&g_wakeup_pending, &expected, true))
+    return; /* Already pending */
+
+  pthread_cond_signal(&g_daemon_cond);
+}
+
+/*============================================================================
+ * DEMOTION
+ *===========================================================================*/
+
+/* Demote coldest DRAM pages until free DRAM reaches watermark_high */
+static uint64_t demote_to_high_watermark(void) {
+  tier_config_t *dram = &g_manager.tiers[TIER_DRAM];
+  page_stats_t *victims[DEMOTION_BATCH_PAGES];
+  uint64_t demoted = 0;
+
+  while (g_manager.threads_running && dram_free_bytes() < dram->watermark_high) {
+    size_t deficit_pages =
+        (dram->watermark_high - dram_free_bytes() + PAGE_SIZE - 1) / PAGE_SIZE;
+    size_t batch = deficit_pages < DEMOTION_BATCH_PAGES ? deficit_pages
+                                                        : DEMOTION_BATCH_PAGES;
+
+    size_t found = find_coldest_pages(
+        TIER_DRAM, g_policy_config.min_residence_ns, victims, batch);
+    if (found == 0)
+      break; /* Everything left in DRAM was just migrated */
+
+    uint64_t batch_demoted = 0;
+    for (size_t i = 0; i < found; i++) {
+      migration_decision_t decision = {.page_addr = victims[i]->page_addr,
+                                       .from_tier = TIER_DRAM,
+                                       .to_tier = TIER_NVM,
+                                       .confidence =
+                                           1.0 - victims[i]->heat_score,
+                                       .reason = "Watermark demotion"};
+      if (execute_migration(&decision) == MIGRATION_OK)
+        batch_demoted++;
+    }
+    if (batch_demoted == 0)
+      break; /* NVM full or victims raced away */
+    demoted += batch_demoted;
+  }
+
+  atomic_fetch_add(&g_manager.proactive_demotions, demoted);
+  return demoted;
+}
+
+/*============================================================================
+ * DAEMON THREAD
+ *===========================================================================*/
+
+static void *demotion_daemon_loop(void *arg) {
+  (void)arg;
+  tier_config_t *dram = &g_manager.tiers[TIER_DRAM];
+  TM_INFO("Demotion daemon running (low=%zuMB, high=%zuMB free)",
+          dram->watermark_low >> 20, dram->watermark_high >> 20);
+
+  while (g_manager.threads_running) {
+    pthread_mutex_lock(&g_daemon_lock);
+    if (!atomic_load(&g_wakeup_pending) && g_manager.threads_running) {
+      struct timespec deadline;
+      clock_gettime(CLOCK_MONOTONIC, &deadline);
+      deadline.tv_nsec += DEMOTION_POLL_INTERVAL_MS * 1000000L;
+      if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+      }
+      pthread_cond_timedwait(&g_daemon_cond, &g_daemon_lock, &deadline);
+    }
+    pthread_mutex_unlock(&g_daemon_lock);
+    atomic_store(&g_wakeup_pending, false);
+
+    if (!g_manager.threads_running)
+      break;
+
+    if (below_low_watermark()) {
+      uint64_t demoted = demote_to_high_watermark();
+      TM_DEBUG("Demotion daemon: demoted %" PRIu64 " pages, %zu bytes free",
+               demoted, dram_free_bytes());
+      (void)demoted;
+    }
+  }
+
+  TM_INFO("Demotion daemon exiting");
+  return NULL;
+}
+
+int start_demotion_daemon(void) {
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&g_daemon_cond, &attr);
+  pthread_condattr_destroy(&attr);
+
+  if (pthread_create(&g_manager.demotion_thread, NULL, demotion_daemon_loop,
+                     NULL) != 0) {
+    TM_ERROR("Failed to create demotion daemon: %s", strerror(errno));
+    pthread_cond_destroy(&g_daemon_cond);
+    return -1;
+  }
+  TM_INFO("Demotion daemon started");
+  return 0;
+}
+
+void stop_demotion_daemon(void) {
+  /* Wake the daemon so it observes threads_running == false promptly */
+  pthread_mutex_lock(&g_daemon_lock);
+  pthread_cond_signal(&g_daemon_cond);
+  pthread_mutex_unlock(&g_daemon_lock);
+
+  pthread_join(g_manager.demotion_thread, NULL);
+  pthread_cond_destroy(&g_daemon_cond);
+  TM_INFO("Demotion daemon stopped");
+}
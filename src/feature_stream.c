@@ -0,0 +1,374 @@
+/*
+ * feature_stream.c - Live Feature Stream over Shared Memory
+ *
+ * Producer side of the shared ring (layout and consumer protocol in
+ * feature_stream.h) plus a handshake thread. The handshake thread
+ * accepts consumers on the Unix socket, hands each one a read-only
+ * descriptor for the memfd, and watches the connections so it knows when
+ * consumers detach. The producer checks a single atomic counter to decide
+ * whether to copy records at all.
+ *
+ * LDOS Research Project, UT Austin
+ */
+
+#define _GNU_SOURCE
+#include "feature_stream.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define STREAM_RECORD_MASK (FEATURE_STREAM_RECORDS - 1)
+#define STREAM_BLOCK_MASK (FEATURE_STREAM_BLOCKS - 1)
+
+_Static_assert((FEATURE_STREAM_RECORDS & STREAM_RECORD_MASK) == 0,
+               "FEATURE_STREAM_RECORDS must be a power of two");
+_Static_assert((FEATURE_STREAM_BLOCKS & STREAM_BLOCK_MASK) == 0,
+               "FEATURE_STREAM_BLOCKS must be a power of two");
+
+/*============================================================================
+ * STATE
+ *===========================================================================*/
+
+static struct {
+  bool active;
+
+  /* Shared mapping */
+  int memfd;
+  int reader_fd; /* Read-only reopen of memfd, passed to consumers */
+  size_t map_bytes;
+  feature_stream_header_t *header;
+  feature_stream_block_t *blocks;
+  dataset_record_t *records;
+
+  /* Producer: the block being filled */
+  bool open;
+  uint64_t cycle;
+  uint64_t timestamp_ns;
+  uint64_t first_record;
+  uint32_t count;
+  uint32_t flags;
+  uint64_t blocks_published;
+  uint64_t records_published;
+
+  /* Handshake thread */
+  int listen_fd;
+  int clients[FEATURE_STREAM_MAX_CONSUMERS];
+  _Atomic uint32_t consumers;
+  pthread_t thread;
+  _Atomic bool running;
+  char path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+  uint64_t attaches;
+  uint64_t detaches;
+} g_stream = {.memfd = -1, .reader_fd = -1, .listen_fd = -1};
+
+/*============================================================================
+ * PRODUCER
+ *===========================================================================*/
+
+void feature_stream_commit(void) {
+  if (!g_stream.open)
+    return;
+  g_stream.open = false;
+  if (g_stream.count == 0)
+    return;
+
+  feature_stream_header_t *header = g_stream.header;
+  uint64_t n = atomic_load_explicit(&header->block_head, memory_order_relaxed);
+  feature_stream_block_t *block = &g_stream.blocks[n & STREAM_BLOCK_MASK];
+
+  /* Seqlock on the slot: readers holding the old block see sequence move */
+  atomic_store_explicit(&block->sequence, 0, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  block->cycle = g_stream.cycle;
+  block->timestamp_ns = g_stream.timestamp_ns;
+  block->first_record = g_stream.first_record;
+  block->records = g_stream.count;
+  block->flags = g_stream.flags;
+  atomic_store_explicit(&block->sequence, n + 1, memory_order_release);
+  atomic_store_explicit(&header->block_head, n + 1, memory_order_release);
+
+  g_stream.blocks_published++;
+  g_stream.records_published += g_stream.count;
+}
+
+void feature_stream_append(const dataset_record_t *record) {
+  if (!g_stream.active)
+    return;
+  if (atomic_load_explicit(&g_stream.consumers, memory_order_relaxed) == 0) {
+    feature_stream_commit(); /* Consumers attach at a block boundary */
+    return;
+  }
+
+  feature_stream_header_t *header = g_stream.header;
+  uint64_t head =
+      atomic_load_explicit(&header->record_head, memory_order_relaxed);
+  uint32_t flags = record->flags & FEATURE_BLOCK_KEYFRAME;
+
+  if (g_stream.open && (record->cycle != g_stream.cycle ||
+                        flags != (g_stream.flags & FEATURE_BLOCK_KEYFRAME)))
+    feature_stream_commit();
+  /* Blocks never wrap, so a consumer can view each one as a single slice */
+  if (g_stream.open && (head & STREAM_RECORD_MASK) == 0)
+    feature_stream_commit();
+  if (!g_stream.open) {
+    /* Split at the ring's end, or published while the writer was idle */
+    if (g_stream.blocks_published > 0 && record->cycle == g_stream.cycle)
+      flags |= FEATURE_BLOCK_CONTINUED;
+    g_stream.open = true;
+    g_stream.cycle = record->cycle;
+    g_stream.timestamp_ns = record->timestamp_ns;
+    g_stream.first_record = head;
+    g_stream.count = 0;
+    g_stream.flags = flags;
+  }
+
+  /* Claim the slot before overwriting it; see feature_stream.h */
+  atomic_store_explicit(&header->record_head, head + 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  g_stream.records[head & STREAM_RECORD_MASK] = *record;
+  g_stream.count++;
+}
+
+/*============================================================================
+ * HANDSHAKE THREAD
+ *===========================================================================*/
+
+/* Send the hello message with the read-only descriptor attached */
+static bool send_descriptor(int fd) {
+  feature_stream_hello_t hello = {.version = FEATURE_STREAM_VERSION,
+                                  .map_bytes = g_stream.map_bytes};
+  memcpy(hello.magic, FEATURE_STREAM_MAGIC, sizeof(hello.magic));
+
+  union {
+    char buf[CMSG_SPACE(sizeof(int))];
+    struct cmsghdr align;
+  } control = {0};
+  struct iovec iov = {.iov_base = &hello, .iov_len = sizeof(hello)};
+  struct msghdr msg = {.msg_iov = &iov,
+                       .msg_iovlen = 1,
+                       .msg_control = control.buf,
+                       .msg_controllen = sizeof(control.buf)};
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+  memcpy(CMSG_DATA(cmsg), &g_stream.reader_fd, sizeof(int));
+
+  return sendmsg(fd, &msg, MSG_NOSIGNAL) == (ssize_t)sizeof(hello);
+}
+
+static void accept_consumer(void) {
+  int fd = accept4(g_stream.listen_fd, NULL, NULL, SOCK_CLOEXEC);
+  if (fd < 0)
+    return;
+
+  int slot = -1;
+  for (int i = 0; i < FEATURE_STREAM_MAX_CONSUMERS && slot < 0; i++)
+    if (g_stream.clients[i] < 0)
+      slot = i;
+  if (slot < 0 || !send_descriptor(fd)) {
+    if (slot < 0)
+      TM_INFO("Feature stream: consumer refused (%d attached)",
+              FEATURE_STREAM_MAX_CONSUMERS);
+    close(fd);
+    return;
+  }
+
+  g_stream.clients[slot] = fd;
+  g_stream.attaches++;
+  atomic_fetch_add(&g_stream.consumers, 1);
+  TM_INFO("Feature stream: consumer attached (%u now)",
+          atomic_load(&g_stream.consumers));
+}
+
+static void detach_consumer(int slot) {
+  close(g_stream.clients[slot]);
+  g_stream.clients[slot] = -1;
+  g_stream.detaches++;
+  atomic_fetch_sub(&g_stream.consumers, 1);
+  TM_INFO("Feature stream: consumer detached (%u now)",
+          atomic_load(&g_stream.consumers));
+}
+
+static void *stream_thread_loop(void *arg) {
+  (void)arg;
+  struct pollfd pfds[1 + FEATURE_STREAM_MAX_CONSUMERS];
+
+  while (atomic_load(&g_stream.running)) {
+    pfds[0] = (struct pollfd){.fd = g_stream.listen_fd, .events = POLLIN};
+    for (int i = 0; i < FEATURE_STREAM_MAX_CONSUMERS; i++)
+      pfds[1 + i] = (struct pollfd){.fd = g_stream.clients[i],
+                                    .events = POLLIN}; /* -1: ignored */
+    if (poll(pfds, 1 + FEATURE_STREAM_MAX_CONSUMERS,
+             FEATURE_STREAM_POLL_MS) <= 0)
+      continue;
+
+    /* Consumers never send anything; readable means closed */
+    for (int i = 0; i < FEATURE_STREAM_MAX_CONSUMERS; i++) {
+      if (g_stream.clients[i] < 0 || pfds[1 + i].revents == 0)
+        continue;
+      char buf[64];
+      if (recv(g_stream.clients[i], buf, sizeof(buf), MSG_DONTWAIT) <= 0 ||
+          (pfds[1 + i].revents & (POLLHUP | POLLERR)))
+        detach_consumer(i);
+    }
+    if (pfds[0].revents & POLLIN)
+      accept_consumer();
+  }
+  return NULL;
+}
+
+/*============================================================================
+ * LIFECYCLE
+ *===========================================================================*/
+
+static int create_ring(void) {
+  size_t blocks_offset = sizeof(feature_stream_header_t);
+  size_t records_offset =
+      blocks_offset + FEATURE_STREAM_BLOCKS * sizeof(feature_stream_block_t);
+  size_t map_bytes =
+      records_offset + FEATURE_STREAM_RECORDS * sizeof(dataset_record_t);
+
+  int fd = memfd_create("tm_feature_stream", MFD_CLOEXEC);
+  if (fd < 0 || ftruncate(fd, (off_t)map_bytes) < 0) {
+    TM_ERROR("Feature stream memfd: %s", strerror(errno));
+    if (fd >= 0)
+      close(fd);
+    return -1;
+  }
+  void *map = mmap(NULL, map_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (map == MAP_FAILED) {
+    TM_ERROR("Feature stream mmap: %s", strerror(errno));
+    close(fd);
+    return -1;
+  }
+
+  /* Consumers get a descriptor they cannot write through */
+  char self[64];
+  snprintf(self, sizeof(self), "/proc/self/fd/%d", fd);
+  int reader_fd = open(self, O_RDONLY | O_CLOEXEC);
+  if (reader_fd < 0) {
+    TM_ERROR("Feature stream: no read-only descriptor (%s)", strerror(errno));
+    munmap(map, map_bytes);
+    close(fd);
+    return -1;
+  }
+
+  feature_stream_header_t *header = map;
+  memcpy(header->magic, FEATURE_STREAM_MAGIC, sizeof(header->magic));
+  header->version = FEATURE_STREAM_VERSION;
+  header->record_bytes = sizeof(dataset_record_t);
+  header->block_bytes = sizeof(feature_stream_block_t);
+  header->ring_records = FEATURE_STREAM_RECORDS;
+  header->block_slots = FEATURE_STREAM_BLOCKS;
+  header->blocks_offset = blocks_offset;
+  header->records_offset = records_offset;
+  header->map_bytes = map_bytes;
+  header->start_time_ns = get_time_ns();
+
+  g_stream.memfd = fd;
+  g_stream.reader_fd = reader_fd;
+  g_stream.map_bytes = map_bytes;
+  g_stream.header = header;
+  g_stream.blocks = (feature_stream_block_t *)((char *)map + blocks_offset);
+  g_stream.records = (dataset_record_t *)((char *)map + records_offset);
+  return 0;
+}
+
+static void destroy_ring(void) {
+  munmap(g_stream.header, g_stream.map_bytes);
+  close(g_stream.reader_fd);
+  close(g_stream.memfd);
+  g_stream.header = NULL;
+  g_stream.reader_fd = g_stream.memfd = -1;
+}
+
+int feature_stream_start(const char *path) {
+  if (g_stream.active)
+    return 0;
+  if (path == NULL || create_ring() < 0)
+    return -1;
+
+  g_stream.listen_fd =
+      listen_unix_socket(path, "Feature stream socket", SOCK_NONBLOCK);
+  if (g_stream.listen_fd < 0) {
+    destroy_ring();
+    return -1;
+  }
+  strcpy(g_stream.path, path);
+  for (int i = 0; i < FEATURE_STREAM_MAX_CONSUMERS; i++)
+    g_stream.clients[i] = -1;
+
+  atomic_store(&g_stream.running, true);
+  if (pthread_create(&g_stream.thread, NULL, stream_thread_loop, NULL) != 0) {
+    TM_ERROR("Failed to create feature stream thread: %s", strerror(errno));
+    atomic_store(&g_stream.running, false);
+    close(g_stream.listen_fd);
+    unlink(path);
+    g_stream.listen_fd = -1;
+    destroy_ring();
+    return -1;
+  }
+
+  g_stream.active = true;
+  TM_INFO("Feature stream on %s (%.1f MB shared ring)", path,
+          g_stream.map_bytes / 1048576.0);
+  return 0;
+}
+
+/* Consumers keep their mappings; the memfd lives until they unmap */
+void feature_stream_stop(void) {
+  if (!g_stream.active)
+    return;
+  feature_stream_commit();
+  g_stream.active = false;
+
+  atomic_store(&g_stream.running, false);
+  pthread_join(g_stream.thread, NULL);
+  for (int i = 0; i < FEATURE_STREAM_MAX_CONSUMERS; i++) {
+    if (g_stream.clients[i] >= 0) {
+      close(g_stream.clients[i]);
+      g_stream.clients[i] = -1;
+    }
+  }
+  atomic_store(&g_stream.consumers, 0);
+  close(g_stream.listen_fd);
+  unlink(g_stream.path);
+  g_stream.listen_fd = -1;
+  destroy_ring();
+}
+
+void feature_stream_get_stats(feature_stream_stats_t *out) {
+  if (out == NULL)
+    return;
+  *out = (feature_stream_stats_t){.blocks = g_stream.blocks_published,
+                                  .records = g_stream.records_published,
+                                  .attaches = g_stream.attaches,
+                                  .detaches = g_stream.detaches,
+                                  .consumers =
+                                      atomic_load(&g_stream.consumers)};
+}
+
+/*============================================================================
+ * REPORTING
+ *===========================================================================*/
+
+void print_feature_stream_report(void) {
+  if (!g_stream.active)
+    return;
+  feature_stream_stats_t stats;
+  feature_stream_get_stats(&stats);
+  printf("Feature stream: %" PRIu64 " blocks, %" PRIu64
+         " records published  consumers %" PRIu32 " (%" PRIu64
+         " attached, %" PRIu64 " detached)\n",
+         stats.blocks, stats.records, stats.consumers, stats.attaches,
+         stats.detaches);
+}
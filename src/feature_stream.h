@@ -0,0 +1,139 @@
+/*
+ * feature_stream.h - Live Feature Stream over Shared Memory
+ *
+ * Publishes the dataset export's per-cycle feature blocks to local
+ * consumer processes (online trainers, shadow evaluators) while the
+ * manager runs. Enabled with TM_FEATURE_STREAM=<socket path>.
+ *
+ * The stream is a memfd holding a header, a ring of block descriptors and
+ * a ring of dataset_record_t. A consumer connects to the Unix socket and
+ * receives a read-only descriptor for it (SCM_RIGHTS) together with a
+ * feature_stream_hello_t, maps it, and reads records in place. It stays
+ * attached as long as the connection is open. The dataset writer thread
+ * is the only producer. It never waits for a consumer and cannot be
+ * blocked by one: slow consumers are overrun and detect it themselves.
+ * While no consumer is attached, nothing is copied.
+ *
+ * Consumer protocol (tools/feature_stream.py implements it):
+ *   1. Read block_head; blocks [max(next, block_head - block_slots),
+ *      block_head) are available.
+ *   2. For block n, read blocks[n % block_slots]. Its sequence must be
+ *      n + 1, or the slot has been reused.
+ *   3. The block's records are records[first_record % ring_records ...],
+ *      contiguous (blocks never wrap). Once done with them, re-read
+ *      record_head: if record_head - first_record > ring_records, the
+ *      producer overwrote them while they were being read.
+ *
+ * The producer advances record_head before it overwrites a slot, so the
+ * check in step 3 is sufficient.
+ *
+ * A block is published as soon as the writer has nothing queued, so one
+ * cycle's snapshot can arrive as several blocks. The later ones carry
+ * FEATURE_BLOCK_CONTINUED.
+ *
+ * LDOS Research Project, UT Austin
+ */
+
+#ifndef FEATURE_STREAM_H
+#define FEATURE_STREAM_H
+
+#include "dataset_export.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/*============================================================================
+ * CONFIGURATION
+ *===========================================================================*/
+
+#define FEATURE_STREAM_ENV "TM_FEATURE_STREAM"
+#define FEATURE_STREAM_RECORDS 65536   /* Power of two: 4MB of records */
+#define FEATURE_STREAM_BLOCKS 4096     /* Power of two */
+#define FEATURE_STREAM_MAX_CONSUMERS 8
+#define FEATURE_STREAM_POLL_MS 100     /* Handshake thread poll interval */
+
+#define FEATURE_STREAM_MAGIC "TMFS"
+#define FEATURE_STREAM_VERSION 1
+#define FEATURE_BLOCK_KEYFRAME DATASET_RECORD_KEYFRAME
+#define FEATURE_BLOCK_CONTINUED 0x2 /* More of the previous block's cycle */
+
+/*============================================================================
+ * SHARED-MEMORY LAYOUT
+ *===========================================================================*/
+
+typedef struct feature_stream_block {
+  _Atomic uint64_t sequence;  /* Block number + 1; 0 while being written */
+  uint64_t cycle;
+  uint64_t timestamp_ns;
+  uint64_t first_record;      /* Absolute record index */
+  uint32_t records;
+  uint32_t flags;             /* FEATURE_BLOCK_* */
+  uint64_t reserved;
+} feature_stream_block_t;
+
+typedef struct feature_stream_header {
+  char magic[4];              /* FEATURE_STREAM_MAGIC */
+  uint32_t version;
+  uint32_t record_bytes;      /* sizeof(dataset_record_t) */
+  uint32_t block_bytes;       /* sizeof(feature_stream_block_t) */
+  uint32_t ring_records;
+  uint32_t block_slots;
+  uint64_t blocks_offset;     /* From the start of the mapping */
+  uint64_t records_offset;
+  uint64_t map_bytes;
+  uint64_t start_time_ns;
+  _Alignas(64) _Atomic uint64_t record_head; /* Records ever written */
+  _Atomic uint64_t block_head;               /* Blocks ever published */
+} feature_stream_header_t;
+
+/* Sent with the descriptor on connect */
+typedef struct feature_stream_hello {
+  char magic[4];
+  uint32_t version;
+  uint64_t map_bytes;
+} feature_stream_hello_t;
+
+_Static_assert(sizeof(feature_stream_block_t) == 48, "block layout");
+_Static_assert(sizeof(feature_stream_header_t) == 128, "header layout");
+
+typedef struct feature_stream_stats {
+  uint64_t blocks;            /* Published */
+  uint64_t records;
+  uint64_t attaches;
+  uint64_t detaches;
+  uint32_t consumers;         /* Attached now */
+} feature_stream_stats_t;
+
+/*============================================================================
+ * PUBLIC API
+ *===========================================================================*/
+
+/**
+ * Create the shared ring and listen on `path`. Returns 0 on success.
+ */
+int feature_stream_start(const char *path);
+
+/**
+ * Disconnect consumers, remove the socket and unmap the ring.
+ * Call after the producer has stopped.
+ */
+void feature_stream_stop(void);
+
+/**
+ * Add a record to the current block. A new cycle or keyframe flag starts
+ * a new block. Producer (dataset writer thread) only.
+ */
+void feature_stream_append(const dataset_record_t *record);
+
+/**
+ * Publish the current block, if any. Producer only.
+ */
+void feature_stream_commit(void);
+
+void feature_stream_get_stats(feature_stream_stats_t *out);
+
+/**
+ * Print stream counters (nothing if the stream never started).
+ */
+void print_feature_stream_report(void);
+
+#endif /* FEATURE_STREAM_H */
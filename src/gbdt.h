@@ -0,0 +1,61 @@
+/*
+ * gbdt.h - Compiled Tree-Ensemble Policies
+ *
+ * Interface between the core library and a tree ensemble compiled to C by
+ * tools/gbdt_compile.py. The generated translation unit defines
+ * `tm_gbdt_model`; it is linked in with `make GBDT_MODEL=model.json`.
+ *
+ * Generated trees are padded to a common depth and stored as constant
+ * node tables, so evaluating a page is a fixed sequence of
+ *   node = 2 * node + 1 + (feature[split[node]] >= threshold[node])
+ * steps with no data-dependent branches. Pages are scored FEATURE_BLOCK
+ * at a time in the structure-of-arrays layout from page_features.h.
+ *
+ * LDOS Research Project, UT Austin
+ */
+
+#ifndef GBDT_H
+#define GBDT_H
+
+#include "page_features.h"
+#include "tiered_memory.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/*============================================================================
+ * DATA STRUCTURES
+ *===========================================================================*/
+
+typedef struct gbdt_model {
+  const char *source; /* Model file the code was generated from */
+  uint32_t n_trees;
+  uint32_t depth;
+  uint32_t n_features; /* Must equal TM_FEATURE_COUNT */
+
+  /* Sum of leaf values plus base margin, i.e. the logit of P(hot) */
+  void (*eval_block)(const float *in, float logits[FEATURE_BLOCK]);
+} gbdt_model_t;
+
+/* Defined by the generated code; NULL address if no model was linked */
+extern const gbdt_model_t tm_gbdt_model __attribute__((weak));
+
+/*============================================================================
+ * PUBLIC API
+ *===========================================================================*/
+
+/**
+ * Install gbdt_batch_policy() as the active batch policy.
+ * Returns -1 if the library was built without GBDT_MODEL.
+ */
+int gbdt_policy_install(void);
+
+/**
+ * Batch policy backed by the compiled ensemble: promotes NVM pages whose
+ * P(hot) exceeds hot_threshold and demotes DRAM pages below
+ * cold_threshold, honoring min_residence_ns.
+ */
+size_t gbdt_batch_policy(const page_stats_t *const *pages, size_t count,
+                         migration_decision_t *decisions,
+                         size_t max_decisions);
+
+#endif /* GBDT_H */
@@ -0,0 +1,62 @@
+/*
+ * gbdt_policy.c - Compiled Tree-Ensemble Policy
+ *
+ * Batch policy wrapper around the ensemble generated by
+ * tools/gbdt_compile.py. See gbdt.h.
+ *
+ * LDOS Research Project, UT Austin
+ */
+
+#define _GNU_SOURCE
+#include "gbdt.h"
+#include <stdio.h>
+
+static const model_reasons_t g_gbdt_reasons = {"GBDT promotion",
+                                                "GBDT demotion"};
+
+int gbdt_policy_install(void) {
+  if (&tm_gbdt_model == NULL)
+    return -1;
+
+  if (tm_gbdt_model.n_features != TM_FEATURE_COUNT) {
+    TM_ERROR("GBDT model %s expects %u features, runtime provides %d",
+             tm_gbdt_model.source, tm_gbdt_model.n_features,
+             TM_FEATURE_COUNT);
+    return -1;
+  }
+
+  set_batch_migration_policy(gbdt_batch_policy);
+  TM_INFO("GBDT policy active (%s: %u trees, depth %u)", tm_gbdt_model.source,
+          tm_gbdt_model.n_trees, tm_gbdt_model.depth);
+  return 0;
+}
+
+size_t gbdt_batch_policy(const page_stats_t *const *pages, size_t count,
+                         migration_decision_t *decisions,
+                         size_t max_decisions) {
+  if (&tm_gbdt_model == NULL)
+    return 0;
+
+  float hot_logit = probability_to_logit(g_policy_config.hot_threshold);
+  float cold_logit = probability_to_logit(g_policy_config.cold_threshold);
+  uint64_t now = get_time_ns();
+
+  float features[TM_FEATURE_COUNT * FEATURE_BLOCK] __attribute__((aligned(32)));
+  float logits[FEATURE_BLOCK];
+  size_t ndecisions = 0;
+
+  for (size_t base = 0; base < count && ndecisions < max_decisions;
+       base += FEATURE_BLOCK) {
+    size_t n = count - base < FEATURE_BLOCK ? count - base : FEATURE_BLOCK;
+    extract_feature_block(pages + base, n, now, features);
+    tm_gbdt_model.eval_block(features, logits);
+
+    for (size_t p = 0; p < n && ndecisions < max_decisions; p++) {
+      if (model_logit_decision(pages[base + p], logits[p], hot_logit,
+                               cold_logit, now, &g_gbdt_reasons,
+                               &decisions[ndecisions]))
+        ndecisions++;
+    }
+  }
+  return ndecisions;
+}
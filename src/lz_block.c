@@ -0,0 +1,113 @@
+/*
+ * lz_block.c - LZ4-Format Block Compressor
+ *
+ * Greedy single-probe matcher. Format rules that every decoder relies on:
+ *   - matches are at least LZ_MIN_MATCH bytes, offsets 1..65535
+ *   - the last LZ_LAST_LITERALS bytes are always literals
+ *   - no match starts within LZ_MATCH_LIMIT bytes of the end
+ *
+ * LDOS Research Project, UT Austin
+ */
+
+#define _GNU_SOURCE
+#include "lz_block.h"
+#include <string.h>
+
+#define LZ_MIN_MATCH 4
+#define LZ_LAST_LITERALS 5
+#define LZ_MATCH_LIMIT 12
+#define LZ_SKIP_SHIFT 6 /* Step grows by 1 every 64 misses */
+
+static inline uint32_t read32(const uint8_t *p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static inline uint32_t hash32(uint32_t v) {
+  return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/* LZ4 length continuation: 255-valued bytes, then the remainder */
+static uint8_t *put_length(uint8_t *op, size_t len) {
+  while (len >= 255) {
+    *op++ = 255;
+    len -= 255;
+  }
+  *op++ = (uint8_t)len;
+  return op;
+}
+
+/* Emit literals [lit, lit + lit_len) and, if match_len > 0, a match */
+static uint8_t *put_sequence(uint8_t *op, const uint8_t *lit, size_t lit_len,
+                             size_t offset, size_t match_len) {
+  uint8_t *token = op++;
+  size_t ml = match_len > 0 ? match_len - LZ_MIN_MATCH : 0;
+
+  *token = (uint8_t)((lit_len < 15 ? lit_len : 15) << 4);
+  if (lit_len >= 15)
+    op = put_length(op, lit_len - 15);
+  memcpy(op, lit, lit_len);
+  op += lit_len;
+  if (match_len == 0)
+    return op;
+
+  *op++ = (uint8_t)offset;
+  *op++ = (uint8_t)(offset >> 8);
+  *token |= (uint8_t)(ml < 15 ? ml : 15);
+  if (ml >= 15)
+    op = put_length(op, ml - 15);
+  return op;
+}
+
+size_t lz_block_compress(const uint8_t *src, size_t len, uint8_t *dst,
+                         size_t cap) {
+  if (cap < lz_block_bound(len))
+    return 0; /* Sequences are written without per-byte bounds checks */
+
+  uint32_t table[1u << LZ_HASH_BITS];
+  memset(table, 0, sizeof(table));
+
+  uint8_t *op = dst;
+  size_t anchor = 0;
+  size_t ip = 1;
+
+  if (len > LZ_MATCH_LIMIT) {
+    size_t match_limit = len - LZ_MATCH_LIMIT;
+    size_t end_limit = len - LZ_LAST_LITERALS;
+    table[hash32(read32(src))] = 0;
+
+    while (ip < match_limit) {
+      uint32_t seq = read32(src + ip);
+      uint32_t h = hash32(seq);
+      size_t candidate = table[h];
+      table[h] = (uint32_t)ip;
+
+      if (ip - candidate > LZ_MAX_OFFSET || read32(src + candidate) != seq) {
+        ip += 1 + ((ip - anchor) >> LZ_SKIP_SHIFT);
+        continue;
+      }
+
+      /* Extend backwards over pending literals, then forwards */
+      while (ip > anchor && candidate > 0 &&
+             src[ip - 1] == src[candidate - 1]) {
+        ip--;
+        candidate--;
+      }
+      size_t match_len = LZ_MIN_MATCH;
+      while (ip + match_len < end_limit &&
+             src[ip + match_len] == src[candidate + match_len])
+        match_len++;
+
+      op = put_sequence(op, src + anchor, ip - anchor, ip - candidate,
+                        match_len);
+      ip += match_len;
+      anchor = ip;
+      if (ip < match_limit)
+        table[hash32(read32(src + ip - 2))] = (uint32_t)(ip - 2);
+    }
+  }
+
+  op = put_sequence(op, src + anchor, len - anchor, 0, 0);
+  return (size_t)(op - dst);
+}
@@ -0,0 +1,45 @@
+/*
+ * lz_block.h - LZ4-Format Block Compressor
+ *
+ * Dependency-free greedy compressor that emits the LZ4 block format
+ * (token, literals, 16-bit offset, match length; see lz4_Block_format.md
+ * in the LZ4 distribution). Any LZ4 block decoder can therefore read its
+ * output, e.g. lz4.block.decompress() in Python. It favours speed over
+ * ratio: one hash probe per position, and it skips ahead faster through
+ * data that does not match.
+ *
+ * Used by the dataset writer thread to compress TMDS chunks.
+ *
+ * LDOS Research Project, UT Austin
+ */
+
+#ifndef LZ_BLOCK_H
+#define LZ_BLOCK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*============================================================================
+ * CONFIGURATION
+ *===========================================================================*/
+
+#define LZ_HASH_BITS 14       /* 16K-entry match table (64KB on the stack) */
+#define LZ_MAX_OFFSET 65535
+
+/*============================================================================
+ * PUBLIC API
+ *===========================================================================*/
+
+/**
+ * Largest possible output for `len` input bytes.
+ */
+static inline size_t lz_block_bound(size_t len) { return len + len / 255 + 16; }
+
+/**
+ * Compress `len` bytes from `src` into `dst` (capacity `cap`). Returns the
+ * compressed size, or 0 if it does not fit.
+ */
+size_t lz_block_compress(const uint8_t *src, size_t len, uint8_t *dst,
+                         size_t cap);
+
+#endif /* LZ_BLOCK_H */
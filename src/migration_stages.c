@@ -0,0 +1,527 @@
+/*
+ * migration_stages.c - Promotion and Demotion Stages
+ *
+ * Accepted decisions from the policy thread's scan are split by direction
+ * into two independent stages, each with its own candidate index (ranked
+ * by cost_model.h), budget and cadence:
+ *
+ *   promotion  Latency-sensitive. Runs after every cycle with that cycle's
+ *              candidates, up to max_migrations_per_cycle moves; promotions
+ *              blocked by a full DRAM become swaps with the coldest pages.
+ *   demotion   Lazy and batched. Collects candidates over a whole scan pass
+ *              and runs at most once per demotion_interval_ms, up to
+ *              max_demotions_per_batch moves. Between runs the scan does not
+ *              even rank demotions.
+ *
+ * A flood of cold pages therefore never takes a promotion slot, and
+ * demotions left over do not make the policy period tighten.
+ *
+ * With g_policy_config.stage_threads (or TM_STAGE_THREADS=1) each stage
+ * executes on its own thread: the policy thread hands the filled index
+ * over and goes back to scanning. If the stage is still busy with its
+ * previous batch the new one is dropped; the next scan re-offers its pages.
+ *
+ * LDOS Research Project, UT Austin
+ */
+
+#define _GNU_SOURCE
+#include "cost_model.h"
+#include "decision_audit.h"
+#include "tiered_memory.h"
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*============================================================================
+ * CONFIGURATION
+ *===========================================================================*/
+
+#define MAX_STAGE_CANDIDATES 1024 /* Best accepted decisions kept per stage */
+#define MAX_SWAP_CANDIDATES 64    /* Promotions parked for swapping per run */
+
+/*============================================================================
+ * DATA STRUCTURES
+ *===========================================================================*/
+
+typedef enum {
+  STAGE_PROMOTION = 0,
+  STAGE_DEMOTION,
+  STAGE_COUNT
+} migration_stage_id_t;
+
+/* An accepted decision awaiting execution, ranked by the cost model */
+typedef struct ranked_candidate {
+  migration_decision_t decision;
+  double net_benefit_ns;
+} ranked_candidate_t;
+
+typedef struct migration_stage {
+  const char *name;
+
+  /* Min-heap on net_benefit_ns, filled by the policy thread's scan */
+  ranked_candidate_t *index;
+  size_t count;
+
+  /* Threaded mode: batch owned by the stage thread while `ready` */
+  ranked_candidate_t *batch;
+  size_t batch_count;
+  bool ready;
+  bool stop;
+  bool threaded;
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+
+  /* Promotions blocked by a full DRAM, awaiting the swap pass */
+  migration_decision_t blocked[MAX_SWAP_CANDIDATES];
+
+  /* Totals; updated by whichever thread executes the stage, read by reports */
+  _Atomic uint64_t migrated;
+  _Atomic uint64_t deferred; /* Left over because the budget ran out */
+  _Atomic uint64_t offered;
+  _Atomic uint64_t runs;
+  _Atomic uint64_t executed;
+  _Atomic int64_t executed_net_ns; /* Sum of their estimated net benefit */
+  _Atomic uint64_t swaps;
+  _Atomic uint64_t unprofitable; /* Promotions vetoed by the cost model */
+  _Atomic uint64_t busy_drops; /* Batches dropped: thread still busy */
+} migration_stage_t;
+
+static ranked_candidate_t g_index_storage[STAGE_COUNT][MAX_STAGE_CANDIDATES];
+static ranked_candidate_t g_batch_storage[STAGE_COUNT][MAX_STAGE_CANDIDATES];
+
+static struct {
+  migration_stage_t stages[STAGE_COUNT];
+
+  /* Demotion cadence */
+  bool demotion_armed;       /* The current pass collects demotions */
+  uint64_t next_demotion_ns; /* Earliest start of the next batch */
+  _Atomic uint64_t demotions_skipped; /* Offered while not armed */
+
+  /* Totals already reported by migration_stages_collect() */
+  uint64_t collected_migrated;
+  uint64_t collected_deferred;
+} g_stages = {
+    .stages = {[STAGE_PROMOTION] = {.name = "promotion",
+                                    .index = g_index_storage[STAGE_PROMOTION],
+                                    .batch = g_batch_storage[STAGE_PROMOTION]},
+               [STAGE_DEMOTION] = {.name = "demotion",
+                                   .index = g_index_storage[STAGE_DEMOTION],
+                                   .batch = g_batch_storage[STAGE_DEMOTION]}},
+    .demotion_armed = true};
+
+/*============================================================================
+ * CANDIDATE INDEX
+ *===========================================================================*/
+
+static void candidate_heap_sift_down(ranked_candidate_t *heap, size_t n,
+                                     size_t pos) {
+  for (;;) {
+    size_t smallest = pos, l = 2 * pos + 1, r = l + 1;
+    if (l < n && heap[l].net_benefit_ns < heap[smallest].net_benefit_ns)
+      smallest = l;
+    if (r < n && heap[r].net_benefit_ns < heap[smallest].net_benefit_ns)
+      smallest = r;
+    if (smallest == pos)
+      return;
+    ranked_candidate_t tmp = heap[pos];
+    heap[pos] = heap[smallest];
+    heap[smallest] = tmp;
+    pos = smallest;
+  }
+}
+
+/* Keep a decision if it is among the best the stage has seen this round */
+static void stage_index_insert(migration_stage_t *stage,
+                               const ranked_candidate_t *candidate) {
+  ranked_candidate_t *heap = stage->index;
+  atomic_fetch_add_explicit(&stage->offered, 1, memory_order_relaxed);
+
+  if (stage->count < MAX_STAGE_CANDIDATES) {
+    size_t pos = stage->count++;
+    while (pos > 0 &&
+           heap[(pos - 1) / 2].net_benefit_ns > candidate->net_benefit_ns) {
+      heap[pos] = heap[(pos - 1) / 2];
+      pos = (pos - 1) / 2;
+    }
+    heap[pos] = *candidate;
+  } else if (candidate->net_benefit_ns > heap[0].net_benefit_ns) {
+    decision_audit_record(&heap[0].decision, AUDIT_DEFERRED);
+    heap[0] = *candidate;
+    candidate_heap_sift_down(heap, stage->count, 0);
+    atomic_fetch_add(&stage->deferred, 1);
+  } else {
+    decision_audit_record(&candidate->decision, AUDIT_DEFERRED);
+    atomic_fetch_add(&stage->deferred, 1);
+  }
+}
+
+static int compare_by_net_benefit_desc(const void *a, const void *b) {
+  double na = ((const ranked_candidate_t *)a)->net_benefit_ns;
+  double nb = ((const ranked_candidate_t *)b)->net_benefit_ns;
+  return (na < nb) - (na > nb);
+}
+
+/*============================================================================
+ * SWAPS
+ *===========================================================================*/
+
+/*
+ * Exchange a hot NVM page with a cold DRAM victim as one operation.
+ * A swap leaves both tiers' usage unchanged, so the only check needed is
+ * that both pages are still where the decision saw them; if so, both
+ * placements are flipped under a single acquisition of migration_lock.
+ */
+static int try_swap(migration_decision_t *promotion, page_stats_t *victim) {
+  if (atomic_load(&g_manager.migrations_paused))
+    return MIGRATION_ERR_PAUSED;
+
+  page_stats_t *hot = get_page_stats(promotion->page_addr);
+  if (hot == NULL || victim == NULL)
+    return MIGRATION_ERR_NO_STATS;
+
+  uint64_t now = get_time_ns();
+  pthread_mutex_lock(&g_manager.migration_lock);
+  if (hot->current_tier != promotion->from_tier ||
+      victim->current_tier != promotion->to_tier) {
+    pthread_mutex_unlock(&g_manager.migration_lock);
+    return MIGRATION_ERR_STALE;
+  }
+  if (!page_residence_elapsed(hot, now) ||
+      !page_residence_elapsed(victim, now)) {
+    pthread_mutex_unlock(&g_manager.migration_lock);
+    return MIGRATION_ERR_BACKOFF;
+  }
+
+  /* In a real system, the two page copies would happen here */
+  record_page_migration(hot, promotion->to_tier, now);
+  record_page_migration(victim, promotion->from_tier, now);
+  pthread_mutex_unlock(&g_manager.migration_lock);
+
+  atomic_fetch_add(&g_manager.total_migrations, 2);
+  atomic_fetch_add(&g_manager.total_swaps, 1);
+  TM_DEBUG("Swapped %p (heat %.2f) <-> %p (heat %.2f)", hot->page_addr,
+           hot->heat_score, victim->page_addr, victim->heat_score);
+  return MIGRATION_OK;
+}
+
+/* Audited as two decisions; the victim's is the implied demotion */
+static int execute_swap(migration_decision_t *promotion, page_stats_t *victim) {
+  int result = try_swap(promotion, victim);
+  if (result != MIGRATION_OK) {
+    decision_audit_record(promotion, result);
+    return result;
+  }
+
+  migration_decision_t demotion = {.page_addr = victim->page_addr,
+                                   .from_tier = promotion->to_tier,
+                                   .to_tier = promotion->from_tier,
+                                   .confidence = promotion->confidence,
+                                   .reason = "Swap victim"};
+  decision_audit_record(promotion, AUDIT_SWAPPED);
+  decision_audit_record(&demotion, AUDIT_SWAPPED);
+  return result;
+}
+
+static int compare_by_confidence_desc(const void *a, const void *b) {
+  const migration_decision_t *da = a, *db = b;
+  return (da->confidence < db->confidence) - (da->confidence > db->confidence);
+}
+
+/*
+ * Pair promotions that failed because DRAM is full with the coldest DRAM
+ * pages: hottest candidate gets the coldest victim. Each swap moves two
+ * pages and is charged two migrations against `budget`.
+ * Returns number of pages migrated.
+ */
+static uint32_t run_swap_pass(migration_stage_t *stage,
+                              migration_decision_t *blocked, size_t count,
+                              uint32_t budget) {
+  size_t max_swaps = budget / 2;
+  if (count > max_swaps)
+    count = max_swaps;
+  if (count == 0)
+    return 0;
+
+  qsort(blocked, count, sizeof(*blocked), compare_by_confidence_desc);
+
+  page_stats_t *victims[MAX_SWAP_CANDIDATES];
+  size_t nvictims = find_coldest_pages(
+      TIER_DRAM, g_policy_config.min_residence_ns, victims, count);
+
+  uint32_t migrated = 0;
+  for (size_t i = 0; i < count && i < nvictims; i++) {
+    page_stats_t *hot = get_page_stats(blocked[i].page_addr);
+    if (hot == NULL ||
+        victims[i]->heat_score + g_policy_config.swap_margin >= hot->heat_score)
+      break; /* Remaining victims are warmer still */
+
+    if (execute_swap(&blocked[i], victims[i]) == MIGRATION_OK) {
+      migrated += 2;
+      atomic_fetch_add_explicit(&stage->swaps, 1, memory_order_relaxed);
+    }
+  }
+  return migrated;
+}
+
+/*============================================================================
+ * EXECUTION
+ *===========================================================================*/
+
+/* Raised while the phase detector reports a working-set change */
+static uint32_t stage_budget(const migration_stage_t *stage) {
+  uint32_t base = stage == &g_stages.stages[STAGE_PROMOTION]
+                      ? g_policy_config.max_migrations_per_cycle
+                      : g_policy_config.max_demotions_per_batch;
+  return base * atomic_load(&g_manager.phase_boost);
+}
+
+/*
+ * Execute candidates best first until the stage's budget runs out. Failed
+ * moves do not use budget, so the next candidate gets the slot; whatever
+ * is left counts as deferred. Promotions whose estimated savings do not
+ * cover their migration cost are vetoed instead. Demotions always cost
+ * more than they save, so for them the estimate only ranks.
+ */
+static void stage_execute(migration_stage_t *stage,
+                          ranked_candidate_t *candidates, size_t count) {
+  migration_decision_t *blocked = stage->blocked;
+  size_t blocked_count = 0;
+  uint32_t budget = stage_budget(stage);
+  uint32_t migrations = 0;
+
+  /* Paused: not a backlog, so the policy period is left alone */
+  if (atomic_load(&g_manager.migrations_paused)) {
+    for (size_t i = 0; i < count; i++)
+      decision_audit_record(&candidates[i].decision, MIGRATION_ERR_PAUSED);
+    return;
+  }
+
+  qsort(candidates, count, sizeof(ranked_candidate_t),
+        compare_by_net_benefit_desc);
+
+  if (stage == &g_stages.stages[STAGE_PROMOTION]) {
+    while (count > 0 && candidates[count - 1].net_benefit_ns <= 0) {
+      count--;
+      decision_audit_record(&candidates[count].decision, AUDIT_UNPROFITABLE);
+      atomic_fetch_add_explicit(&stage->unprofitable, 1,
+                                memory_order_relaxed);
+    }
+  }
+
+  size_t i = 0;
+  for (; i < count && migrations < budget; i++) {
+    migration_decision_t *decision = &candidates[i].decision;
+    int result = execute_migration(decision);
+    if (result == MIGRATION_OK) {
+      migrations++;
+      atomic_fetch_add_explicit(&stage->executed, 1, memory_order_relaxed);
+      atomic_fetch_add_explicit(&stage->executed_net_ns,
+                                (int64_t)candidates[i].net_benefit_ns,
+                                memory_order_relaxed);
+    } else if (result == MIGRATION_ERR_TIER_FULL &&
+               g_policy_config.swap_when_full &&
+               decision->to_tier == TIER_DRAM &&
+               blocked_count < MAX_SWAP_CANDIDATES) {
+      blocked[blocked_count++] = *decision;
+    }
+  }
+
+  /* DRAM full: exchange hot NVM pages with the coldest DRAM pages */
+  if (blocked_count > 0 && migrations < budget)
+    migrations += run_swap_pass(stage, blocked, blocked_count,
+                                budget - migrations);
+
+  atomic_fetch_add_explicit(&stage->runs, 1, memory_order_relaxed);
+  for (size_t left = i; left < count; left++)
+    decision_audit_record(&candidates[left].decision, AUDIT_DEFERRED);
+  atomic_fetch_add(&stage->deferred, count - i);
+  atomic_fetch_add(&stage->migrated, migrations);
+}
+
+static void *stage_thread_loop(void *arg) {
+  migration_stage_t *stage = arg;
+
+  pthread_mutex_lock(&stage->lock);
+  for (;;) {
+    while (!stage->ready && !stage->stop)
+      pthread_cond_wait(&stage->cond, &stage->lock);
+    if (stage->stop)
+      break;
+    pthread_mutex_unlock(&stage->lock);
+
+    stage_execute(stage, stage->batch, stage->batch_count);
+
+    pthread_mutex_lock(&stage->lock);
+    stage->ready = false;
+  }
+  pthread_mutex_unlock(&stage->lock);
+  return NULL;
+}
+
+/* Execute the stage's index inline, or hand it to the stage thread */
+static void stage_dispatch(migration_stage_t *stage) {
+  if (stage->count == 0)
+    return;
+
+  if (!stage->threaded) {
+    stage_execute(stage, stage->index, stage->count);
+    stage->count = 0;
+    return;
+  }
+
+  pthread_mutex_lock(&stage->lock);
+  if (stage->ready) {
+    atomic_fetch_add_explicit(&stage->busy_drops, 1, memory_order_relaxed);
+    for (size_t i = 0; i < stage->count; i++)
+      decision_audit_record(&stage->index[i].decision, AUDIT_DROPPED_BUSY);
+    atomic_fetch_add(&stage->deferred, stage->count);
+  } else {
+    ranked_candidate_t *filled = stage->index;
+    stage->index = stage->batch;
+    stage->batch = filled;
+    stage->batch_count = stage->count;
+    stage->ready = true;
+    pthread_cond_signal(&stage->cond);
+  }
+  pthread_mutex_unlock(&stage->lock);
+  stage->count = 0;
+}
+
+/*============================================================================
+ * POLICY THREAD HOOKS
+ *===========================================================================*/
+
+/* Route an accepted decision to the stage for its direction */
+void migration_stages_offer(const page_stats_t *stats,
+                            const migration_decision_t *decision) {
+  migration_stage_id_t id =
+      decision->to_tier == TIER_DRAM ? STAGE_PROMOTION : STAGE_DEMOTION;
+  if (id == STAGE_DEMOTION && !g_stages.demotion_armed) {
+    atomic_fetch_add_explicit(&g_stages.demotions_skipped, 1,
+                              memory_order_relaxed);
+    return;
+  }
+
+  migration_benefit_t benefit;
+  estimate_migration_benefit(stats, decision->to_tier, &benefit);
+  ranked_candidate_t candidate = {.decision = *decision,
+                                  .net_benefit_ns = benefit.net_ns};
+  /* Candidates can outlive the policy: a plugin swap dlclose()s its
+   * strings while the demotion index or a stage thread still holds them */
+  candidate.decision.reason = decision_audit_intern_reason(decision->reason);
+  stage_index_insert(&g_stages.stages[id], &candidate);
+}
+
+/*
+ * End of a policy cycle: promotions always run; demotions run once the
+ * pass that collected them is complete, then wait demotion_interval_ms
+ * before the next pass collects again.
+ */
+void migration_stages_end_cycle(bool pass_complete) {
+  stage_dispatch(&g_stages.stages[STAGE_PROMOTION]);
+
+  if (!pass_complete)
+    return;
+  uint64_t now = get_time_ns();
+  if (g_stages.demotion_armed) {
+    stage_dispatch(&g_stages.stages[STAGE_DEMOTION]);
+    g_stages.next_demotion_ns =
+        now + (uint64_t)g_policy_config.demotion_interval_ms * 1000000ULL;
+  }
+  g_stages.demotion_armed = now >= g_stages.next_demotion_ns;
+}
+
+/*
+ * Migrations completed and promotions deferred since the last call. Only
+ * the promotion backlog is reported: demotions wait by design.
+ */
+void migration_stages_collect(uint32_t *migrations, uint32_t *backlog) {
+  uint64_t migrated = 0;
+  for (int s = 0; s < STAGE_COUNT; s++)
+    migrated += atomic_load(&g_stages.stages[s].migrated);
+  uint64_t deferred =
+      atomic_load(&g_stages.stages[STAGE_PROMOTION].deferred);
+
+  *migrations = (uint32_t)(migrated - g_stages.collected_migrated);
+  *backlog = (uint32_t)(deferred - g_stages.collected_deferred);
+  g_stages.collected_migrated = migrated;
+  g_stages.collected_deferred = deferred;
+}
+
+int migration_stages_start(void) {
+  const char *env = getenv("TM_STAGE_THREADS");
+  if (env != NULL && env[0] != '\0')
+    g_policy_config.stage_threads = env[0] != '0';
+  if (!g_policy_config.stage_threads)
+    return 0;
+
+  for (int s = 0; s < STAGE_COUNT; s++) {
+    migration_stage_t *stage = &g_stages.stages[s];
+    pthread_mutex_init(&stage->lock, NULL);
+    pthread_cond_init(&stage->cond, NULL);
+    stage->ready = false;
+    stage->stop = false;
+    if (pthread_create(&stage->thread, NULL, stage_thread_loop, stage) != 0) {
+      TM_ERROR("Failed to create %s stage thread: %s", stage->name,
+               strerror(errno));
+      pthread_cond_destroy(&stage->cond);
+      pthread_mutex_destroy(&stage->lock);
+      continue; /* This stage runs inline on the policy thread */
+    }
+    stage->threaded = true;
+  }
+  TM_INFO("Migration stages running on their own threads");
+  return 0;
+}
+
+/* Call after the policy thread has exited */
+void migration_stages_stop(void) {
+  for (int s = 0; s < STAGE_COUNT; s++) {
+    migration_stage_t *stage = &g_stages.stages[s];
+    if (!stage->threaded)
+      continue;
+    pthread_mutex_lock(&stage->lock);
+    stage->stop = true;
+    pthread_cond_signal(&stage->cond);
+    pthread_mutex_unlock(&stage->lock);
+    pthread_join(stage->thread, NULL);
+    pthread_cond_destroy(&stage->cond);
+    pthread_mutex_destroy(&stage->lock);
+    stage->threaded = false;
+  }
+}
+
+/*============================================================================
+ * REPORTING
+ *===========================================================================*/
+
+void print_migration_stages_report(void) {
+  printf("Migration stages (%s):\n",
+         g_policy_config.stage_threads ? "own threads" : "policy thread");
+  for (int s = 0; s < STAGE_COUNT; s++) {
+    migration_stage_t *stage = &g_stages.stages[s];
+    uint64_t executed = atomic_load(&stage->executed);
+    int64_t executed_net_ns = atomic_load(&stage->executed_net_ns);
+    printf("  %-9s runs: %" PRIu64 "  offered: %" PRIu64
+           "  executed: %" PRIu64 " (mean est. net benefit %.1fus)"
+           "  deferred: %" PRIu64,
+           stage->name, (uint64_t)atomic_load(&stage->runs),
+           (uint64_t)atomic_load(&stage->offered), executed,
+           executed > 0 ? (double)executed_net_ns / executed / 1e3 : 0.0,
+           (uint64_t)atomic_load(&stage->deferred));
+    if (s == STAGE_PROMOTION)
+      printf("  swaps: %" PRIu64 "  unprofitable: %" PRIu64,
+             (uint64_t)atomic_load(&stage->swaps),
+             (uint64_t)atomic_load(&stage->unprofitable));
+    else
+      printf("  skipped between batches: %" PRIu64,
+             (uint64_t)atomic_load(&g_stages.demotions_skipped));
+    uint64_t busy_drops = atomic_load(&stage->busy_drops);
+    if (busy_drops > 0)
+      printf("  busy drops: %" PRIu64, busy_drops);
+    printf("\n");
+  }
+}
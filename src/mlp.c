@@ -0,0 +1,366 @@
+/*
+ * mlp.c - Built-in MLP Inference Engine
+ *
+ * Dense layers over feature blocks, with AVX2+FMA kernels selected at
+ * runtime and a scalar fallback. See mlp.h for the model file format.
+ *
+ * LDOS Research Project, UT Austin
+ */
+
+#define _GNU_SOURCE
+#include "mlp.h"
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MLP_HAVE_AVX2_KERNEL 1
+#else
+#define MLP_HAVE_AVX2_KERNEL 0
+#endif
+
+/* Kernel: one dense layer over a block, activations [n][FEATURE_BLOCK] */
+typedef void (*dense_kernel_fn)(const mlp_layer_t *layer, const float *in,
+                                float *out, bool apply_activation);
+
+static dense_kernel_fn g_dense_kernel = NULL;
+static const char *g_kernel_name = "scalar";
+static pthread_once_t g_kernel_once = PTHREAD_ONCE_INIT;
+
+/*============================================================================
+ * SCALAR KERNEL
+ *===========================================================================*/
+
+static void dense_block_scalar(const mlp_layer_t *layer, const float *in,
+                               float *out, bool apply_activation) {
+  for (uint32_t o = 0; o < layer->n_out; o++) {
+    const float *w = layer->weights + (size_t)o * layer->n_in;
+    float acc[FEATURE_BLOCK];
+    for (int p = 0; p < FEATURE_BLOCK; p++)
+      acc[p] = layer->bias[o];
+
+    for (uint32_t i = 0; i < layer->n_in; i++)
+      for (int p = 0; p < FEATURE_BLOCK; p++)
+        acc[p] += w[i] * in[i * FEATURE_BLOCK + p];
+
+    for (int p = 0; p < FEATURE_BLOCK; p++) {
+      float v = acc[p];
+      if (apply_activation && layer->activation == MLP_ACT_RELU)
+        v = v > 0.0f ? v : 0.0f;
+      else if (apply_activation && layer->activation == MLP_ACT_SIGMOID)
+        v = 1.0f / (1.0f + expf(-v));
+      out[o * FEATURE_BLOCK + p] = v;
+    }
+  }
+}
+
+/*============================================================================
+ * AVX2 KERNEL
+ *===========================================================================*/
+
+#if MLP_HAVE_AVX2_KERNEL
+
+/* exp(x) via 2^n * 2^f, with a degree-5 polynomial for 2^f on [0, 1) */
+__attribute__((target("avx2,fma"))) static inline __m256 exp_avx2(__m256 x) {
+  x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(-87.0f)),
+                    _mm256_set1_ps(88.0f));
+  __m256 t = _mm256_mul_ps(x, _mm256_set1_ps(1.44269504f));
+  __m256 n = _mm256_floor_ps(t);
+  __m256 f = _mm256_sub_ps(t, n);
+
+  __m256 p = _mm256_set1_ps(1.333355e-3f);
+  p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(9.618129e-3f));
+  p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(5.550411e-2f));
+  p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(2.402265e-1f));
+  p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(6.931472e-1f));
+  p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(1.0f));
+
+  __m256i e = _mm256_slli_epi32(
+      _mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23);
+  return _mm256_mul_ps(p, _mm256_castsi256_ps(e));
+}
+
+__attribute__((target("avx2,fma"))) static inline __m256
+activate_avx2(__m256 v, mlp_activation_t activation) {
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 one = _mm256_set1_ps(1.0f);
+  if (activation == MLP_ACT_RELU)
+    return _mm256_max_ps(v, zero);
+  if (activation == MLP_ACT_SIGMOID)
+    return _mm256_div_ps(one,
+                         _mm256_add_ps(one, exp_avx2(_mm256_sub_ps(zero, v))));
+  return v;
+}
+
+/*
+ * Eight output neurons are computed together: their FMA chains are
+ * independent, which covers FMA latency (4 cycles x 2 ports), and each
+ * input vector is loaded once for all eight.
+ */
+__attribute__((target("avx2,fma"))) static void
+dense_block_avx2(const mlp_layer_t *layer, const float *in, float *out,
+                 bool apply_activation) {
+  mlp_activation_t act = apply_activation ? layer->activation : MLP_ACT_LINEAR;
+  uint32_t n_in = layer->n_in;
+  uint32_t o = 0;
+
+#define MLP_FMA(k)                                                             \
+  acc##k = _mm256_fmadd_ps(_mm256_set1_ps(w[(k) * n_in + i]), x, acc##k)
+#define MLP_STORE(k)                                                           \
+  _mm256_storeu_ps(out + (o + (k)) * FEATURE_BLOCK, activate_avx2(acc##k, act))
+
+  for (; o + 8 <= layer->n_out; o += 8) {
+    const float *w = layer->weights + (size_t)o * n_in;
+    __m256 acc0 = _mm256_set1_ps(layer->bias[o + 0]);
+    __m256 acc1 = _mm256_set1_ps(layer->bias[o + 1]);
+    __m256 acc2 = _mm256_set1_ps(layer->bias[o + 2]);
+    __m256 acc3 = _mm256_set1_ps(layer->bias[o + 3]);
+    __m256 acc4 = _mm256_set1_ps(layer->bias[o + 4]);
+    __m256 acc5 = _mm256_set1_ps(layer->bias[o + 5]);
+    __m256 acc6 = _mm256_set1_ps(layer->bias[o + 6]);
+    __m256 acc7 = _mm256_set1_ps(layer->bias[o + 7]);
+
+    for (uint32_t i = 0; i < n_in; i++) {
+      __m256 x = _mm256_loadu_ps(in + i * FEATURE_BLOCK);
+      MLP_FMA(0);
+      MLP_FMA(1);
+      MLP_FMA(2);
+      MLP_FMA(3);
+      MLP_FMA(4);
+      MLP_FMA(5);
+      MLP_FMA(6);
+      MLP_FMA(7);
+    }
+
+    MLP_STORE(0);
+    MLP_STORE(1);
+    MLP_STORE(2);
+    MLP_STORE(3);
+    MLP_STORE(4);
+    MLP_STORE(5);
+    MLP_STORE(6);
+    MLP_STORE(7);
+  }
+
+#undef MLP_FMA
+#undef MLP_STORE
+
+  /* Remaining outputs: split each chain in four to shorten it */
+  for (; o < layer->n_out; o++) {
+    const float *w = layer->weights + (size_t)o * n_in;
+    __m256 acc[4] = {_mm256_set1_ps(layer->bias[o]), _mm256_setzero_ps(),
+                     _mm256_setzero_ps(), _mm256_setzero_ps()};
+    for (uint32_t i = 0; i < n_in; i++)
+      acc[i & 3] = _mm256_fmadd_ps(_mm256_set1_ps(w[i]),
+                                   _mm256_loadu_ps(in + i * FEATURE_BLOCK),
+                                   acc[i & 3]);
+    __m256 sum = _mm256_add_ps(_mm256_add_ps(acc[0], acc[1]),
+                               _mm256_add_ps(acc[2], acc[3]));
+    _mm256_storeu_ps(out + o * FEATURE_BLOCK, activate_avx2(sum, act));
+  }
+}
+
+#endif /* MLP_HAVE_AVX2_KERNEL */
+
+static void select_kernel(void) {
+  g_dense_kernel = dense_block_scalar;
+  g_kernel_name = "scalar";
+#if MLP_HAVE_AVX2_KERNEL
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    g_dense_kernel = dense_block_avx2;
+    g_kernel_name = "avx2";
+  }
+#endif
+}
+
+const char *mlp_kernel_name(void) {
+  pthread_once(&g_kernel_once, select_kernel);
+  return g_kernel_name;
+}
+
+/*============================================================================
+ * FORWARD PASS
+ *===========================================================================*/
+
+void mlp_forward_block(const mlp_model_t *model, const float *in,
+                       float logits[FEATURE_BLOCK]) {
+  float buf_a[MLP_MAX_WIDTH * FEATURE_BLOCK] __attribute__((aligned(32)));
+  float buf_b[MLP_MAX_WIDTH * FEATURE_BLOCK] __attribute__((aligned(32)));
+
+  const float *cur = in;
+  float *next = buf_a;
+  for (uint32_t l = 0; l < model->n_layers; l++) {
+    bool last = l + 1 == model->n_layers;
+    g_dense_kernel(&model->layers[l], cur, last ? logits : next, !last);
+    cur = next;
+    next = next == buf_a ? buf_b : buf_a;
+  }
+}
+
+/*============================================================================
+ * MODEL LOADING
+ *===========================================================================*/
+
+void mlp_model_free(mlp_model_t *model) {
+  if (model == NULL)
+    return;
+  for (uint32_t l = 0; l < model->n_layers; l++) {
+    free(model->layers[l].weights);
+    free(model->layers[l].bias);
+  }
+  free(model);
+}
+
+static bool read_exact(FILE *f, void *buf, size_t len) {
+  return fread(buf, 1, len, f) == len;
+}
+
+/* Fold x' = (x - mean) * scale into the first layer's weights and bias */
+static void fold_normalization(mlp_layer_t *layer, const float *mean,
+                               const float *scale) {
+  for (uint32_t o = 0; o < layer->n_out; o++) {
+    float *w = layer->weights + (size_t)o * layer->n_in;
+    for (uint32_t i = 0; i < layer->n_in; i++) {
+      w[i] *= scale[i];
+      layer->bias[o] -= w[i] * mean[i];
+    }
+  }
+}
+
+mlp_model_t *mlp_model_load(const char *path) {
+  pthread_once(&g_kernel_once, select_kernel);
+
+  FILE *f = fopen(path, "rb");
+  if (f == NULL) {
+    TM_ERROR("Cannot open MLP model %s: %s", path, strerror(errno));
+    return NULL;
+  }
+
+  mlp_model_t *model = calloc(1, sizeof(*model));
+  char magic[4];
+  uint32_t version, n_inputs, n_layers;
+  float mean[TM_FEATURE_COUNT], scale[TM_FEATURE_COUNT];
+
+  if (model == NULL || !read_exact(f, magic, sizeof(magic)) ||
+      memcmp(magic, MLP_MAGIC, sizeof(magic)) != 0 ||
+      !read_exact(f, &version, sizeof(version)) || version != MLP_VERSION ||
+      !read_exact(f, &n_inputs, sizeof(n_inputs))) {
+    TM_ERROR("%s: not a version %d MLP model", path, MLP_VERSION);
+    goto fail;
+  }
+  /* Features are only ever appended: older models use the leading ones */
+  if (n_inputs == 0 || n_inputs > TM_FEATURE_COUNT) {
+    TM_ERROR("%s: model expects %u inputs, runtime provides %d", path,
+             n_inputs, TM_FEATURE_COUNT);
+    goto fail;
+  }
+  if (!read_exact(f, mean, sizeof(float) * n_inputs) ||
+      !read_exact(f, scale, sizeof(float) * n_inputs) ||
+      !read_exact(f, &n_layers, sizeof(n_layers)) || n_layers == 0 ||
+      n_layers > MLP_MAX_LAYERS) {
+    TM_ERROR("%s: bad header (layers must be 1..%d)", path, MLP_MAX_LAYERS);
+    goto fail;
+  }
+
+  uint32_t n_in = n_inputs;
+  for (uint32_t l = 0; l < n_layers; l++) {
+    mlp_layer_t *layer = &model->layers[l];
+    uint32_t activation;
+    if (!read_exact(f, &layer->n_out, sizeof(layer->n_out)) ||
+        !read_exact(f, &activation, sizeof(activation)) ||
+        layer->n_out == 0 || layer->n_out > MLP_MAX_WIDTH ||
+        activation > MLP_ACT_SIGMOID) {
+      TM_ERROR("%s: bad layer %u header", path, l);
+      goto fail;
+    }
+    layer->n_in = n_in;
+    layer->activation = (mlp_activation_t)activation;
+    layer->weights = malloc(sizeof(float) * layer->n_out * n_in);
+    layer->bias = malloc(sizeof(float) * layer->n_out);
+    model->n_layers = l + 1; /* Owned arrays are freed on failure */
+    if (layer->weights == NULL || layer->bias == NULL ||
+        !read_exact(f, layer->weights, sizeof(float) * layer->n_out * n_in) ||
+        !read_exact(f, layer->bias, sizeof(float) * layer->n_out)) {
+      TM_ERROR("%s: truncated layer %u", path, l);
+      goto fail;
+    }
+    n_in = layer->n_out;
+  }
+  if (n_in != 1) {
+    TM_ERROR("%s: last layer must have a single output", path);
+    goto fail;
+  }
+
+  fold_normalization(&model->layers[0], mean, scale);
+  fclose(f);
+  return model;
+
+fail:
+  mlp_model_free(model);
+  fclose(f);
+  return NULL;
+}
+
+/*============================================================================
+ * MIGRATION POLICY
+ *===========================================================================*/
+
+static _Atomic(mlp_model_t *) g_pending_model = NULL;
+static mlp_model_t *g_active_model = NULL; /* Policy thread only */
+
+int mlp_policy_load(const char *path) {
+  mlp_model_t *model = mlp_model_load(path);
+  if (model == NULL)
+    return -1;
+
+  mlp_model_free(atomic_exchange(&g_pending_model, model));
+  set_batch_migration_policy(mlp_batch_policy);
+  TM_INFO("MLP model %s loaded (%u layers, %s kernel)", path, model->n_layers,
+          mlp_kernel_name());
+  return 0;
+}
+
+static const model_reasons_t g_mlp_reasons = {"MLP promotion",
+                                               "MLP demotion"};
+
+size_t mlp_batch_policy(const page_stats_t *const *pages, size_t count,
+                        migration_decision_t *decisions,
+                        size_t max_decisions) {
+  /* Adopt a newly loaded model; the old one is no longer referenced */
+  mlp_model_t *pending = atomic_exchange(&g_pending_model, NULL);
+  if (pending != NULL) {
+    mlp_model_free(g_active_model);
+    g_active_model = pending;
+  }
+  const mlp_model_t *model = g_active_model;
+  if (model == NULL)
+    return 0;
+
+  float hot_logit = probability_to_logit(g_policy_config.hot_threshold);
+  float cold_logit = probability_to_logit(g_policy_config.cold_threshold);
+  uint64_t now = get_time_ns();
+
+  float features[TM_FEATURE_COUNT * FEATURE_BLOCK] __attribute__((aligned(32)));
+  float logits[FEATURE_BLOCK];
+  size_t ndecisions = 0;
+
+  for (size_t base = 0; base < count && ndecisions < max_decisions;
+       base += FEATURE_BLOCK) {
+    size_t n = count - base < FEATURE_BLOCK ? count - base : FEATURE_BLOCK;
+    extract_feature_block(pages + base, n, now, features);
+    mlp_forward_block(model, features, logits);
+
+    for (size_t p = 0; p < n && ndecisions < max_decisions; p++) {
+      if (model_logit_decision(pages[base + p], logits[p], hot_logit,
+                               cold_logit, now, &g_mlp_reasons,
+                               &decisions[ndecisions]))
+        ndecisions++;
+    }
+  }
+  return ndecisions;
+}
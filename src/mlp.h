@@ -0,0 +1,114 @@
+/*
+ * mlp.h - Built-in MLP Inference Engine
+ *
+ * Small dense-network runtime for migration decisions, evaluated inside
+ * the policy thread without any external ML runtime:
+ *   - Dense layers with linear / ReLU / sigmoid activations
+ *   - AVX2+FMA kernels (runtime-detected) with a portable scalar fallback
+ *   - Pages are evaluated FEATURE_BLOCK at a time in structure-of-arrays
+ *     layout, so each SIMD lane scores a different page
+ *
+ * Model file format (little-endian):
+ *   char     magic[4]        "TMLP"
+ *   uint32   version         1
+ *   uint32   n_inputs        1..TM_FEATURE_COUNT (leading features)
+ *   float32  mean[n_inputs]  input normalization: x' = (x - mean) * scale
+ *   float32  scale[n_inputs]
+ *   uint32   n_layers        1..MLP_MAX_LAYERS
+ *   per layer:
+ *     uint32   n_out         1..MLP_MAX_WIDTH (last layer: 1)
+ *     uint32   activation    mlp_activation_t
+ *     float32  weights[n_out][n_in]
+ *     float32  bias[n_out]
+ *
+ * The single output is P(page is hot soon). The final sigmoid, if any, is
+ * not evaluated: forward passes return logits and the policy compares
+ * them against logit-space thresholds.
+ *
+ * LDOS Research Project, UT Austin
+ */
+
+#ifndef MLP_H
+#define MLP_H
+
+#include "page_features.h"
+#include "tiered_memory.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/*============================================================================
+ * CONFIGURATION
+ *===========================================================================*/
+
+#define MLP_MAGIC "TMLP"
+#define MLP_VERSION 1
+#define MLP_MAX_LAYERS 4
+#define MLP_MAX_WIDTH 64
+
+/*============================================================================
+ * DATA STRUCTURES
+ *===========================================================================*/
+
+typedef enum {
+  MLP_ACT_LINEAR = 0,
+  MLP_ACT_RELU = 1,
+  MLP_ACT_SIGMOID = 2
+} mlp_activation_t;
+
+typedef struct mlp_layer {
+  uint32_t n_in;
+  uint32_t n_out;
+  mlp_activation_t activation;
+  float *weights; /* [n_out][n_in], row-major */
+  float *bias;    /* [n_out] */
+} mlp_layer_t;
+
+typedef struct mlp_model {
+  uint32_t n_layers;
+  mlp_layer_t layers[MLP_MAX_LAYERS];
+} mlp_model_t;
+
+/*============================================================================
+ * PUBLIC API
+ *===========================================================================*/
+
+/**
+ * Load a model file. Input normalization is folded into the first layer.
+ * Returns NULL (and logs why) on a malformed or incompatible file.
+ */
+mlp_model_t *mlp_model_load(const char *path);
+
+/**
+ * Free a model returned by mlp_model_load().
+ */
+void mlp_model_free(mlp_model_t *model);
+
+/**
+ * Evaluate one block of pages.
+ * `in` holds TM_FEATURE_COUNT x FEATURE_BLOCK floats (see
+ * extract_feature_block()); `logits` receives one output per page.
+ */
+void mlp_forward_block(const mlp_model_t *model, const float *in,
+                       float logits[FEATURE_BLOCK]);
+
+/**
+ * Name of the kernel selected for this CPU ("avx2" or "scalar").
+ */
+const char *mlp_kernel_name(void);
+
+/**
+ * Load a model and install mlp_batch_policy() as the active batch policy.
+ * A model loaded while the policy is running replaces the previous one
+ * at the policy thread's next batch call.
+ */
+int mlp_policy_load(const char *path);
+
+/**
+ * Batch policy backed by the most recently loaded model: promotes NVM
+ * pages whose P(hot) exceeds hot_threshold and demotes DRAM pages below
+ * cold_threshold, honoring min_residence_ns.
+ */
+size_t mlp_batch_policy(const page_stats_t *const *pages, size_t count,
+                        migration_decision_t *decisions, size_t max_decisions);
+
+#endif /* MLP_H */
@@ -0,0 +1,138 @@
+/*
+ * page_features.c - Model Feature Extraction
+ *
+ * Converts page_stats_t into the fixed feature vector consumed by the
+ * built-in models. See page_features.h for the layout.
+ *
+ * LDOS Research Project, UT Austin
+ */
+
+#define _GNU_SOURCE
+#include "page_features.h"
+#include "cost_model.h"
+#include "page_history.h"
+#include <math.h>
+#include <string.h>
+
+void extract_page_features(const page_stats_t *stats, uint64_t now,
+                           float out[TM_FEATURE_COUNT]) {
+  uint64_t accesses = atomic_load_explicit(&stats->access_count,
+                                           memory_order_relaxed);
+  uint64_t writes =
+      atomic_load_explicit(&stats->write_count, memory_order_relaxed);
+  uint64_t last = atomic_load_explicit(&stats->last_access_ns,
+                                       memory_order_relaxed);
+
+  out[FEAT_HEAT_SCORE] = (float)stats->heat_score;
+  out[FEAT_LOG_ACCESS_RATE] = fast_log2p1((float)stats->access_rate);
+  out[FEAT_LOG_ACCESS_COUNT] = fast_log2p1((float)accesses);
+  out[FEAT_WRITE_FRACTION] =
+      accesses > 0 ? (float)writes / (float)accesses : 0.0f;
+  out[FEAT_LOG_ACCESS_DELTA] = fast_log2p1((float)stats->access_delta);
+  out[FEAT_LOG_IDLE_MS] =
+      fast_log2p1(now > last ? (float)(now - last) * 1e-6f : 0.0f);
+  out[FEAT_IN_NVM] = stats->current_tier == TIER_NVM ? 1.0f : 0.0f;
+  out[FEAT_LOG_MIGRATIONS] = fast_log2p1((float)stats->migration_count);
+  float net_us = (float)migration_net_benefit_ns(stats) * 1e-3f;
+  out[FEAT_NET_BENEFIT] = copysignf(fast_log2p1(fabsf(net_us)), net_us);
+}
+
+/*
+ * Two passes: gather raw values lane by lane (the only part that touches
+ * page_stats_t), then transform whole feature rows, which the compiler
+ * can vectorize across the FEATURE_BLOCK lanes.
+ */
+void extract_feature_block(const page_stats_t *const *pages, size_t count,
+                           uint64_t now,
+                           float out[TM_FEATURE_COUNT * FEATURE_BLOCK]) {
+  float *heat = out + FEAT_HEAT_SCORE * FEATURE_BLOCK;
+  float *rate = out + FEAT_LOG_ACCESS_RATE * FEATURE_BLOCK;
+  float *accesses = out + FEAT_LOG_ACCESS_COUNT * FEATURE_BLOCK;
+  float *writes = out + FEAT_WRITE_FRACTION * FEATURE_BLOCK;
+  float *delta = out + FEAT_LOG_ACCESS_DELTA * FEATURE_BLOCK;
+  float *idle = out + FEAT_LOG_IDLE_MS * FEATURE_BLOCK;
+  float *in_nvm = out + FEAT_IN_NVM * FEATURE_BLOCK;
+  float *migrations = out + FEAT_LOG_MIGRATIONS * FEATURE_BLOCK;
+  float *benefit = out + FEAT_NET_BENEFIT * FEATURE_BLOCK;
+
+  if (count < FEATURE_BLOCK)
+    memset(out, 0, sizeof(float) * TM_FEATURE_COUNT * FEATURE_BLOCK);
+
+  for (size_t p = 0; p < count; p++) {
+    const page_stats_t *stats = pages[p];
+    uint64_t last = atomic_load_explicit(&stats->last_access_ns,
+                                         memory_order_relaxed);
+    heat[p] = (float)stats->heat_score;
+    rate[p] = (float)stats->access_rate;
+    accesses[p] = (float)atomic_load_explicit(&stats->access_count,
+                                              memory_order_relaxed);
+    writes[p] =
+        (float)atomic_load_explicit(&stats->write_count, memory_order_relaxed);
+    delta[p] = (float)stats->access_delta;
+    idle[p] = now > last ? (float)(now - last) * 1e-6f : 0.0f;
+    in_nvm[p] = stats->current_tier == TIER_NVM ? 1.0f : 0.0f;
+    migrations[p] = (float)stats->migration_count;
+    benefit[p] = (float)migration_net_benefit_ns(stats) * 1e-3f;
+  }
+
+  for (size_t p = 0; p < FEATURE_BLOCK; p++) {
+    writes[p] = accesses[p] > 0.0f ? writes[p] / accesses[p] : 0.0f;
+    rate[p] = fast_log2p1(rate[p]);
+    accesses[p] = fast_log2p1(accesses[p]);
+    delta[p] = fast_log2p1(delta[p]);
+    idle[p] = fast_log2p1(idle[p]);
+    migrations[p] = fast_log2p1(migrations[p]);
+    benefit[p] = copysignf(fast_log2p1(fabsf(benefit[p])), benefit[p]);
+  }
+}
+
+void extract_history_block(const page_stats_t *const *pages, size_t count,
+                           float heat[PAGE_HISTORY_DEPTH * FEATURE_BLOCK],
+                           float delta[PAGE_HISTORY_DEPTH * FEATURE_BLOCK]) {
+  memset(heat, 0, sizeof(float) * PAGE_HISTORY_DEPTH * FEATURE_BLOCK);
+  memset(delta, 0, sizeof(float) * PAGE_HISTORY_DEPTH * FEATURE_BLOCK);
+
+  for (size_t p = 0; p < count; p++) {
+    size_t n = page_history_length(pages[p]);
+    for (size_t age = 0; age < n; age++) {
+      const page_history_entry_t *e = page_history_get(pages[p], age);
+      size_t t = PAGE_HISTORY_DEPTH - 1 - age;
+      heat[t * FEATURE_BLOCK + p] = page_history_heat(e);
+      delta[t * FEATURE_BLOCK + p] = fast_log2p1((float)e->access_delta);
+    }
+  }
+}
+
+/*============================================================================
+ * MODEL DECISIONS
+ *===========================================================================*/
+
+float probability_to_logit(double p) {
+  p = fmin(fmax(p, 1e-6), 1.0 - 1e-6);
+  return (float)log(p / (1.0 - p));
+}
+
+bool model_logit_decision(const page_stats_t *stats, float logit,
+                          float hot_logit, float cold_logit, uint64_t now,
+                          const model_reasons_t *reasons,
+                          migration_decision_t *decision) {
+  memory_tier_t to;
+  if (stats->current_tier == TIER_NVM && logit > hot_logit)
+    to = TIER_DRAM;
+  else if (stats->current_tier == TIER_DRAM && logit < cold_logit)
+    to = TIER_NVM;
+  else
+    return false;
+
+  if (!page_residence_elapsed(stats, now))
+    return false;
+
+  double p_hot = 1.0 / (1.0 + exp(-(double)logit));
+  *decision = (migration_decision_t){
+      .page_addr = stats->page_addr,
+      .from_tier = stats->current_tier,
+      .to_tier = to,
+      .confidence = to == TIER_DRAM ? p_hot : 1.0 - p_hot,
+      .reason = to == TIER_DRAM ? reasons->promotion : reasons->demotion};
+  return true;
+}
@@ -0,0 +1,115 @@
+/*
+ * page_features.h - Model Feature Extraction
+ *
+ * Fixed-length numeric feature vector derived from page_stats_t, shared
+ * by the built-in models (MLP, tree ensembles, quantized runtime, bandit).
+ * Counters are log-compressed so features stay in a small dynamic range.
+ *
+ * Feature order is part of the model file format: append new features
+ * at the end and bump TM_FEATURE_COUNT.
+ *
+ * LDOS Research Project, UT Austin
+ */
+
+#ifndef PAGE_FEATURES_H
+#define PAGE_FEATURES_H
+
+#include "page_history.h"
+#include "tiered_memory.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*============================================================================
+ * FEATURE LAYOUT
+ *===========================================================================*/
+
+typedef enum {
+  FEAT_HEAT_SCORE = 0,   /* heat_score, [0, 1] */
+  FEAT_LOG_ACCESS_RATE,  /* log2(1 + access_rate) */
+  FEAT_LOG_ACCESS_COUNT, /* log2(1 + access_count) */
+  FEAT_WRITE_FRACTION,   /* write_count / access_count, [0, 1] */
+  FEAT_LOG_ACCESS_DELTA, /* log2(1 + accesses since last feature update) */
+  FEAT_LOG_IDLE_MS,      /* log2(1 + ms since last access) */
+  FEAT_IN_NVM,           /* 1 if current_tier == TIER_NVM, else 0 */
+  FEAT_LOG_MIGRATIONS,   /* log2(1 + migration_count) */
+  FEAT_NET_BENEFIT,      /* +-log2(1 + |net benefit of moving| in us) */
+  TM_FEATURE_COUNT
+} feature_index_t;
+
+/* Pages per feature block: one AVX2 register of floats */
+#define FEATURE_BLOCK 8
+
+/*============================================================================
+ * HELPERS
+ *===========================================================================*/
+
+/*
+ * log2(1 + x) for x >= 0 using the float exponent plus a quadratic on the
+ * mantissa (abs error < 0.01). Far cheaper than log1p() when extracting
+ * features for millions of pages per cycle.
+ */
+static inline float fast_log2p1(float x) {
+  float y = 1.0f + x;
+  uint32_t bits;
+  memcpy(&bits, &y, sizeof(bits));
+  float exponent = (float)((int32_t)(bits >> 23) - 127);
+  bits = (bits & 0x007FFFFF) | 0x3F800000; /* Mantissa in [1, 2) */
+  float m;
+  memcpy(&m, &bits, sizeof(m));
+  return exponent + (-0.34484843f * m + 2.02466578f) * m - 1.67487759f;
+}
+
+/*============================================================================
+ * EXTRACTION
+ *===========================================================================*/
+
+/* Feature vector for one page; `now` is get_time_ns() for the batch */
+void extract_page_features(const page_stats_t *stats, uint64_t now,
+                           float out[TM_FEATURE_COUNT]);
+
+/*
+ * Structure-of-arrays extraction for `count` <= FEATURE_BLOCK pages:
+ * out[f * FEATURE_BLOCK + p] is feature f of page p. Unused lanes are
+ * zero-filled so SIMD kernels can always process full blocks.
+ */
+void extract_feature_block(const page_stats_t *const *pages, size_t count,
+                           uint64_t now,
+                           float out[TM_FEATURE_COUNT * FEATURE_BLOCK]);
+
+/*
+ * Sequence inputs from the per-page history (page_history.h) for `count`
+ * <= FEATURE_BLOCK pages, time-major: heat[t * FEATURE_BLOCK + p] is page
+ * p's heat t steps into its last PAGE_HISTORY_DEPTH updates, so the newest
+ * is at t = PAGE_HISTORY_DEPTH - 1. `delta` holds log2(1 + access_delta).
+ * Steps a page has no entry for (or every step, with history off) are 0.
+ */
+void extract_history_block(const page_stats_t *const *pages, size_t count,
+                           float heat[PAGE_HISTORY_DEPTH * FEATURE_BLOCK],
+                           float delta[PAGE_HISTORY_DEPTH * FEATURE_BLOCK]);
+
+/*============================================================================
+ * MODEL DECISIONS
+ *===========================================================================*/
+
+/* Reason strings reported for a model's promotions and demotions */
+typedef struct model_reasons {
+  const char *promotion;
+  const char *demotion;
+} model_reasons_t;
+
+/* log(p / (1 - p)), clamped so thresholds of 0 or 1 stay finite */
+float probability_to_logit(double p);
+
+/*
+ * Turn a model's logit for P(hot) into a decision: promote NVM pages above
+ * hot_logit, demote DRAM pages below cold_logit, honoring the page's
+ * residence requirement (min_residence_ns or its ping-pong backoff).
+ * Returns true and fills `decision` if the page should move.
+ */
+bool model_logit_decision(const page_stats_t *stats, float logit,
+                          float hot_logit, float cold_logit, uint64_t now,
+                          const model_reasons_t *reasons,
+                          migration_decision_t *decision);
+
+#endif /* PAGE_FEATURES_H */
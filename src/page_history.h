@@ -0,0 +1,97 @@
+/*
+ * page_history.h - Per-Page Feature History
+ *
+ * Optional fixed-depth trajectory of each tracked page, for sequence
+ * models (heat over the last PAGE_HISTORY_DEPTH feature updates,
+ * inter-access gaps). Enabled with g_policy_config.feature_history (or
+ * TM_FEATURE_HISTORY=1) before pages are tracked. Each page_stats_t is then
+ * allocated with a page_history_t directly behind it (stats->history), and
+ * compute_page_features() appends one compact entry per update. The cost
+ * is sizeof(page_history_t) (136 bytes) per tracked page. When the option
+ * is off, stats->history is NULL and nothing is allocated.
+ *
+ * The policy thread writes the ring, and batch policies read it from the
+ * same thread during the scan: every page_stats_t a migration_batch_policy_fn
+ * receives carries its history. The accessors below are static inline,
+ * so plugins can use them without linking against the manager.
+ *
+ * LDOS Research Project, UT Austin
+ */
+
+#ifndef PAGE_HISTORY_H
+#define PAGE_HISTORY_H
+
+#include "tiered_memory.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/*============================================================================
+ * CONFIGURATION
+ *===========================================================================*/
+
+#define PAGE_HISTORY_DEPTH 16          /* Entries per page */
+#define PAGE_HISTORY_ENV "TM_FEATURE_HISTORY"
+#define PAGE_HISTORY_HEAT_SCALE 65535.0f
+
+#define PAGE_HISTORY_MIGRATED 0x1      /* Moved since the previous entry */
+
+/*============================================================================
+ * DATA STRUCTURES
+ *===========================================================================*/
+
+/* One feature update (8 bytes) */
+typedef struct page_history_entry {
+  uint16_t heat;          /* heat_score * PAGE_HISTORY_HEAT_SCALE */
+  uint16_t access_delta;  /* Accesses since the previous entry, saturated */
+  uint16_t idle_ms;       /* Time since the page's last access, saturated */
+  uint8_t tier;           /* memory_tier_t */
+  uint8_t flags;          /* PAGE_HISTORY_* */
+} page_history_entry_t;
+
+struct page_history {
+  uint32_t recorded;      /* Entries ever appended; newest at recorded - 1 */
+  uint32_t migrations;    /* stats->migration_count at the newest entry */
+  page_history_entry_t entries[PAGE_HISTORY_DEPTH];
+};
+
+_Static_assert(sizeof(page_history_entry_t) == 8, "history entry layout");
+
+/*============================================================================
+ * ACCESSORS
+ *===========================================================================*/
+
+/* Entries available, at most PAGE_HISTORY_DEPTH; 0 when history is off */
+static inline size_t page_history_length(const page_stats_t *stats) {
+  if (stats->history == NULL)
+    return 0;
+  uint32_t n = stats->history->recorded;
+  return n < PAGE_HISTORY_DEPTH ? n : PAGE_HISTORY_DEPTH;
+}
+
+/* Entry `age` updates back (0 = newest); age < page_history_length() */
+static inline const page_history_entry_t *
+page_history_get(const page_stats_t *stats, size_t age) {
+  const page_history_t *h = stats->history;
+  return &h->entries[(h->recorded - 1 - age) % PAGE_HISTORY_DEPTH];
+}
+
+static inline float page_history_heat(const page_history_entry_t *entry) {
+  return (float)entry->heat / PAGE_HISTORY_HEAT_SCALE;
+}
+
+/*
+ * Copy up to `max` entries, oldest first, so out[n - 1] is the newest.
+ * Returns n.
+ */
+static inline size_t page_history_copy(const page_stats_t *stats,
+                                       page_history_entry_t *out,
+                                       size_t max) {
+  size_t n = page_history_length(stats);
+  if (n > max)
+    n = max;
+  for (size_t i = 0; i < n; i++)
+    out[i] = *page_history_get(stats, n - 1 - i);
+  return n;
+}
+
+#endif /* PAGE_HISTORY_H */
@@ -15,6 +15,7 @@
 #include <math.h>
 #include <inttypes.h>
 #include "tiered_memory.h"
+#include "page_history.h"
 
 /*============================================================================
  * UTILITIES
@@ -40,56 +41,48 @@ static inline size_t hash_page_addr(void *addr) {
  * PAGE STATISTICS MANAGEMENT
  *===========================================================================*/
 
+/* First entry for `aligned` in the chain from `entry`, stopping at `stop` */
+static page_stats_t* find_in_chain(page_stats_t *entry, void *aligned,
+                                   page_stats_t *stop) {
+    for (; entry != stop; entry = entry->next) {
+        if (entry->page_addr == aligned) return entry;
+    }
+    return NULL;
+}
+
 page_stats_t* get_page_stats(void *page_addr) {
     void *aligned = page_align(page_addr);
     size_t bucket = hash_page_addr(aligned);
     
     pthread_rwlock_rdlock(&g_manager.stats_lock);
-    page_stats_t *entry = g_manager.page_stats_table[bucket];
-    while (entry != NULL) {
-        if (entry->page_addr == aligned) {
-            pthread_rwlock_unlock(&g_manager.stats_lock);
-            return entry;
-        }
-        entry = entry->next;
-    }
+    page_stats_t *entry = find_in_chain(
+        atomic_load_explicit(&g_manager.page_stats_table[bucket],
+                             memory_order_acquire), aligned, NULL);
     pthread_rwlock_unlock(&g_manager.stats_lock);
-    return NULL;
+    return entry;
 }
 
+/*
+ * Lock-free: entries are pushed onto the bucket head with CAS and are only
+ * freed by cleanup_page_stats(), which tiered_manager_shutdown() calls after
+ * the fault handlers and the PEBS reader have been joined. Callers must not
+ * race that cleanup, so this path needs no share of stats_lock.
+ */
 page_stats_t* get_or_create_page_stats(void *page_addr) {
     void *aligned = page_align(page_addr);
     size_t bucket = hash_page_addr(aligned);
     
-    /* Try read-only lookup first */
-    pthread_rwlock_rdlock(&g_manager.stats_lock);
-    page_stats_t *entry = g_manager.page_stats_table[bucket];
-    while (entry != NULL) {
-        if (entry->page_addr == aligned) {
-            pthread_rwlock_unlock(&g_manager.stats_lock);
-            return entry;
-        }
-        entry = entry->next;
-    }
-    pthread_rwlock_unlock(&g_manager.stats_lock);
-    
-    /* Create new entry */
-    pthread_rwlock_wrlock(&g_manager.stats_lock);
+    page_stats_t *head = atomic_load_explicit(&g_manager.page_stats_table[bucket],
+                                              memory_order_acquire);
+    page_stats_t *entry = find_in_chain(head, aligned, NULL);
+    if (entry != NULL) return entry;
     
-    /* Double-check after acquiring write lock */
-    entry = g_manager.page_stats_table[bucket];
-    while (entry != NULL) {
-        if (entry->page_addr == aligned) {
-            pthread_rwlock_unlock(&g_manager.stats_lock);
-            return entry;
-        }
-        entry = entry->next;
-    }
-    
-    entry = (page_stats_t*)calloc(1, sizeof(page_stats_t));
+    /* The history ring, if enabled, shares the entry's allocation */
+    bool history = g_policy_config.feature_history;
+    entry = (page_stats_t*)calloc(1, sizeof(page_stats_t) +
+                                     (history ? sizeof(page_history_t) : 0));
     if (entry == NULL) {
         TM_ERROR("Failed to allocate page_stats_t");
-        pthread_rwlock_unlock(&g_manager.stats_lock);
         return NULL;
     }
     
@@ -99,19 +92,89 @@ page_stats_t* get_or_create_page_stats(void *page_addr) {
     atomic_store(&entry->last_access_ns, now);
     entry->allocation_ns = now;
     entry->current_tier = TIER_UNKNOWN;
+    if (history)
+        entry->history = (page_history_t*)(entry + 1);
     
-    entry->next = g_manager.page_stats_table[bucket];
-    g_manager.page_stats_table[bucket] = entry;
+    entry->next = head;
+    while (!atomic_compare_exchange_weak_explicit(
+               &g_manager.page_stats_table[bucket], &entry->next, entry,
+               memory_order_release, memory_order_acquire)) {
+        /* Lost the race: only the entries pushed since `head` are new */
+        page_stats_t *winner = find_in_chain(entry->next, aligned, head);
+        if (winner != NULL) {
+            free(entry);
+            return winner;
+        }
+        head = entry->next;
+    }
     atomic_fetch_add(&g_manager.total_pages_tracked, 1);
-    
-    pthread_rwlock_unlock(&g_manager.stats_lock);
     return entry;
 }
 
-void record_page_access(void *page_addr, bool is_write) {
-    page_stats_t *stats = get_or_create_page_stats(page_addr);
-    if (stats == NULL) return;
-    
+/* Restore max-heap order (by heat) below `pos` */
+static void coldest_heap_sift_down(page_stats_t **heap, size_t n, size_t pos) {
+    for (;;) {
+        size_t largest = pos, l = 2 * pos + 1, r = l + 1;
+        if (l < n && heap[l]->heat_score > heap[largest]->heat_score) largest = l;
+        if (r < n && heap[r]->heat_score > heap[largest]->heat_score) largest = r;
+        if (largest == pos) return;
+        page_stats_t *tmp = heap[pos];
+        heap[pos] = heap[largest];
+        heap[largest] = tmp;
+        pos = largest;
+    }
+}
+
+/*
+ * Collect up to `max` of the coldest pages in `tier`, sorted by ascending
+ * heat. Pages migrated within the last `min_residence_ns` (or their own
+ * ping-pong backoff, if longer) are skipped so victims obey the same
+ * anti-thrashing guard as regular migrations.
+ * Keeps a max-heap of the current selection: O(N log max).
+ */
+size_t find_coldest_pages(memory_tier_t tier, uint64_t min_residence_ns,
+                          page_stats_t **out, size_t max) {
+    if (out == NULL || max == 0) return 0;
+
+    uint64_t now = get_time_ns();
+    size_t found = 0;
+
+    pthread_rwlock_rdlock(&g_manager.stats_lock);
+    for (size_t i = 0; i < PAGE_STATS_HASH_SIZE; i++) {
+        page_stats_t *entry = g_manager.page_stats_table[i];
+        for (; entry != NULL; entry = entry->next) {
+            if (entry->current_tier != tier) continue;
+            if (entry->last_migration_ns != 0 &&
+                (now - entry->last_migration_ns < min_residence_ns ||
+                 now - entry->last_migration_ns < entry->residence_ns)) continue;
+
+            if (found < max) {
+                /* Sift up */
+                size_t pos = found++;
+                while (pos > 0 && out[(pos - 1) / 2]->heat_score < entry->heat_score) {
+                    out[pos] = out[(pos - 1) / 2];
+                    pos = (pos - 1) / 2;
+                }
+                out[pos] = entry;
+            } else if (entry->heat_score < out[0]->heat_score) {
+                out[0] = entry;
+                coldest_heap_sift_down(out, found, 0);
+            }
+        }
+    }
+    pthread_rwlock_unlock(&g_manager.stats_lock);
+
+    /* Heap sort in place: repeatedly move the warmest to the end */
+    for (size_t n = found; n > 1; n--) {
+        page_stats_t *tmp = out[0];
+        out[0] = out[n - 1];
+        out[n - 1] = tmp;
+        coldest_heap_sift_down(out, n - 1, 0);
+    }
+    return found;
+}
+
+void record_page_stats_access(page_stats_t *stats, bool is_write) {
     atomic_fetch_add(&stats->access_count, 1);
     if (is_write) {
         atomic_fetch_add(&stats->write_count, 1);
@@ -121,10 +184,36 @@ void record_page_access(void *page_addr, bool is_write) {
     atomic_store(&stats->last_access_ns, get_time_ns());
 }
 
+void record_page_access(void *page_addr, bool is_write) {
+    page_stats_t *stats = get_or_create_page_stats(page_addr);
+    if (stats == NULL) return;
+    
+    record_page_stats_access(stats, is_write);
+}
+
 /*============================================================================
  * FEATURE COMPUTATION
  *===========================================================================*/
 
+static uint16_t saturate_u16(uint64_t value) {
+    return value > UINT16_MAX ? UINT16_MAX : (uint16_t)value;
+}
+
+/* Append this update to the page's history ring */
+static void record_page_history(page_stats_t *stats, uint64_t now,
+                                uint64_t last_access) {
+    page_history_t *h = stats->history;
+    page_history_entry_t *e = &h->entries[h->recorded % PAGE_HISTORY_DEPTH];
+    
+    e->heat = (uint16_t)lrint(stats->heat_score * PAGE_HISTORY_HEAT_SCALE);
+    e->access_delta = saturate_u16(stats->access_delta);
+    e->idle_ms = saturate_u16(now > last_access ? (now - last_access) / 1000000 : 0);
+    e->tier = (uint8_t)stats->current_tier;
+    e->flags = stats->migration_count != h->migrations ? PAGE_HISTORY_MIGRATED : 0;
+    h->migrations = stats->migration_count;
+    h->recorded++;
+}
+
 void compute_page_features(page_stats_t *stats) {
     uint64_t now = get_time_ns();
     uint64_t access_count = atomic_load(&stats->access_count);
@@ -136,25 +225,119 @@ void compute_page_features(page_stats_t *stats) {
         stats->access_rate = (double)access_count * 1e9 / (double)lifetime_ns;
     }
     
-    /* Heat score using exponential decay (~10 second half-life) */
+    /* Recent activity since the previous update */
+    stats->access_delta = access_count > stats->prev_access_count
+                              ? access_count - stats->prev_access_count : 0;
+    stats->prev_access_count = access_count;
+    
+    /* Heat score using exponential decay (~10 second half-life), faster
+     * while the phase detector reports a working-set change */
     double decay_seconds = (double)(now - last_access) / 1e9;
-    double recency_factor = exp(-0.07 * decay_seconds);
+    double decay = g_policy_config.heat_decay_per_s *
+                   atomic_load_explicit(&g_manager.phase_boost, memory_order_relaxed);
+    double recency_factor = exp(-decay * decay_seconds);
     double frequency_factor = fmin(stats->access_rate / 1000.0, 1.0);
     
     stats->heat_score = 0.6 * recency_factor + 0.4 * frequency_factor;
     stats->heat_score = fmax(0.0, fmin(1.0, stats->heat_score));
+    
+    if (stats->history != NULL)
+        record_page_history(stats, now, last_access);
 }
 
-void update_all_page_features(void) {
+void update_page_features_range(size_t first_bucket, size_t end_bucket) {
+    if (end_bucket > PAGE_STATS_HASH_SIZE) end_bucket = PAGE_STATS_HASH_SIZE;
+    
+    uint64_t tier_accesses[TIER_COUNT] = {0};
     pthread_rwlock_rdlock(&g_manager.stats_lock);
-    for (size_t i = 0; i < PAGE_STATS_HASH_SIZE; i++) {
+    for (size_t i = first_bucket; i < end_bucket; i++) {
         page_stats_t *entry = g_manager.page_stats_table[i];
         while (entry != NULL) {
             compute_page_features(entry);
+            tier_accesses[entry->current_tier] += entry->access_delta;
             entry = entry->next;
         }
     }
     pthread_rwlock_unlock(&g_manager.stats_lock);
+    
+    /* Where recent accesses went, for the phase detector */
+    for (int t = 0; t < TIER_COUNT; t++) {
+        if (tier_accesses[t] > 0)
+            atomic_fetch_add(&g_manager.tier_accesses[t], tier_accesses[t]);
+    }
+}
+
+void update_all_page_features(void) {
+    update_page_features_range(0, PAGE_STATS_HASH_SIZE);
+}
+
+/*============================================================================
+ * PING-PONG DETECTION
+ *===========================================================================*/
+
+#define PINGPONG_WINDOW_FACTOR 4                  /* Reversal within 4x residence */
+#define PINGPONG_MAX_RESIDENCE_NS 10000000000ULL  /* Backoff cap: 10s */
+
+uint64_t page_min_residence_ns(const page_stats_t *stats) {
+    uint64_t floor = g_policy_config.min_residence_ns;
+    return stats->residence_ns > floor ? stats->residence_ns : floor;
+}
+
+bool page_residence_elapsed(const page_stats_t *stats, uint64_t now) {
+    return stats->last_migration_ns == 0 ||
+           now - stats->last_migration_ns >= page_min_residence_ns(stats);
+}
+
+/*
+ * Update placement state for an executed move (caller holds
+ * migration_lock). With two tiers every migration undoes the page's
+ * previous one, so moving again within PINGPONG_WINDOW_FACTOR residence
+ * periods counts as an oscillation and doubles the page's residence
+ * requirement. Every full window the page stayed put halves it again.
+ */
+void record_page_migration(page_stats_t *stats, memory_tier_t to_tier,
+                           uint64_t now) {
+    if (stats->last_migration_ns != 0) {
+        uint64_t required = page_min_residence_ns(stats);
+        uint64_t window = required * PINGPONG_WINDOW_FACTOR;
+        uint64_t resided = now - stats->last_migration_ns;
+        
+        if (resided < window) {
+            stats->oscillations++;
+            atomic_fetch_add(&g_manager.total_oscillations, 1);
+            stats->residence_ns = required * 2 < PINGPONG_MAX_RESIDENCE_NS
+                                      ? required * 2 : PINGPONG_MAX_RESIDENCE_NS;
+        } else if (stats->residence_ns != 0) {
+            uint64_t halvings = resided / window;
+            stats->residence_ns = halvings < 64 ? stats->residence_ns >> halvings : 0;
+            if (stats->residence_ns <= g_policy_config.min_residence_ns)
+                stats->residence_ns = 0;
+        }
+    }
+    
+    stats->current_tier = to_tier;
+    stats->last_migration_ns = now;
+    stats->migration_count++;
+}
+
+/* Pages currently held beyond the global min_residence_ns */
+size_t count_backed_off_pages(uint64_t *max_residence_ns) {
+    size_t pages = 0;
+    uint64_t max_residence = 0;
+    
+    pthread_rwlock_rdlock(&g_manager.stats_lock);
+    for (size_t i = 0; i < PAGE_STATS_HASH_SIZE; i++) {
+        for (page_stats_t *entry = g_manager.page_stats_table[i]; entry != NULL;
+             entry = entry->next) {
+            if (entry->residence_ns == 0) continue;
+            pages++;
+            if (entry->residence_ns > max_residence) max_residence = entry->residence_ns;
+        }
+    }
+    pthread_rwlock_unlock(&g_manager.stats_lock);
+    
+    if (max_residence_ns) *max_residence_ns = max_residence;
+    return pages;
 }
 
 void print_page_stats_summary(void) {
@@ -12,6 +12,7 @@
 #define _GNU_SOURCE
 #include <asm/unistd.h>
 #include <errno.h>
+#include <inttypes.h>
 #include <linux/hw_breakpoint.h>
 #include <linux/perf_event.h>
 #include <pthread.h>
@@ -65,13 +66,16 @@ static struct {
   pebs_page_record_t *records[PEBS_HASH_SIZE];
   pthread_rwlock_t records_lock;
 
+  _Atomic uint64_t sample_period;
+  _Atomic uint64_t region_samples[PEBS_REGION_BINS];
+
   /* Statistics */
   _Atomic uint64_t total_samples;
   _Atomic uint64_t read_samples;
   _Atomic uint64_t write_samples;
   _Atomic uint64_t throttle_events;
   _Atomic uint64_t errors;
-} pebs_state = {0};
+} pebs_state = {.sample_period = PEBS_SAMPLE_PERIOD};
 
 /*============================================================================
  * INTERNAL FUNCTIONS
@@ -89,6 +93,12 @@ static inline size_t hash_addr(uint64_t addr) {
   return (size_t)((pfn * golden) % PEBS_HASH_SIZE);
 }
 
+static inline size_t region_bin(uint64_t addr) {
+  const uint64_t golden = 0x9E3779B97F4A7C15ULL;
+  return (size_t)(((addr >> PEBS_REGION_SHIFT) * golden >> 32) %
+                  PEBS_REGION_BINS);
+}
+
 static inline uint64_t page_align_addr(uint64_t addr) {
   return addr & ~(PAGE_SIZE - 1);
 }
@@ -145,7 +155,7 @@ static int setup_perf_event(__u64 config, __u64 config1, int *fd_out,
   attr.size = sizeof(struct perf_event_attr);
   attr.config = config;
   attr.config1 = config1;
-  attr.sample_period = PEBS_SAMPLE_PERIOD;
+  attr.sample_period = atomic_load(&pebs_state.sample_period);
   attr.sample_type =
       PERF_SAMPLE_IP | PERF_SAMPLE_TID | PERF_SAMPLE_WEIGHT | PERF_SAMPLE_ADDR;
   attr.disabled = 1; /* Start disabled */
@@ -190,14 +200,19 @@ static void process_sample(struct perf_sample *ps, pebs_sample_type_t type) {
   }
 
   /* Update record atomically where possible */
+  uint64_t period = atomic_load(&pebs_state.sample_period);
   if (type == PEBS_SAMPLE_READ) {
     __sync_fetch_and_add(&rec->read_samples, 1);
+    __sync_fetch_and_add(&rec->est_reads, period);
     atomic_fetch_add(&pebs_state.read_samples, 1);
   } else {
     __sync_fetch_and_add(&rec->write_samples, 1);
+    __sync_fetch_and_add(&rec->est_writes, period);
     atomic_fetch_add(&pebs_state.write_samples, 1);
   }
 
+  atomic_fetch_add_explicit(&pebs_state.region_samples[region_bin(ps->addr)],
+                            1, memory_order_relaxed);
   __sync_fetch_and_add(&rec->total_latency, ps->weight);
   rec->last_sample_ns = get_time_ns();
 
@@ -379,6 +394,32 @@ void pebs_stop(void) {
   TM_INFO("PEBS sampling stopped");
 }
 
+int pebs_set_sample_period(uint64_t period) {
+  if (!pebs_state.initialized || period == 0)
+    return -1;
+
+  for (int i = 0; i < PEBS_SAMPLE_TYPE_COUNT; i++) {
+    if (ioctl(pebs_state.perf_fd[i], PERF_EVENT_IOC_PERIOD, &period) < 0) {
+      TM_ERROR("Failed to set PEBS period on event %d: %s", i,
+               strerror(errno));
+      return -1;
+    }
+  }
+  atomic_store(&pebs_state.sample_period, period);
+  TM_INFO("PEBS sample period set to %" PRIu64, period);
+  return 0;
+}
+
+uint64_t pebs_get_sample_period(void) {
+  return atomic_load(&pebs_state.sample_period);
+}
+
+void pebs_get_region_histogram(uint64_t *out) {
+  for (size_t i = 0; i < PEBS_REGION_BINS; i++)
+    out[i] = atomic_load_explicit(&pebs_state.region_samples[i],
+                                  memory_order_relaxed);
+}
+
 bool pebs_is_active(void) {
   return pebs_state.initialized && pebs_state.running;
 }
@@ -427,21 +468,17 @@ void pebs_merge_with_page_stats(void) {
       /* Get or create corresponding page_stats entry */
       page_stats_t *stats = get_or_create_page_stats((void *)rec->vaddr);
       if (stats != NULL) {
-        /*
-         * PEBS samples are statistical - multiply by sample period
-         * to estimate true access count. However, for ML features
-         * we use the raw sample counts as they're more stable.
-         */
-        uint64_t pebs_reads = rec->read_samples;
-        uint64_t pebs_writes = rec->write_samples;
-
         /* Merge PEBS samples with userfaultfd counts */
         uint64_t current_reads = atomic_load(&stats->read_count);
         uint64_t current_writes = atomic_load(&stats->write_count);
 
-        /* Use max of PEBS estimate and uffd count */
-        uint64_t estimated_reads = pebs_reads * PEBS_SAMPLE_PERIOD;
-        uint64_t estimated_writes = pebs_writes * PEBS_SAMPLE_PERIOD;
+        /*
+         * Use max of PEBS estimate and uffd count. PEBS samples are
+         * statistical: each one stands for the sample period that was
+         * in effect when it was taken.
+         */
+        uint64_t estimated_reads = rec->est_reads;
+        uint64_t estimated_writes = rec->est_writes;
 
         if (estimated_reads > current_reads) {
           atomic_store(&stats->read_count, estimated_reads);
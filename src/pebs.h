@@ -22,6 +22,8 @@
 
 #define PEBS_SAMPLE_PERIOD 100007        /* Samples every ~100K memory ops */
 #define PEBS_BUFFER_PAGES (1 + (1 << 8)) /* 1MB ring buffer (must be 1+2^n) */
+#define PEBS_REGION_SHIFT 21             /* 2MB address regions... */
+#define PEBS_REGION_BINS 256             /* ...hashed into this many bins */
 
 /* Intel PEBS event codes */
 #define PEBS_EVENT_MEM_LOADS 0x80d1  /* MEM_LOAD_RETIRED.ALL_LOADS */
@@ -41,6 +43,8 @@ typedef struct pebs_page_record {
   uint64_t vaddr;          /* Page-aligned virtual address */
   uint64_t read_samples;   /* Number of read samples */
   uint64_t write_samples;  /* Number of write samples */
+  uint64_t est_reads;      /* Samples scaled by the period in effect */
+  uint64_t est_writes;
   uint64_t total_latency;  /* Sum of access latencies (from PEBS weight) */
   uint64_t last_sample_ns; /* Timestamp of most recent sample */
   struct pebs_page_record *next; /* Hash chain */
@@ -107,6 +111,23 @@ pebs_stats_t pebs_get_stats(void);
  */
 void pebs_merge_with_page_stats(void);
 
+/**
+ * Change the sampling period of both events while running. Samples taken
+ * so far keep the period they were taken with. Returns 0 on success.
+ */
+int pebs_set_sample_period(uint64_t period);
+
+/**
+ * Current sampling period (memory ops per sample).
+ */
+uint64_t pebs_get_sample_period(void);
+
+/**
+ * Cumulative samples per address-region bin (PEBS_REGION_BINS entries).
+ * Differences between two calls give where recent samples landed.
+ */
+void pebs_get_region_histogram(uint64_t *out);
+
 /**
  * Clear all PEBS records (for testing or reset).
  */
@@ -126,6 +147,11 @@ static inline int pebs_start(void) { return -1; }
 static inline void pebs_stop(void) {}
 static inline bool pebs_is_active(void) { return false; }
 static inline void pebs_merge_with_page_stats(void) {}
+static inline int pebs_set_sample_period(uint64_t period) {
+  (void)period;
+  return -1;
+}
+static inline uint64_t pebs_get_sample_period(void) { return 0; }
 static inline void pebs_clear_records(void) {}
 static inline void pebs_print_status(void) {}
 
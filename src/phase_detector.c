@@ -0,0 +1,285 @@
+/*
+ * phase_detector.c - Working-Set Phase-Change Detector
+ *
+ * Evaluates three aggregate signals over PHASE_WINDOW_NS windows:
+ *   - Fault rate: a spike above its moving baseline means the
+ *     application is touching new memory
+ *   - PEBS sample distribution over address regions: Jensen-Shannon
+ *     divergence between consecutive windows means accesses moved
+ *   - Share of accesses served from NVM: a rise above its baseline means
+ *     the hot set now lives in the slow tier
+ *
+ * On detection g_manager.phase_boost becomes phase_boost_factor for
+ * PHASE_BOOST_NS. While boosted, heat scores decay that much faster, so
+ * heat left over from the old phase fades in seconds rather than tens of
+ * seconds. The migration stages' budgets grow by the same factor and the
+ * policy period stays short. A complete rescan is requested when the
+ * boost starts. Further detections extend it; afterwards it returns to 1.
+ *
+ * Baselines are exponential moving averages with a PHASE_BASELINE_TAU_NS
+ * time constant, so a new steady state stops triggering after a while.
+ *
+ * LDOS Research Project, UT Austin
+ */
+
+#define _GNU_SOURCE
+#include "pebs.h"
+#include "tiered_memory.h"
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+/*============================================================================
+ * CONFIGURATION
+ *===========================================================================*/
+
+#define PHASE_WINDOW_NS 100000000ULL       /* Signals evaluated every 100ms */
+#define PHASE_BASELINE_TAU_NS 2000000000.0 /* Baseline EWMA time constant */
+#define PHASE_BOOST_NS 2000000000ULL       /* Boost lasts 2s past detection */
+
+#define PHASE_FAULT_SPIKE_RATIO 4.0   /* Fault rate vs. its baseline */
+#define PHASE_MIN_FAULT_RATE 1000.0   /* Faults/s below this never spike */
+#define PHASE_DIVERGENCE_BITS 0.25    /* JS divergence between windows */
+#define PHASE_MIN_SAMPLES 256         /* PEBS samples for a distribution */
+#define PHASE_NVM_SHARE_RISE 0.2      /* NVM share above its baseline... */
+#define PHASE_NVM_SHARE_MIN 0.25      /* ...and at least this */
+#define PHASE_MIN_ACCESSES 256        /* Accesses for a meaningful share */
+
+/* Policy thread hooks (policy_thread.c) */
+extern void policy_thread_request_scan(void);
+
+/*============================================================================
+ * STATE
+ *===========================================================================*/
+
+typedef enum {
+  SIGNAL_FAULT_SPIKE = 0,
+  SIGNAL_DISTRIBUTION,
+  SIGNAL_NVM_SHARE,
+  SIGNAL_COUNT
+} phase_signal_t;
+
+static const char *const g_signal_names[SIGNAL_COUNT] = {
+    "fault spike", "access distribution", "NVM share"};
+
+static struct {
+  bool initialized;
+  bool baselines_valid;
+
+  /* Counters at the start of the current window */
+  uint64_t window_start_ns;
+  uint64_t window_faults;
+  uint64_t window_tier_accesses[TIER_COUNT];
+  uint64_t window_regions[PEBS_REGION_BINS];
+
+  /* Previous window's sample distribution */
+  double prev_distribution[PEBS_REGION_BINS];
+  bool prev_distribution_valid;
+
+  double fault_rate_baseline;
+  double nvm_share_baseline;
+  uint64_t boost_until_ns;
+  uint64_t boost_start_ns;
+
+  /* Reporting */
+  uint64_t windows;
+  uint64_t boosts;
+  uint64_t detections[SIGNAL_COUNT];
+  uint64_t boosted_ns;
+  double last_fault_rate;
+  double last_nvm_share;
+  double last_divergence;
+} g_phase;
+
+static bool read_region_histogram(uint64_t *out) {
+#ifdef __linux__
+  if (!pebs_is_active())
+    return false;
+  pebs_get_region_histogram(out);
+  return true;
+#else
+  (void)out;
+  return false;
+#endif
+}
+
+static void start_window(uint64_t now) {
+  g_phase.window_start_ns = now;
+  g_phase.window_faults = atomic_load(&g_manager.total_faults);
+  for (int t = 0; t < TIER_COUNT; t++)
+    g_phase.window_tier_accesses[t] = atomic_load(&g_manager.tier_accesses[t]);
+  read_region_histogram(g_phase.window_regions);
+}
+
+/*============================================================================
+ * SIGNALS
+ *===========================================================================*/
+
+/* Jensen-Shannon divergence in bits, [0, 1] */
+static double js_divergence(const double *p, const double *q, size_t n) {
+  double js = 0.0;
+  for (size_t i = 0; i < n; i++) {
+    double m = 0.5 * (p[i] + q[i]);
+    if (p[i] > 0.0)
+      js += 0.5 * p[i] * log2(p[i] / m);
+    if (q[i] > 0.0)
+      js += 0.5 * q[i] * log2(q[i] / m);
+  }
+  return js;
+}
+
+/* Divergence of this window's PEBS samples from the last; -1 if unknown */
+static double distribution_divergence(void) {
+  uint64_t regions[PEBS_REGION_BINS];
+  if (!read_region_histogram(regions))
+    return -1.0;
+
+  uint64_t total = 0;
+  for (size_t i = 0; i < PEBS_REGION_BINS; i++) {
+    regions[i] -= g_phase.window_regions[i];
+    total += regions[i];
+  }
+  if (total < PHASE_MIN_SAMPLES)
+    return -1.0;
+
+  double distribution[PEBS_REGION_BINS];
+  for (size_t i = 0; i < PEBS_REGION_BINS; i++)
+    distribution[i] = (double)regions[i] / total;
+
+  double divergence =
+      g_phase.prev_distribution_valid
+          ? js_divergence(distribution, g_phase.prev_distribution,
+                          PEBS_REGION_BINS)
+          : -1.0;
+  memcpy(g_phase.prev_distribution, distribution, sizeof(distribution));
+  g_phase.prev_distribution_valid = true;
+  return divergence;
+}
+
+/* Returns a mask of the signals that fired in the window just ended */
+static uint32_t evaluate_window(uint64_t now) {
+  double elapsed_s = (now - g_phase.window_start_ns) * 1e-9;
+  double fault_rate =
+      (atomic_load(&g_manager.total_faults) - g_phase.window_faults) /
+      elapsed_s;
+
+  uint64_t accesses = 0, nvm_accesses = 0;
+  for (int t = 0; t < TIER_COUNT; t++) {
+    uint64_t delta = atomic_load(&g_manager.tier_accesses[t]) -
+                     g_phase.window_tier_accesses[t];
+    accesses += delta;
+    if (t == TIER_NVM)
+      nvm_accesses = delta;
+  }
+  double nvm_share = accesses >= PHASE_MIN_ACCESSES
+                         ? (double)nvm_accesses / accesses
+                         : g_phase.nvm_share_baseline;
+  double divergence = distribution_divergence();
+
+  g_phase.windows++;
+  g_phase.last_fault_rate = fault_rate;
+  g_phase.last_nvm_share = nvm_share;
+  g_phase.last_divergence = divergence;
+
+  uint32_t fired = 0;
+  if (!g_phase.baselines_valid) {
+    /* First window defines normal */
+    g_phase.fault_rate_baseline = fault_rate;
+    g_phase.nvm_share_baseline = nvm_share;
+    g_phase.baselines_valid = true;
+    return 0;
+  }
+
+  if (fault_rate > PHASE_MIN_FAULT_RATE &&
+      fault_rate > PHASE_FAULT_SPIKE_RATIO * g_phase.fault_rate_baseline)
+    fired |= 1u << SIGNAL_FAULT_SPIKE;
+  if (divergence > PHASE_DIVERGENCE_BITS)
+    fired |= 1u << SIGNAL_DISTRIBUTION;
+  if (nvm_share > PHASE_NVM_SHARE_MIN &&
+      nvm_share > g_phase.nvm_share_baseline + PHASE_NVM_SHARE_RISE)
+    fired |= 1u << SIGNAL_NVM_SHARE;
+
+  double alpha = 1.0 - exp(-(double)(now - g_phase.window_start_ns) /
+                           PHASE_BASELINE_TAU_NS);
+  g_phase.fault_rate_baseline +=
+      alpha * (fault_rate - g_phase.fault_rate_baseline);
+  g_phase.nvm_share_baseline +=
+      alpha * (nvm_share - g_phase.nvm_share_baseline);
+  return fired;
+}
+
+/*============================================================================
+ * POLICY THREAD HOOK
+ *===========================================================================*/
+
+/* Called once per policy cycle, before feature updates */
+void phase_detector_update(void) {
+  uint64_t now = get_time_ns();
+  if (!g_phase.initialized) {
+    start_window(now);
+    g_phase.initialized = true;
+    return;
+  }
+
+  uint32_t boost = atomic_load(&g_manager.phase_boost);
+  if (boost > 1 && now >= g_phase.boost_until_ns) {
+    atomic_store(&g_manager.phase_boost, 1);
+    g_phase.boosted_ns += now - g_phase.boost_start_ns;
+    boost = 1;
+    TM_DEBUG("Phase boost ended");
+  }
+
+  if (now - g_phase.window_start_ns < PHASE_WINDOW_NS)
+    return;
+  uint32_t fired = evaluate_window(now);
+  start_window(now);
+
+  uint32_t factor = g_policy_config.phase_boost_factor;
+  if (fired == 0 || factor <= 1)
+    return;
+
+  for (int s = 0; s < SIGNAL_COUNT; s++)
+    if (fired & (1u << s))
+      g_phase.detections[s]++;
+  g_phase.boost_until_ns = now + PHASE_BOOST_NS;
+  if (boost > 1)
+    return; /* Already boosted: extended */
+
+  atomic_store(&g_manager.phase_boost, factor);
+  g_phase.boost_start_ns = now;
+  g_phase.boosts++;
+  policy_thread_request_scan();
+
+  char signals[64] = "";
+  for (int s = 0; s < SIGNAL_COUNT; s++)
+    if (fired & (1u << s))
+      snprintf(signals + strlen(signals), sizeof(signals) - strlen(signals),
+               "%s%s", signals[0] ? ", " : "", g_signal_names[s]);
+  TM_INFO("Phase change (%s): decay and budgets x%" PRIu32 " for %.1fs",
+          signals, factor, PHASE_BOOST_NS / 1e9);
+}
+
+/*============================================================================
+ * REPORTING
+ *===========================================================================*/
+
+void print_phase_detector_report(void) {
+  uint64_t boosted_ns = g_phase.boosted_ns;
+  if (atomic_load(&g_manager.phase_boost) > 1)
+    boosted_ns += get_time_ns() - g_phase.boost_start_ns;
+
+  printf("Phase detector: %" PRIu64 " windows, %" PRIu64
+         " boosts (x%" PRIu32 ", %.1fs total), detections:",
+         g_phase.windows, g_phase.boosts, g_policy_config.phase_boost_factor,
+         boosted_ns / 1e9);
+  for (int s = 0; s < SIGNAL_COUNT; s++)
+    printf(" %s=%" PRIu64, g_signal_names[s], g_phase.detections[s]);
+  printf("\n  Last window: faults %.0f/s (baseline %.0f/s)  NVM share %.2f"
+         " (baseline %.2f)",
+         g_phase.last_fault_rate, g_phase.fault_rate_baseline,
+         g_phase.last_nvm_share, g_phase.nvm_share_baseline);
+  if (g_phase.last_divergence >= 0.0)
+    printf("  divergence %.3f bits", g_phase.last_divergence);
+  printf("\n");
+}
@@ -0,0 +1,167 @@
+/*
+ * policy_interval.c - Adaptive Policy Interval
+ *
+ * Picks the policy thread's period for the next cycle, between
+ * g_policy_config.interval_min_ms and interval_max_ms:
+ *   - Tighten (halve) under churn: high fault or PEBS sample rate,
+ *     candidates left over because the migration budget ran out, or a
+ *     phase change in progress (g_manager.phase_boost)
+ *   - Relax (x1.25) after INTERVAL_QUIET_CYCLES consecutive cycles with
+ *     no faults, no migrations and few samples
+ *   - Never let the cycle's own cost exceed 1/INTERVAL_MAX_DUTY_INV of
+ *     the period, so a large page table cannot monopolize a core
+ *
+ * Tightening is multiplicative and immediate while relaxing is gradual,
+ * so a phase change is picked up within a few cycles but an idle
+ * application is not woken 100 times a second.
+ *
+ * The chosen period is published in g_manager.policy_interval_ns.
+ *
+ * LDOS Research Project, UT Austin
+ */
+
+#define _GNU_SOURCE
+#include "pebs.h"
+#include "tiered_memory.h"
+#include <inttypes.h>
+#include <stdio.h>
+
+/*============================================================================
+ * CONFIGURATION
+ *===========================================================================*/
+
+#define INTERVAL_BUSY_FAULTS_PER_SEC 1000.0   /* New pages being touched */
+#define INTERVAL_BUSY_SAMPLES_PER_SEC 20000.0 /* ~2G memory ops/s */
+#define INTERVAL_QUIET_SAMPLES_PER_SEC 500.0
+#define INTERVAL_QUIET_CYCLES 4
+#define INTERVAL_MAX_DUTY_INV 5 /* Cycle cost <= 20% of the period */
+
+/*============================================================================
+ * STATE
+ *===========================================================================*/
+
+static struct {
+  uint64_t last_update_ns;
+  uint64_t last_faults;
+  uint64_t last_samples;
+  uint32_t quiet_cycles;
+
+  /* Reporting */
+  uint64_t tightened;
+  uint64_t relaxed;
+  uint64_t cost_limited; /* Period raised to respect the duty cycle */
+  uint64_t total_cycle_ns;
+  uint64_t cycles;
+} g_interval;
+
+static uint64_t pebs_total_samples(void) {
+#ifdef __linux__
+  return pebs_get_stats().total_samples;
+#else
+  return 0;
+#endif
+}
+
+static uint64_t clamp_interval(uint64_t interval_ns) {
+  uint64_t min_ns = (uint64_t)g_policy_config.interval_min_ms * 1000000ULL;
+  uint64_t max_ns = (uint64_t)g_policy_config.interval_max_ms * 1000000ULL;
+  if (min_ns == 0)
+    min_ns = 1000000ULL;
+  if (max_ns < min_ns)
+    max_ns = min_ns;
+  if (interval_ns < min_ns)
+    return min_ns;
+  if (interval_ns > max_ns)
+    return max_ns;
+  return interval_ns;
+}
+
+/*============================================================================
+ * POLICY THREAD HOOKS
+ *===========================================================================*/
+
+/* Reset the controller to POLICY_INTERVAL_MS; returns that period */
+uint64_t policy_interval_init(void) {
+  g_interval = (typeof(g_interval)){0};
+  g_interval.last_update_ns = get_time_ns();
+  g_interval.last_faults = atomic_load(&g_manager.total_faults);
+  g_interval.last_samples = pebs_total_samples();
+
+  uint64_t interval = clamp_interval(POLICY_INTERVAL_MS * 1000000ULL);
+  atomic_store(&g_manager.policy_interval_ns, interval);
+  return interval;
+}
+
+/*
+ * Choose the period before the next cycle. `migrations` were executed
+ * this cycle, `backlog` candidates were left for later because the
+ * migration budget ran out, and the cycle's work took `cycle_ns` of CPU.
+ */
+uint64_t policy_interval_update(uint32_t migrations, uint32_t backlog,
+                                uint64_t cycle_ns) {
+  uint64_t now = get_time_ns();
+  uint64_t faults = atomic_load(&g_manager.total_faults);
+  uint64_t samples = pebs_total_samples();
+  double elapsed_s = (now - g_interval.last_update_ns) * 1e-9;
+  if (elapsed_s <= 0.0)
+    elapsed_s = 1e-9;
+
+  uint64_t new_faults = faults - g_interval.last_faults;
+  double fault_rate = new_faults / elapsed_s;
+  double sample_rate = (samples - g_interval.last_samples) / elapsed_s;
+  g_interval.last_update_ns = now;
+  g_interval.last_faults = faults;
+  g_interval.last_samples = samples;
+  g_interval.total_cycle_ns += cycle_ns;
+  g_interval.cycles++;
+
+  uint64_t interval = atomic_load(&g_manager.policy_interval_ns);
+  if (backlog > 0 || atomic_load(&g_manager.phase_boost) > 1 ||
+      fault_rate > INTERVAL_BUSY_FAULTS_PER_SEC ||
+      sample_rate > INTERVAL_BUSY_SAMPLES_PER_SEC) {
+    g_interval.quiet_cycles = 0;
+    uint64_t tighter = clamp_interval(interval / 2);
+    if (tighter < interval)
+      g_interval.tightened++;
+    interval = tighter;
+  } else if (new_faults == 0 && migrations == 0 &&
+             sample_rate < INTERVAL_QUIET_SAMPLES_PER_SEC) {
+    if (++g_interval.quiet_cycles >= INTERVAL_QUIET_CYCLES) {
+      g_interval.quiet_cycles = 0;
+      uint64_t looser = clamp_interval(interval + interval / 4);
+      if (looser > interval)
+        g_interval.relaxed++;
+      interval = looser;
+    }
+  } else {
+    g_interval.quiet_cycles = 0;
+  }
+
+  /* Bound manager overhead; the configured maximum still wins */
+  if (interval < cycle_ns * INTERVAL_MAX_DUTY_INV) {
+    interval = clamp_interval(cycle_ns * INTERVAL_MAX_DUTY_INV);
+    g_interval.cost_limited++;
+  }
+
+  atomic_store(&g_manager.policy_interval_ns, interval);
+  return interval;
+}
+
+/*============================================================================
+ * REPORTING
+ *===========================================================================*/
+
+void print_policy_interval_report(void) {
+  uint64_t interval = atomic_load(&g_manager.policy_interval_ns);
+  double mean_cycle_us =
+      g_interval.cycles > 0
+          ? g_interval.total_cycle_ns / 1e3 / g_interval.cycles
+          : 0.0;
+
+  printf("Policy interval: %.2fms (bounds %" PRIu32 "-%" PRIu32 "ms)"
+         "  tightened: %" PRIu64 "  relaxed: %" PRIu64
+         "  cost-limited: %" PRIu64 "  mean cycle CPU: %.1fus\n",
+         interval / 1e6, g_policy_config.interval_min_ms,
+         g_policy_config.interval_max_ms, g_interval.tightened,
+         g_interval.relaxed, g_interval.cost_limited, mean_cycle_us);
+}
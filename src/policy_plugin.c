@@ -0,0 +1,193 @@
+/*
+ * policy_plugin.c - Runtime-Loadable Native Policy Plugins
+ *
+ * Loads a migration policy from a shared object with dlopen(), so
+ * natively compiled models can be deployed without rebuilding or
+ * restarting the workload.
+ *
+ *   - Entry points are versioned (tm_policy_*_v<ABI>) and checked against
+ *     TM_POLICY_ABI_VERSION before anything is installed
+ *   - load_policy_plugin() resolves symbols in the caller's thread and
+ *     publishes the plugin as "pending"; the policy thread installs it at
+ *     the start of its next cycle, so a cycle never mixes two policies
+ *   - The previously active plugin is finalized and dlclose()d by the
+ *     policy thread once nothing can still be executing its code
+ *   - Unloading restores the policies that were active before the first
+ *     plugin (bandit, MLP, GBDT, an application policy...)
+ *
+ * LDOS Research Project, UT Austin
+ */
+
+#define _GNU_SOURCE
+#include "tiered_memory.h"
+#include <dlfcn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PLUGIN_ENV_VAR "TM_POLICY_PLUGIN"
+
+typedef struct policy_plugin {
+  char path[256];
+  void *handle;
+  migration_policy_fn decide;
+  migration_batch_policy_fn decide_batch;
+  int (*init)(void);
+  void (*fini)(void);
+} policy_plugin_t;
+
+/* Sentinel meaning "revert to the built-in default policy" */
+static policy_plugin_t g_unload_request;
+
+static _Atomic(policy_plugin_t *) g_pending_plugin = NULL;
+static policy_plugin_t *g_active_plugin = NULL; /* Policy thread only */
+
+/* Policies a plugin replaced, restored when none is active any more */
+static migration_policy_fn g_saved_policy;
+static migration_batch_policy_fn g_saved_batch_policy;
+
+static void restore_saved_policies(void) {
+  g_migration_policy =
+      g_saved_policy ? g_saved_policy : default_heuristic_policy;
+  g_batch_migration_policy = g_saved_batch_policy;
+}
+
+/*============================================================================
+ * LOADING
+ *===========================================================================*/
+
+static void destroy_plugin(policy_plugin_t *plugin) {
+  if (plugin == NULL || plugin == &g_unload_request)
+    return;
+  dlclose(plugin->handle);
+  free(plugin);
+}
+
+static policy_plugin_t *open_plugin(const char *path) {
+  void *handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+  if (handle == NULL) {
+    TM_ERROR("dlopen(%s) failed: %s", path, dlerror());
+    return NULL;
+  }
+
+  uint32_t (*abi_version)(void) =
+      (uint32_t(*)(void))dlsym(handle, "tm_policy_abi_version");
+  if (abi_version == NULL) {
+    TM_ERROR("%s: missing tm_policy_abi_version()", path);
+    dlclose(handle);
+    return NULL;
+  }
+  uint32_t version = abi_version();
+  if (version != TM_POLICY_ABI_VERSION) {
+    TM_ERROR("%s: ABI version %u, expected %u", path, version,
+             TM_POLICY_ABI_VERSION);
+    dlclose(handle);
+    return NULL;
+  }
+
+  policy_plugin_t *plugin = calloc(1, sizeof(*plugin));
+  if (plugin == NULL) {
+    dlclose(handle);
+    return NULL;
+  }
+  snprintf(plugin->path, sizeof(plugin->path), "%s", path);
+  plugin->handle = handle;
+  plugin->decide = (migration_policy_fn)dlsym(handle, "tm_policy_decide_v1");
+  plugin->decide_batch =
+      (migration_batch_policy_fn)dlsym(handle, "tm_policy_decide_batch_v1");
+  plugin->init = (int (*)(void))dlsym(handle, "tm_policy_init_v1");
+  plugin->fini = (void (*)(void))dlsym(handle, "tm_policy_fini_v1");
+
+  if (plugin->decide == NULL && plugin->decide_batch == NULL) {
+    TM_ERROR("%s: exports neither tm_policy_decide_v1 nor "
+             "tm_policy_decide_batch_v1",
+             path);
+    destroy_plugin(plugin);
+    return NULL;
+  }
+  return plugin;
+}
+
+static void publish_pending(policy_plugin_t *plugin) {
+  /* A newer request supersedes one the policy thread has not picked up */
+  policy_plugin_t *superseded = atomic_exchange(&g_pending_plugin, plugin);
+  destroy_plugin(superseded);
+}
+
+int load_policy_plugin(const char *path) {
+  if (path == NULL || path[0] == '\0')
+    return -1;
+
+  policy_plugin_t *plugin = open_plugin(path);
+  if (plugin == NULL)
+    return -1;
+
+  publish_pending(plugin);
+  TM_INFO("Policy plugin %s loaded (%s%s), active from next cycle", path,
+          plugin->decide ? "per-page" : "",
+          plugin->decide_batch ? (plugin->decide ? "+batch" : "batch") : "");
+  return 0;
+}
+
+void unload_policy_plugin(void) { publish_pending(&g_unload_request); }
+
+/*============================================================================
+ * POLICY THREAD HOOKS
+ *===========================================================================*/
+
+/* Install a pending plugin; called by the policy thread between cycles */
+void policy_plugin_apply_pending(void) {
+  policy_plugin_t *next = atomic_exchange(&g_pending_plugin, NULL);
+  if (next == NULL)
+    return;
+
+  if (next != &g_unload_request && next->init != NULL && next->init() != 0) {
+    TM_ERROR("%s: tm_policy_init_v1() failed, keeping current policy",
+             next->path);
+    destroy_plugin(next);
+    return;
+  }
+
+  policy_plugin_t *prev = g_active_plugin;
+  if (next == &g_unload_request) {
+    if (prev == NULL)
+      return; /* Nothing loaded: keep the current policies */
+    g_active_plugin = NULL;
+    restore_saved_policies();
+    TM_INFO("Policy plugin unloaded, previous policy restored");
+  } else {
+    if (prev == NULL) {
+      g_saved_policy = g_migration_policy;
+      g_saved_batch_policy = g_batch_migration_policy;
+    }
+    g_active_plugin = next;
+    g_batch_migration_policy = next->decide_batch;
+    g_migration_policy = next->decide ? next->decide : default_heuristic_policy;
+    TM_INFO("Policy plugin %s active", next->path);
+  }
+
+  if (prev != NULL) {
+    if (prev->fini != NULL)
+      prev->fini();
+    destroy_plugin(prev);
+  }
+}
+
+/* Load TM_POLICY_PLUGIN, if set, before the policy thread starts */
+void policy_plugin_load_from_env(void) {
+  const char *path = getenv(PLUGIN_ENV_VAR);
+  if (path != NULL && path[0] != '\0')
+    load_policy_plugin(path);
+}
+
+/* Finalize and release whatever plugin is active or pending at shutdown */
+void policy_plugin_shutdown(void) {
+  destroy_plugin(atomic_exchange(&g_pending_plugin, NULL));
+  if (g_active_plugin != NULL) {
+    if (g_active_plugin->fini != NULL)
+      g_active_plugin->fini();
+    destroy_plugin(g_active_plugin);
+    g_active_plugin = NULL;
+    restore_saved_policies();
+  }
+}
@@ -1,10 +1,16 @@
 /*
  * policy_thread.c - Migration Policy Thread
  *
- * Background thread that wakes every 10ms to:
+ * Background thread that wakes on absolute deadlines every 2-100ms
+ * (adapted to load by policy_interval.c) to:
  *   1. Update page features (heat scores, access rates)
  *   2. Run migration policy (heuristic or ML-based)
- *   3. Execute tier migrations for hot/cold pages
+ *   3. Hand accepted migrations to the promotion and demotion stages
+ *      (migration_stages.c), which execute the highest estimated net
+ *      benefit (cost_model.h) first, each within its own budget
+ *
+ * Steps 1-2 run under a per-cycle CPU budget: when it is spent the
+ * current step yields and resumes from the same bucket next cycle.
  *
  * ML Integration Point: predict_migration() and set_migration_policy()
  *
@@ -12,6 +18,12 @@
  */
 
 #define _GNU_SOURCE
+#include "bandit.h"
+#include "dataset_export.h"
+#include "decision_audit.h"
+#include "gbdt.h"
+#include "mlp.h"
+#include "qmlp.h"
 #include "pebs.h"
 #include "tiered_memory.h"
 #include <errno.h>
@@ -23,7 +35,7 @@
 #include <unistd.h>
 
 migration_policy_fn g_migration_policy = NULL;
-static FILE *g_csv_file = NULL;
+migration_batch_policy_fn g_batch_migration_policy = NULL;
 static const char *g_csv_label = "default";
 
 void set_csv_label(const char *label) {
@@ -32,44 +44,60 @@ void set_csv_label(const char *label) {
 
 static void *policy_thread_loop(void *arg);
 
-static void export_page_stats_to_csv(uint64_t cycle) {
-    if (!g_csv_file) return;
-    
-    uint64_t now = get_time_ns();
-    pthread_rwlock_rdlock(&g_manager.stats_lock);
-    for (size_t i = 0; i < PAGE_STATS_HASH_SIZE; i++) {
-        page_stats_t *entry = g_manager.page_stats_table[i];
-        while (entry != NULL) {
-            if (entry->access_count > 0) {
-                fprintf(g_csv_file, "%" PRIu64 ",%" PRIu64 ",%p,%d,%f,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu32 "\n",
-                        cycle, now, entry->page_addr, entry->current_tier, 
-                        entry->heat_score, entry->access_count, 
-                        entry->read_count, entry->write_count, entry->migration_count);
-            }
-            entry = entry->next;
-        }
-    }
-    pthread_rwlock_unlock(&g_manager.stats_lock);
-}
+/* Shadow evaluation hooks (shadow_policy.c) */
+extern void shadow_policy_observe(const page_stats_t *stats, bool active_acted,
+                                  const migration_decision_t *active,
+                                  uint64_t cycle);
+extern void shadow_policy_end_cycle(uint64_t cycle);
+
+/* Adaptive period hooks (policy_interval.c) */
+extern uint64_t policy_interval_init(void);
+extern uint64_t policy_interval_update(uint32_t migrations, uint32_t backlog,
+                                       uint64_t cycle_ns);
+
+/* Promotion/demotion stage hooks (migration_stages.c) */
+extern void migration_stages_offer(const page_stats_t *stats,
+                                   const migration_decision_t *decision);
+extern void migration_stages_end_cycle(bool pass_complete);
+extern void migration_stages_collect(uint32_t *migrations, uint32_t *backlog);
+extern int migration_stages_start(void);
+extern void migration_stages_stop(void);
+
+/* Working-set phase changes (phase_detector.c) */
+extern void phase_detector_update(void);
+
+/* Runtime control hooks (control_socket.c) */
+extern void control_socket_apply_pending(void);
+
+/* Plugin hot-swap hooks (policy_plugin.c) */
+extern void policy_plugin_apply_pending(void);
+extern void policy_plugin_load_from_env(void);
+extern void policy_plugin_shutdown(void);
 
 /*============================================================================
  * POLICY CONFIGURATION
  *===========================================================================*/
 
-typedef struct policy_config {
-  double hot_threshold;  /* Heat > this -> promote */
-  double cold_threshold; /* Heat < this -> demote */
-  double confidence_min;
-  uint64_t min_residence_ns; /* Anti-thrashing: min time before migration */
-  uint32_t max_migrations_per_cycle;
-} policy_config_t;
-
-static policy_config_t g_policy_config = {.hot_threshold = 0.7,
+policy_config_t g_policy_config = {.hot_threshold = 0.7,
                                           .cold_threshold = 0.3,
                                           .confidence_min = 0.5,
                                           .min_residence_ns =
                                               100000000, /* 100ms */
-                                          .max_migrations_per_cycle = 10};
+                                          .max_migrations_per_cycle = 10,
+                                          .max_demotions_per_batch = 64,
+                                          .demotion_interval_ms = 100,
+                                          .swap_when_full = true,
+                                          .swap_margin = 0.1,
+                                          .interval_min_ms = 2,
+                                          .interval_max_ms = 100,
+                                          .cycle_budget_pct = 20,
+                                          .benefit_horizon_ns =
+                                              1000000000, /* 1s */
+                                          .heat_decay_per_s = 0.07,
+                                          .phase_boost_factor = 4,
+                                          .export_heat_epsilon = 0.05,
+                                          .export_keyframe_interval = 20,
+                                          .uffd_threads = 1};
 
 /*============================================================================
  * DEFAULT HEURISTIC POLICY
@@ -82,12 +110,9 @@ bool default_heuristic_policy(const page_stats_t *stats,
 
   uint64_t now = get_time_ns();
 
-  /* Anti-thrashing: don't migrate recently migrated pages */
-  if (stats->last_migration_ns > 0) {
-    if (now - stats->last_migration_ns < g_policy_config.min_residence_ns) {
-      return false;
-    }
-  }
+  /* Anti-thrashing: don't migrate recently migrated (or bouncing) pages */
+  if (!page_residence_elapsed(stats, now))
+    return false;
 
   decision->page_addr = stats->page_addr;
   decision->from_tier = stats->current_tier;
@@ -119,9 +144,15 @@ bool default_heuristic_policy(const page_stats_t *stats,
 
 void set_migration_policy(migration_policy_fn policy) {
   g_migration_policy = policy ? policy : default_heuristic_policy;
+  g_batch_migration_policy = NULL;
   TM_INFO("Migration policy %s", policy ? "updated" : "reset to default");
 }
 
+void set_batch_migration_policy(migration_batch_policy_fn policy) {
+  g_batch_migration_policy = policy;
+  TM_INFO("Batch migration policy %s", policy ? "set" : "cleared");
+}
+
 /*
  * Main prediction function - replace internals with your ML model.
  *
@@ -143,36 +174,346 @@ bool predict_migration(const page_stats_t *stats,
  * MIGRATION EXECUTION
  *===========================================================================*/
 
-static int execute_migration(migration_decision_t *decision) {
-  if (decision == NULL)
-    return -1;
+static int apply_migration(migration_decision_t *decision) {
+
+  if (atomic_load(&g_manager.migrations_paused))
+    return MIGRATION_ERR_PAUSED;
 
   page_stats_t *stats = get_page_stats(decision->page_addr);
   if (stats == NULL) {
     TM_ERROR("No stats for page %p", decision->page_addr);
-    return -1;
+    return MIGRATION_ERR_NO_STATS;
   }
 
   tier_config_t *dest = &g_manager.tiers[decision->to_tier];
   tier_config_t *src = &g_manager.tiers[decision->from_tier];
 
-  if (dest->used + PAGE_SIZE > dest->capacity) {
-    TM_DEBUG("Destination tier %s full", dest->name);
-    return -1;
+  uint64_t now = get_time_ns();
+  pthread_mutex_lock(&g_manager.migration_lock);
+  if (stats->current_tier != decision->from_tier) {
+    pthread_mutex_unlock(&g_manager.migration_lock);
+    return MIGRATION_ERR_STALE;
+  }
+  /* Policies check min_residence_ns; the per-page backoff binds them all */
+  if (stats->residence_ns != 0 && !page_residence_elapsed(stats, now)) {
+    pthread_mutex_unlock(&g_manager.migration_lock);
+    return MIGRATION_ERR_BACKOFF;
   }
-
   /* Update tier usage (in real system, would copy data here) */
-  src->used -= PAGE_SIZE;
-  dest->used += PAGE_SIZE;
+  if (!tier_reserve_page(dest)) {
+    pthread_mutex_unlock(&g_manager.migration_lock);
+    TM_DEBUG("Destination tier %s full", dest->name);
+    return MIGRATION_ERR_TIER_FULL;
+  }
+  atomic_fetch_sub(&src->used, PAGE_SIZE);
 
-  stats->current_tier = decision->to_tier;
-  stats->last_migration_ns = get_time_ns();
-  stats->migration_count++;
+  record_page_migration(stats, decision->to_tier, now);
+  pthread_mutex_unlock(&g_manager.migration_lock);
 
   atomic_fetch_add(&g_manager.total_migrations, 1);
   TM_DEBUG("Migrated %p: %s -> %s (%s)", decision->page_addr, src->name,
            dest->name, decision->reason);
-  return 0;
+  return MIGRATION_OK;
+}
+
+int execute_migration(migration_decision_t *decision) {
+  if (decision == NULL)
+    return MIGRATION_ERR_NO_STATS;
+
+  int result = apply_migration(decision);
+  decision_audit_record(decision, result);
+  return result;
+}
+
+/*============================================================================
+ * CYCLE SCHEDULER
+ *===========================================================================*/
+
+#define BUDGET_CHECK_BUCKETS 16384 /* Hash buckets walked between budget checks */
+
+/*
+ * One pass over the page table, split into phases that can stop when the
+ * cycle's CPU budget runs out and continue from the same bucket on the
+ * next cycle. At most one pass completes per cycle.
+ */
+typedef enum {
+  PHASE_FEATURES = 0, /* Heat scores and access rates */
+  PHASE_SCAN,         /* Policy decisions, queued to the migration stages */
+  PHASE_COUNT
+} cycle_phase_t;
+
+static const char *const g_phase_names[PHASE_COUNT] = {"features", "scan"};
+
+/* CPU time the policy thread may spend in the current cycle */
+typedef struct cycle_budget {
+  uint64_t cpu_start_ns;
+  uint64_t limit_ns; /* 0: unlimited */
+  bool exhausted;
+} cycle_budget_t;
+
+static struct {
+  cycle_phase_t phase; /* Where the current pass resumes */
+  size_t bucket;
+  page_stats_t *entry; /* Batch scan: position within the bucket's chain */
+
+  /* Reporting */
+  uint64_t passes;
+  uint64_t yields[PHASE_COUNT];
+  uint64_t overruns; /* Cycles that used more CPU than budgeted */
+  uint64_t max_overrun_ns;
+  uint64_t missed_deadlines; /* Periods skipped because a cycle ran late */
+  uint64_t forced_scans;     /* Passes requested through policy_thread_request_scan() */
+
+  /* Dataset export runs beside the pass, under the same budget */
+  bool export_active;
+  size_t export_bucket;
+  uint64_t export_cycle; /* Cycle the current snapshot started in */
+  uint64_t export_yields;
+} g_sched;
+
+static uint64_t thread_cpu_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void cycle_budget_start(cycle_budget_t *budget, uint64_t interval_ns) {
+  budget->cpu_start_ns = thread_cpu_ns();
+  budget->limit_ns = interval_ns * g_policy_config.cycle_budget_pct / 100;
+  budget->exhausted = false;
+}
+
+static bool cycle_budget_exhausted(cycle_budget_t *budget) {
+  if (budget->limit_ns == 0 || budget->exhausted)
+    return budget->exhausted;
+  budget->exhausted =
+      thread_cpu_ns() - budget->cpu_start_ns >= budget->limit_ns;
+  return budget->exhausted;
+}
+
+/* Record any overrun; returns the CPU time the cycle used */
+static uint64_t cycle_budget_finish(const cycle_budget_t *budget) {
+  uint64_t used = thread_cpu_ns() - budget->cpu_start_ns;
+  if (budget->limit_ns == 0 || used <= budget->limit_ns)
+    return used;
+  g_sched.overruns++;
+  if (used - budget->limit_ns > g_sched.max_overrun_ns)
+    g_sched.max_overrun_ns = used - budget->limit_ns;
+  return used;
+}
+
+/* Wakes the policy thread before its deadline: requested scans, shutdown */
+static pthread_mutex_t g_wake_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_wake_cond; /* CLOCK_MONOTONIC, see start_policy_thread() */
+static bool g_scan_requested;
+
+/*
+ * Sleep until the absolute CLOCK_MONOTONIC time `deadline_ns`, or until a
+ * scan is requested. Returns true if woken for a requested scan.
+ */
+static bool sleep_until(uint64_t deadline_ns) {
+  struct timespec ts = {.tv_sec = deadline_ns / 1000000000ULL,
+                        .tv_nsec = deadline_ns % 1000000000ULL};
+  pthread_mutex_lock(&g_wake_lock);
+  while (!g_scan_requested && g_manager.threads_running &&
+         pthread_cond_timedwait(&g_wake_cond, &g_wake_lock, &ts) != ETIMEDOUT)
+    ;
+  bool requested = g_scan_requested;
+  g_scan_requested = false;
+  pthread_mutex_unlock(&g_wake_lock);
+  return requested;
+}
+
+/* Run a complete pass now, from the start of the table and without budget */
+void policy_thread_request_scan(void) {
+  pthread_mutex_lock(&g_wake_lock);
+  g_scan_requested = true;
+  pthread_cond_signal(&g_wake_cond);
+  pthread_mutex_unlock(&g_wake_lock);
+}
+
+/* Push buffered dataset rows to the file */
+void policy_thread_flush_dataset(void) { dataset_export_flush(); }
+
+/* Returns true once the sweep has reached the end of the table */
+static bool run_features_phase(cycle_budget_t *budget) {
+  while (g_sched.bucket < PAGE_STATS_HASH_SIZE) {
+    if (cycle_budget_exhausted(budget))
+      return false;
+    size_t end = g_sched.bucket + BUDGET_CHECK_BUCKETS;
+    update_page_features_range(g_sched.bucket, end);
+    g_sched.bucket = end < PAGE_STATS_HASH_SIZE ? end : PAGE_STATS_HASH_SIZE;
+  }
+  return true;
+}
+
+/*
+ * A dataset snapshot starts every 5 cycles (50ms at POLICY_INTERVAL_MS).
+ * Under budget pressure it is written over several cycles; each row
+ * carries the snapshot's start cycle, so a cycle value always names one
+ * whole snapshot, and the timestamp at which it was actually sampled.
+ * In incremental mode only keyframe snapshots cover every page.
+ */
+static void run_export_job(uint64_t cycle, cycle_budget_t *budget) {
+  if (!dataset_export_active())
+    return;
+  if (!g_sched.export_active) {
+    if (cycle % 5 != 0)
+      return;
+    g_sched.export_active = true;
+    g_sched.export_bucket = 0;
+    g_sched.export_cycle = cycle;
+    dataset_export_begin_snapshot();
+  }
+
+  while (g_sched.export_bucket < PAGE_STATS_HASH_SIZE) {
+    if (cycle_budget_exhausted(budget)) {
+      g_sched.export_yields++;
+      return;
+    }
+    size_t end = g_sched.export_bucket + BUDGET_CHECK_BUCKETS;
+    dataset_export_range(g_sched.export_cycle, g_sched.export_bucket, end);
+    g_sched.export_bucket =
+        end < PAGE_STATS_HASH_SIZE ? end : PAGE_STATS_HASH_SIZE;
+  }
+  g_sched.export_active = false;
+}
+
+/*============================================================================
+ * DECISION SCAN
+ *===========================================================================*/
+
+#define BATCH_CHUNK_PAGES 4096 /* Pages handed to a batch policy per call */
+
+/* Per-cycle state shared by the per-page and batch scans */
+typedef struct scan_state {
+  uint64_t cycle;
+} scan_state_t;
+
+/*
+ * Scan from the scheduler's bucket, queueing accepted decisions on the
+ * migration stages. Returns false if the CPU budget ran out first
+ * (the position is kept).
+ */
+static bool run_per_page_scan(scan_state_t *scan, cycle_budget_t *budget) {
+  size_t i = g_sched.bucket;
+  pthread_rwlock_rdlock(&g_manager.stats_lock);
+
+  for (; i < PAGE_STATS_HASH_SIZE; i++) {
+    if (i % BUDGET_CHECK_BUCKETS == 0 && i != g_sched.bucket &&
+        cycle_budget_exhausted(budget)) {
+      pthread_rwlock_unlock(&g_manager.stats_lock);
+      g_sched.bucket = i;
+      return false;
+    }
+
+    page_stats_t *entry = g_manager.page_stats_table[i];
+    for (; entry != NULL; entry = entry->next) {
+      migration_decision_t decision = {0};
+
+      bool act = predict_migration(entry, &decision) &&
+                 decision.confidence >= g_policy_config.confidence_min;
+      shadow_policy_observe(entry, act, &decision, scan->cycle);
+
+      if (act)
+        migration_stages_offer(entry, &decision);
+    }
+  }
+  pthread_rwlock_unlock(&g_manager.stats_lock);
+  return true;
+}
+
+/*
+ * Hand pages to the batch policy in chunks of BATCH_CHUNK_PAGES. Entries
+ * are only freed at shutdown and new ones are pushed at chain heads, so
+ * the pointers and the `resume` position stay valid after unlocking, and
+ * across cycles when the CPU budget interrupts the scan (returns false).
+ */
+static bool run_batch_scan(scan_state_t *scan, migration_batch_policy_fn batch,
+                           cycle_budget_t *budget) {
+  static const page_stats_t *pages[BATCH_CHUNK_PAGES];
+  static migration_decision_t decisions[BATCH_CHUNK_PAGES];
+  static const migration_decision_t no_decision = {0};
+
+  size_t bucket = g_sched.bucket;
+  page_stats_t *resume = g_sched.entry;
+
+  while (bucket < PAGE_STATS_HASH_SIZE) {
+    if (cycle_budget_exhausted(budget)) {
+      g_sched.bucket = bucket;
+      g_sched.entry = resume;
+      return false;
+    }
+
+    size_t count = 0;
+    pthread_rwlock_rdlock(&g_manager.stats_lock);
+    while (bucket < PAGE_STATS_HASH_SIZE && count < BATCH_CHUNK_PAGES) {
+      page_stats_t *entry =
+          resume ? resume : g_manager.page_stats_table[bucket];
+      while (entry != NULL && count < BATCH_CHUNK_PAGES) {
+        pages[count++] = entry;
+        entry = entry->next;
+      }
+      resume = entry;
+      if (resume == NULL)
+        bucket++;
+    }
+    pthread_rwlock_unlock(&g_manager.stats_lock);
+
+    if (count == 0)
+      break;
+
+    size_t ndecisions = batch(pages, count, decisions, BATCH_CHUNK_PAGES);
+    if (ndecisions > BATCH_CHUNK_PAGES)
+      ndecisions = BATCH_CHUNK_PAGES;
+
+    /* Decisions arrive in page order: walk both lists together */
+    size_t d = 0;
+    for (size_t p = 0; p < count; p++) {
+      migration_decision_t *decision = NULL;
+      if (d < ndecisions && decisions[d].page_addr == pages[p]->page_addr)
+        decision = &decisions[d++];
+
+      bool act = decision != NULL &&
+                 decision->confidence >= g_policy_config.confidence_min;
+      shadow_policy_observe(pages[p], act, decision ? decision : &no_decision,
+                            scan->cycle);
+
+      if (act)
+        migration_stages_offer(pages[p], decision);
+    }
+  }
+  return true;
+}
+
+/*
+ * Run the current pass's phases until the pass completes or the CPU
+ * budget runs out; the next cycle picks up where this one stopped.
+ * Returns true if a pass completed.
+ */
+static bool run_cycle_phases(scan_state_t *scan, cycle_budget_t *budget) {
+  for (;;) {
+    bool done;
+    if (g_sched.phase == PHASE_FEATURES) {
+      done = run_features_phase(budget);
+    } else {
+      migration_batch_policy_fn batch_policy = g_batch_migration_policy;
+      done = batch_policy != NULL ? run_batch_scan(scan, batch_policy, budget)
+                                  : run_per_page_scan(scan, budget);
+    }
+    if (!done) {
+      g_sched.yields[g_sched.phase]++;
+      return false;
+    }
+
+    g_sched.bucket = 0;
+    g_sched.entry = NULL;
+    if (++g_sched.phase == PHASE_COUNT) {
+      g_sched.phase = PHASE_FEATURES;
+      g_sched.passes++;
+      return true;
+    }
+  }
 }
 
 /*============================================================================
@@ -181,61 +522,73 @@ static int execute_migration(migration_decision_t *decision) {
 
 static void *policy_thread_loop(void *arg) {
   (void)arg;
-  TM_INFO("Policy thread running (interval=%dms)", POLICY_INTERVAL_MS);
+  uint64_t interval_ns = policy_interval_init();
+  uint64_t last_log_ns = get_time_ns();
+  TM_INFO("Policy thread running (interval=%" PRIu64 "ms, adaptive %" PRIu32
+          "-%" PRIu32 "ms, CPU budget %" PRIu32 "%%)",
+          interval_ns / 1000000, g_policy_config.interval_min_ms,
+          g_policy_config.interval_max_ms, g_policy_config.cycle_budget_pct);
 
-  struct timespec sleep_time = {.tv_sec = 0,
-                                .tv_nsec = POLICY_INTERVAL_MS * 1000000L};
+  /* Cycles start on absolute deadlines, so their cost does not add drift */
+  uint64_t deadline = last_log_ns + interval_ns;
 
   while (g_manager.threads_running) {
-    nanosleep(&sleep_time, NULL);
+    bool forced = sleep_until(deadline);
     if (!g_manager.threads_running)
       break;
 
-    atomic_fetch_add(&g_manager.policy_cycles, 1);
+    uint64_t cycle = atomic_fetch_add(&g_manager.policy_cycles, 1) + 1;
+    cycle_budget_t budget;
+    cycle_budget_start(&budget, interval_ns);
+    if (forced) {
+      g_sched.phase = PHASE_FEATURES;
+      g_sched.bucket = 0;
+      g_sched.entry = NULL;
+      budget.limit_ns = 0;
+      g_sched.forced_scans++;
+    }
+
+    /* Hot-swap a newly loaded plugin and apply control-socket updates
+     * before any decisions this cycle */
+    policy_plugin_apply_pending();
+    control_socket_apply_pending();
 
     /* Merge PEBS hardware samples with page stats */
     pebs_merge_with_page_stats();
+    phase_detector_update();
 
-    update_all_page_features();
+    scan_state_t scan = {.cycle = cycle};
+    bool pass_complete = run_cycle_phases(&scan, &budget);
+    migration_stages_end_cycle(pass_complete);
 
-    uint32_t migrations = 0;
-    pthread_rwlock_rdlock(&g_manager.stats_lock);
+    shadow_policy_end_cycle(cycle);
 
-    for (size_t i = 0; i < PAGE_STATS_HASH_SIZE &&
-                       migrations < g_policy_config.max_migrations_per_cycle;
-         i++) {
-
-      page_stats_t *entry = g_manager.page_stats_table[i];
-      while (entry != NULL &&
-             migrations < g_policy_config.max_migrations_per_cycle) {
-        migration_decision_t decision = {0};
-
-        if (predict_migration(entry, &decision) &&
-            decision.confidence >= g_policy_config.confidence_min) {
-          pthread_rwlock_unlock(&g_manager.stats_lock);
-          if (execute_migration(&decision) == 0)
-            migrations++;
-          pthread_rwlock_rdlock(&g_manager.stats_lock);
-        }
-        entry = entry->next;
-      }
-    }
-    pthread_rwlock_unlock(&g_manager.stats_lock);
+    run_export_job(cycle, &budget);
 
-    uint64_t cycles = atomic_load(&g_manager.policy_cycles);
+    uint64_t cycle_cpu_ns = cycle_budget_finish(&budget);
+    uint64_t cycle_end = get_time_ns();
+    uint32_t migrations, backlog;
+    migration_stages_collect(&migrations, &backlog);
+    interval_ns = policy_interval_update(migrations, backlog, cycle_cpu_ns);
 
-    /* Export dataset every 5 cycles (50ms) */
-    if (cycles % 5 == 0) {
-        export_page_stats_to_csv(cycles);
+    /* Ran past the next deadline: skip the missed periods, keep the phase */
+    deadline += interval_ns;
+    if (deadline <= cycle_end) {
+      uint64_t missed = (cycle_end - deadline) / interval_ns + 1;
+      g_sched.missed_deadlines += missed;
+      deadline += missed * interval_ns;
     }
 
-    /* Periodic logging (~1 second) */
-    if (cycles % 100 == 0) {
+    /* Periodic logging (~1 second; the cycle period varies) */
+    if (cycle_end - last_log_ns >= 1000000000ULL) {
+      last_log_ns = cycle_end;
       TM_INFO("Cycle %" PRIu64 ": pages=%" PRIu64 " faults=%" PRIu64
-              " migrations=%" PRIu64,
-              cycles, (uint64_t)atomic_load(&g_manager.total_pages_tracked),
+              " migrations=%" PRIu64 " swaps=%" PRIu64 " interval=%.2fms",
+              cycle, (uint64_t)atomic_load(&g_manager.total_pages_tracked),
               (uint64_t)atomic_load(&g_manager.total_faults),
-              (uint64_t)atomic_load(&g_manager.total_migrations));
+              (uint64_t)atomic_load(&g_manager.total_migrations),
+              (uint64_t)atomic_load(&g_manager.total_swaps),
+              interval_ns / 1e6);
     }
   }
 
@@ -243,18 +596,88 @@ static void *policy_thread_loop(void *arg) {
   return NULL;
 }
 
+void print_policy_scheduler_report(void) {
+  printf("Policy scheduler: CPU budget %" PRIu32 "%% of period, %" PRIu64
+         " passes, yields:",
+         g_policy_config.cycle_budget_pct, g_sched.passes);
+  for (int p = 0; p < PHASE_COUNT; p++)
+    printf(" %s=%" PRIu64, g_phase_names[p], g_sched.yields[p]);
+  printf(" export=%" PRIu64, g_sched.export_yields);
+  printf("\n  Budget overruns: %" PRIu64 " (max %.1fus)"
+         "  missed deadlines: %" PRIu64 "  forced scans: %" PRIu64 "\n",
+         g_sched.overruns, g_sched.max_overrun_ns / 1e3,
+         g_sched.missed_deadlines, g_sched.forced_scans);
+}
+
+static bool env_is_set(const char *name) {
+  const char *value = getenv(name);
+  return value != NULL && value[0] != '\0';
+}
+
+/*
+ * A model compiled in with GBDT_MODEL is a default, not an override: it is
+ * installed only if neither the application nor the environment chose a
+ * policy. TM_GBDT_POLICY=1 installs it regardless, =0 never.
+ */
+static bool gbdt_policy_wanted(void) {
+  if (&tm_gbdt_model == NULL)
+    return false;
+  const char *env = getenv("TM_GBDT_POLICY");
+  if (env != NULL && env[0] != '\0')
+    return env[0] != '0';
+  return g_migration_policy == default_heuristic_policy &&
+         g_batch_migration_policy == NULL && !env_is_set("TM_POLICY_PLUGIN");
+}
+
+static void log_startup_policy(void) {
+  if (env_is_set("TM_POLICY_PLUGIN"))
+    TM_INFO("Policy: plugin %s (from the first cycle)",
+            getenv("TM_POLICY_PLUGIN"));
+  else if (g_batch_migration_policy == gbdt_batch_policy)
+    TM_INFO("Policy: compiled GBDT ensemble (batch)");
+  else if (g_batch_migration_policy == qmlp_batch_policy)
+    TM_INFO("Policy: int8 MLP (batch)");
+  else if (g_batch_migration_policy == mlp_batch_policy)
+    TM_INFO("Policy: MLP (batch)");
+  else if (g_batch_migration_policy != NULL)
+    TM_INFO("Policy: application batch policy");
+  else if (g_migration_policy == bandit_policy)
+    TM_INFO("Policy: online bandit");
+  else if (g_migration_policy == default_heuristic_policy)
+    TM_INFO("Policy: default heuristic");
+  else
+    TM_INFO("Policy: application per-page policy");
+}
+
 int start_policy_thread(void) {
   if (g_migration_policy == NULL) {
     g_migration_policy = default_heuristic_policy;
   }
-
-  char csv_filename[256];
-  snprintf(csv_filename, sizeof(csv_filename), "ml_dataset_%s.csv", g_csv_label);
-  g_csv_file = fopen(csv_filename, "w");
-  if (g_csv_file) {
-      fprintf(g_csv_file, "cycle,timestamp_ns,page_addr,current_tier,heat_score,access_count,read_count,write_count,migration_count\n");
-      TM_INFO("CSV output: %s", csv_filename);
+  const char *bandit = getenv("TM_BANDIT_POLICY");
+  if (bandit != NULL && bandit[0] != '\0' && bandit[0] != '0')
+    set_migration_policy(bandit_policy); /* Learns online from outcomes */
+  const char *mlp_model = getenv("TM_MLP_MODEL");
+  const char *mlp_calibration = getenv("TM_MLP_CALIBRATION");
+  if (mlp_model != NULL && mlp_model[0] != '\0') {
+    if (mlp_calibration != NULL && mlp_calibration[0] != '\0')
+      qmlp_policy_load(mlp_model, mlp_calibration); /* int8 runtime */
+    else
+      mlp_policy_load(mlp_model);
   }
+  if (gbdt_policy_wanted())
+    gbdt_policy_install(); /* Built with GBDT_MODEL */
+  policy_plugin_load_from_env();
+  log_startup_policy();
+
+  dataset_export_start(g_csv_label);
+
+  pthread_condattr_t wake_attr;
+  pthread_condattr_init(&wake_attr);
+  pthread_condattr_setclock(&wake_attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&g_wake_cond, &wake_attr);
+  pthread_condattr_destroy(&wake_attr);
+
+  migration_stages_start();
 
   if (pthread_create(&g_manager.policy_thread, NULL, policy_thread_loop,
                      NULL) != 0) {
@@ -266,10 +689,15 @@ int start_policy_thread(void) {
 }
 
 void stop_policy_thread(void) {
+  /* Wake the thread so it observes threads_running == false promptly */
+  pthread_mutex_lock(&g_wake_lock);
+  pthread_cond_signal(&g_wake_cond);
+  pthread_mutex_unlock(&g_wake_lock);
+
   pthread_join(g_manager.policy_thread, NULL);
-  if (g_csv_file) {
-      fclose(g_csv_file);
-      g_csv_file = NULL;
-  }
+  pthread_cond_destroy(&g_wake_cond);
+  migration_stages_stop();
+  policy_plugin_shutdown();
+  dataset_export_stop();
   TM_INFO("Policy thread stopped");
 }
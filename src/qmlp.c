@@ -0,0 +1,731 @@
+/*
+ * qmlp.c - Quantized (int8) MLP Runtime
+ *
+ * Calibration, quantization and integer kernels for the built-in MLP.
+ * See qmlp.h for the number formats.
+ *
+ * Activation layout: a block of FEATURE_BLOCK pages is stored as
+ * uint32_t[groups][FEATURE_BLOCK], where byte b of element [g][p] is
+ * input 4g+b of page p. One 256-bit register then holds four inputs of
+ * eight pages, which is exactly the operand shape of vpdpbusd /
+ * vpmaddubsw against a broadcast group of four weights.
+ *
+ * LDOS Research Project, UT Austin
+ */
+
+#define _GNU_SOURCE
+#include "qmlp.h"
+#include <errno.h>
+#include <inttypes.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define QMLP_HAVE_AVX2_KERNEL 1
+#if defined(__GNUC__) && __GNUC__ >= 11
+#define QMLP_HAVE_VNNI_KERNEL 1 /* _mm256_dpbusd_avx_epi32 */
+#else
+#define QMLP_HAVE_VNNI_KERNEL 0
+#endif
+#else
+#define QMLP_HAVE_AVX2_KERNEL 0
+#define QMLP_HAVE_VNNI_KERNEL 0
+#endif
+
+#define QMLP_MAX_GROUPS (MLP_MAX_WIDTH / QMLP_GROUP)
+#define QMLP_INPUT_GROUPS ((TM_FEATURE_COUNT + QMLP_GROUP - 1) / QMLP_GROUP)
+
+/* One layer over a block; `logits` is non-NULL for the last layer only */
+typedef void (*qdense_kernel_fn)(const qmlp_layer_t *layer, const uint32_t *in,
+                                 uint32_t *out, float *logits);
+typedef void (*quantize_input_fn)(const qmlp_model_t *model, const float *in,
+                                  uint32_t *out);
+
+static qdense_kernel_fn g_qdense_kernel = NULL;
+static quantize_input_fn g_quantize_input = NULL;
+static const char *g_kernel_name = "scalar";
+static pthread_once_t g_kernel_once = PTHREAD_ONCE_INIT;
+
+/*============================================================================
+ * SCALAR KERNEL
+ *===========================================================================*/
+
+static inline uint32_t quantize_scalar(float v) {
+  long q = lrintf(v);
+  return q < 0 ? 0 : q > QMLP_QMAX ? QMLP_QMAX : (uint32_t)q;
+}
+
+static void quantize_input_scalar(const qmlp_model_t *model, const float *in,
+                                  uint32_t *out) {
+  memset(out, 0, sizeof(uint32_t) * QMLP_INPUT_GROUPS * FEATURE_BLOCK);
+  for (int f = 0; f < TM_FEATURE_COUNT; f++)
+    for (int p = 0; p < FEATURE_BLOCK; p++)
+      out[(f / QMLP_GROUP) * FEATURE_BLOCK + p] |=
+          quantize_scalar(in[f * FEATURE_BLOCK + p] * model->input_scale[f] +
+                          model->input_offset[f])
+          << (8 * (f % QMLP_GROUP));
+}
+
+static void qdense_scalar(const qmlp_layer_t *layer, const uint32_t *in,
+                          uint32_t *out, float *logits) {
+  size_t row = (size_t)layer->n_groups * QMLP_GROUP;
+  int32_t x[MLP_MAX_WIDTH][FEATURE_BLOCK];
+  for (size_t i = 0; i < row; i++)
+    for (int p = 0; p < FEATURE_BLOCK; p++)
+      x[i][p] = (int32_t)(in[(i / QMLP_GROUP) * FEATURE_BLOCK + p] >>
+                          (8 * (i % QMLP_GROUP))) &
+                0xFF;
+  if (logits == NULL)
+    memset(out, 0,
+           sizeof(uint32_t) * (layer->n_out_padded / QMLP_GROUP) *
+               FEATURE_BLOCK);
+
+  for (uint32_t o = 0; o < layer->n_out_padded; o++) {
+    const int8_t *w = layer->weights + o * row;
+    int32_t acc[FEATURE_BLOCK] = {0};
+    for (size_t i = 0; i < row; i++)
+      for (int p = 0; p < FEATURE_BLOCK; p++)
+        acc[p] += x[i][p] * w[i];
+
+    for (int p = 0; p < FEATURE_BLOCK; p++) {
+      float v = (float)acc[p] * layer->scale[o] + layer->offset[o];
+      if (logits != NULL) {
+        if (o < layer->n_out)
+          logits[o * FEATURE_BLOCK + p] = v;
+      } else {
+        out[(o / QMLP_GROUP) * FEATURE_BLOCK + p] |= quantize_scalar(v)
+                                                     << (8 * (o % QMLP_GROUP));
+      }
+    }
+  }
+}
+
+/*============================================================================
+ * AVX2 / AVX-VNNI KERNELS
+ *===========================================================================*/
+
+#if QMLP_HAVE_AVX2_KERNEL
+
+static inline int32_t load_group(const int8_t *w) {
+  int32_t v;
+  memcpy(&v, w, sizeof(v));
+  return v;
+}
+
+/* Round v * scale + offset to int32; values above QMLP_QMAX saturate */
+__attribute__((target("avx2,fma"))) static inline __m256i
+requantize_avx2(__m256 v, float scale, float offset) {
+  v = _mm256_fmadd_ps(v, _mm256_set1_ps(scale), _mm256_set1_ps(offset));
+  return _mm256_cvtps_epi32(_mm256_min_ps(v, _mm256_set1_ps(QMLP_QMAX)));
+}
+
+/*
+ * Clamp four int32 vectors (inputs 4g..4g+3 of 8 pages) to [0, QMLP_QMAX]
+ * and pack them into one activation group. The saturating packs leave
+ * each 128-bit lane as [q0 p0..p3 | q1 p0..p3 | q2 ... | q3 ...]; the
+ * shuffle transposes that to [p0: q0..q3 | p1: q0..q3 | ...].
+ */
+__attribute__((target("avx2"))) static inline __m256i
+pack_group_avx2(__m256i q0, __m256i q1, __m256i q2, __m256i q3) {
+  const __m256i transpose = _mm256_setr_epi8(
+      0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15, /* Lane 0 */
+      0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+  __m256i bytes = _mm256_packs_epi16(_mm256_packs_epi32(q0, q1),
+                                     _mm256_packs_epi32(q2, q3));
+  bytes = _mm256_max_epi8(bytes, _mm256_setzero_si256());
+  return _mm256_shuffle_epi8(bytes, transpose);
+}
+
+__attribute__((target("avx2,fma"))) static void
+quantize_input_avx2(const qmlp_model_t *model, const float *in,
+                    uint32_t *out) {
+  for (int g = 0; g < QMLP_INPUT_GROUPS; g++) {
+    __m256i q[QMLP_GROUP];
+    for (int b = 0; b < QMLP_GROUP; b++) {
+      int f = g * QMLP_GROUP + b;
+      q[b] = f < TM_FEATURE_COUNT
+                 ? requantize_avx2(_mm256_loadu_ps(in + f * FEATURE_BLOCK),
+                                   model->input_scale[f],
+                                   model->input_offset[f])
+                 : _mm256_setzero_si256();
+    }
+    _mm256_storeu_si256((__m256i *)(out + g * FEATURE_BLOCK),
+                        pack_group_avx2(q[0], q[1], q[2], q[3]));
+  }
+}
+
+/* u8 x s8 dot product of four-byte groups, accumulated into int32 lanes */
+__attribute__((target("avx2"))) static inline __m256i
+dot_avx2(__m256i acc, __m256i x, __m256i w) {
+  __m256i pairs = _mm256_maddubs_epi16(x, w); /* Cannot saturate for u7 */
+  return _mm256_add_epi32(acc, _mm256_madd_epi16(pairs, _mm256_set1_epi16(1)));
+}
+
+__attribute__((target("avx2,fma"))) static inline __m256i
+requantize_acc_avx2(const qmlp_layer_t *layer, uint32_t o, __m256i acc) {
+  return requantize_avx2(_mm256_cvtepi32_ps(acc), layer->scale[o],
+                         layer->offset[o]);
+}
+
+__attribute__((target("avx2,fma"))) static inline void
+store_logit_avx2(const qmlp_layer_t *layer, uint32_t o, __m256i acc,
+                 float *logits) {
+  if (o >= layer->n_out)
+    return;
+  _mm256_storeu_ps(logits + o * FEATURE_BLOCK,
+                   _mm256_fmadd_ps(_mm256_cvtepi32_ps(acc),
+                                   _mm256_set1_ps(layer->scale[o]),
+                                   _mm256_set1_ps(layer->offset[o])));
+}
+
+/*
+ * Four outputs per pass: each loaded input group is reused four times,
+ * and the four requantized outputs pack into exactly one output group.
+ */
+#define QMLP_DENSE_KERNEL(NAME, TARGET, DOT)                                   \
+  __attribute__((target(TARGET))) static void NAME(                           \
+      const qmlp_layer_t *layer, const uint32_t *in, uint32_t *out,           \
+      float *logits) {                                                        \
+    size_t row = (size_t)layer->n_groups * QMLP_GROUP;                        \
+    for (uint32_t o = 0; o < layer->n_out_padded; o += QMLP_GROUP) {          \
+      const int8_t *w0 = layer->weights + o * row;                            \
+      const int8_t *w1 = w0 + row, *w2 = w1 + row, *w3 = w2 + row;            \
+      __m256i acc0 = _mm256_setzero_si256(), acc1 = acc0, acc2 = acc0,        \
+              acc3 = acc0;                                                    \
+      for (uint32_t g = 0; g < layer->n_groups; g++) {                        \
+        __m256i x =                                                           \
+            _mm256_loadu_si256((const __m256i *)(in + g * FEATURE_BLOCK));    \
+        size_t k = (size_t)g * QMLP_GROUP;                                    \
+        acc0 = DOT(acc0, x, _mm256_set1_epi32(load_group(w0 + k)));           \
+        acc1 = DOT(acc1, x, _mm256_set1_epi32(load_group(w1 + k)));           \
+        acc2 = DOT(acc2, x, _mm256_set1_epi32(load_group(w2 + k)));           \
+        acc3 = DOT(acc3, x, _mm256_set1_epi32(load_group(w3 + k)));           \
+      }                                                                       \
+      if (logits != NULL) {                                                   \
+        store_logit_avx2(layer, o + 0, acc0, logits);                         \
+        store_logit_avx2(layer, o + 1, acc1, logits);                         \
+        store_logit_avx2(layer, o + 2, acc2, logits);                         \
+        store_logit_avx2(layer, o + 3, acc3, logits);                         \
+        continue;                                                             \
+      }                                                                       \
+      __m256i packed =                                                        \
+          pack_group_avx2(requantize_acc_avx2(layer, o + 0, acc0),            \
+                          requantize_acc_avx2(layer, o + 1, acc1),            \
+                          requantize_acc_avx2(layer, o + 2, acc2),            \
+                          requantize_acc_avx2(layer, o + 3, acc3));           \
+      _mm256_storeu_si256((__m256i *)(out + (o / QMLP_GROUP) * FEATURE_BLOCK), \
+                          packed);                                            \
+    }                                                                         \
+  }
+
+QMLP_DENSE_KERNEL(qdense_avx2, "avx2,fma", dot_avx2)
+
+#if QMLP_HAVE_VNNI_KERNEL
+#define dot_vnni(acc, x, w) _mm256_dpbusd_avx_epi32(acc, x, w)
+QMLP_DENSE_KERNEL(qdense_vnni, "avx2,fma,avxvnni", dot_vnni)
+#endif
+
+#endif /* QMLP_HAVE_AVX2_KERNEL */
+
+/*============================================================================
+ * KERNEL SELECTION
+ *===========================================================================*/
+
+static void select_kernel(void) {
+  g_qdense_kernel = qdense_scalar;
+  g_quantize_input = quantize_input_scalar;
+  g_kernel_name = "scalar";
+#if QMLP_HAVE_AVX2_KERNEL
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    g_qdense_kernel = qdense_avx2;
+    g_quantize_input = quantize_input_avx2;
+    g_kernel_name = "avx2";
+#if QMLP_HAVE_VNNI_KERNEL
+    if (__builtin_cpu_supports("avxvnni")) {
+      g_qdense_kernel = qdense_vnni;
+      g_kernel_name = "avxvnni";
+    }
+#endif
+  }
+#endif
+}
+
+const char *qmlp_kernel_name(void) {
+  pthread_once(&g_kernel_once, select_kernel);
+  return g_kernel_name;
+}
+
+/*============================================================================
+ * FORWARD PASS
+ *===========================================================================*/
+
+void qmlp_forward_block(const qmlp_model_t *model, const float *in,
+                        float logits[FEATURE_BLOCK]) {
+  uint32_t buf_a[QMLP_MAX_GROUPS * FEATURE_BLOCK] __attribute__((aligned(32)));
+  uint32_t buf_b[QMLP_MAX_GROUPS * FEATURE_BLOCK] __attribute__((aligned(32)));
+
+  g_quantize_input(model, in, buf_a);
+  const uint32_t *cur = buf_a;
+  uint32_t *next = buf_b;
+  for (uint32_t l = 0; l < model->n_layers; l++) {
+    bool last = l + 1 == model->n_layers;
+    g_qdense_kernel(&model->layers[l], cur, next, last ? logits : NULL);
+    cur = next;
+    next = next == buf_a ? buf_b : buf_a;
+  }
+}
+
+/*============================================================================
+ * CALIBRATION
+ *===========================================================================*/
+
+/* Float reference forward pass for one page; records activations */
+static float float_forward(const mlp_model_t *model, const float *x,
+                           float act[MLP_MAX_LAYERS][MLP_MAX_WIDTH]) {
+  const float *in = x;
+  for (uint32_t l = 0; l < model->n_layers; l++) {
+    const mlp_layer_t *layer = &model->layers[l];
+    bool last = l + 1 == model->n_layers;
+    for (uint32_t o = 0; o < layer->n_out; o++) {
+      const float *w = layer->weights + (size_t)o * layer->n_in;
+      float v = layer->bias[o];
+      for (uint32_t i = 0; i < layer->n_in; i++)
+        v += w[i] * in[i];
+      if (!last && layer->activation == MLP_ACT_RELU)
+        v = v > 0.0f ? v : 0.0f;
+      else if (!last && layer->activation == MLP_ACT_SIGMOID)
+        v = 1.0f / (1.0f + expf(-v));
+      act[l][o] = v;
+    }
+    in = act[l];
+  }
+  return act[model->n_layers - 1][0];
+}
+
+/* Per-page history needed to rebuild features from periodic CSV rows */
+typedef struct calib_page {
+  uintptr_t addr; /* 0 = empty slot */
+  uint64_t first_ns;
+  uint64_t last_change_ns;
+  uint64_t prev_count;
+  uint64_t prev_cycle;
+} calib_page_t;
+
+typedef struct calib_table {
+  calib_page_t *slots;
+  size_t capacity; /* Power of two */
+  size_t used;
+} calib_table_t;
+
+static calib_page_t *calib_lookup(calib_table_t *t, uintptr_t addr,
+                                  bool *fresh) {
+  if (t->used * 2 >= t->capacity) {
+    calib_table_t grown = {calloc(t->capacity * 2, sizeof(calib_page_t)),
+                           t->capacity * 2, 0};
+    if (grown.slots == NULL)
+      return NULL;
+    for (size_t i = 0; i < t->capacity; i++) {
+      if (t->slots[i].addr == 0)
+        continue;
+      bool unused;
+      *calib_lookup(&grown, t->slots[i].addr, &unused) = t->slots[i];
+    }
+    free(t->slots);
+    *t = grown;
+  }
+
+  size_t i = (addr / PAGE_SIZE) * 0x9E3779B97F4A7C15ULL & (t->capacity - 1);
+  while (t->slots[i].addr != 0 && t->slots[i].addr != addr)
+    i = (i + 1) & (t->capacity - 1);
+  *fresh = t->slots[i].addr == 0;
+  if (*fresh) {
+    t->slots[i].addr = addr;
+    t->used++;
+  }
+  return &t->slots[i];
+}
+
+/* Rebuild the feature vector the policy thread would have seen */
+static void csv_row_features(calib_page_t *page, bool fresh, uint64_t cycle,
+                             uint64_t now, int tier, double heat,
+                             uint64_t accesses, uint64_t writes,
+                             uint32_t migrations, float *out) {
+  if (fresh) {
+    page->first_ns = now;
+    page->last_change_ns = now;
+    page->prev_count = 0;
+    page->prev_cycle = cycle > 0 ? cycle - 1 : 0;
+  }
+  uint64_t cycles = cycle > page->prev_cycle ? cycle - page->prev_cycle : 1;
+  if (accesses != page->prev_count)
+    page->last_change_ns = now;
+
+  page_stats_t stats = {0};
+  stats.page_addr = (void *)page->addr;
+  stats.access_count = accesses;
+  stats.write_count = writes;
+  stats.last_access_ns = page->last_change_ns;
+  stats.heat_score = heat;
+  stats.access_rate = now > page->first_ns ? (double)accesses * 1e9 /
+                                                 (double)(now - page->first_ns)
+                                           : 0.0;
+  stats.access_delta = accesses > page->prev_count
+                           ? (accesses - page->prev_count) / cycles
+                           : 0;
+  stats.current_tier = tier == TIER_NVM ? TIER_NVM : TIER_DRAM;
+  stats.migration_count = migrations;
+  extract_page_features(&stats, now, out);
+
+  page->prev_count = accesses;
+  page->prev_cycle = cycle;
+}
+
+int qmlp_calibrate_csv(const mlp_model_t *model, const char *csv_path,
+                       qmlp_calibration_t *cal) {
+  memset(cal, 0, sizeof(*cal));
+  FILE *f = fopen(csv_path, "r");
+  if (f == NULL) {
+    TM_ERROR("Cannot open calibration dataset %s: %s", csv_path,
+             strerror(errno));
+    return -1;
+  }
+
+  calib_table_t table = {calloc(1024, sizeof(calib_page_t)), 1024, 0};
+  cal->sample_features =
+      malloc(sizeof(float) * QMLP_CALIBRATION_SAMPLES * TM_FEATURE_COUNT);
+  if (table.slots == NULL || cal->sample_features == NULL) {
+    free(table.slots);
+    fclose(f);
+    qmlp_calibration_release(cal);
+    return -1;
+  }
+  for (int i = 0; i < TM_FEATURE_COUNT; i++) {
+    cal->feature_min[i] = INFINITY;
+    cal->feature_max[i] = -INFINITY;
+  }
+
+  char line[512];
+  uint64_t rng = 0x2545F4914F6CDD1DULL;
+  while (fgets(line, sizeof(line), f) != NULL) {
+    uint64_t cycle, now, accesses, reads, writes;
+    uintptr_t addr;
+    int tier;
+    double heat;
+    uint32_t migrations;
+    if (sscanf(line,
+               "%" SCNu64 ",%" SCNu64 ",%" SCNxPTR ",%d,%lf,%" SCNu64
+               ",%" SCNu64 ",%" SCNu64 ",%" SCNu32,
+               &cycle, &now, &addr, &tier, &heat, &accesses, &reads, &writes,
+               &migrations) != 9 ||
+        addr == 0)
+      continue; /* Header or malformed row */
+
+    bool fresh;
+    calib_page_t *page = calib_lookup(&table, addr, &fresh);
+    if (page == NULL)
+      break;
+    float x[TM_FEATURE_COUNT];
+    csv_row_features(page, fresh, cycle, now, tier, heat, accesses, writes,
+                     migrations, x);
+
+    for (int i = 0; i < TM_FEATURE_COUNT; i++) {
+      cal->feature_min[i] = fminf(cal->feature_min[i], x[i]);
+      cal->feature_max[i] = fmaxf(cal->feature_max[i], x[i]);
+    }
+
+    /* Reservoir sampling keeps a uniform subset of all rows */
+    size_t slot = cal->rows;
+    if (cal->rows >= QMLP_CALIBRATION_SAMPLES) {
+      rng ^= rng << 13;
+      rng ^= rng >> 7;
+      rng ^= rng << 17;
+      slot = rng % (cal->rows + 1);
+    }
+    if (slot < QMLP_CALIBRATION_SAMPLES)
+      memcpy(cal->sample_features + slot * TM_FEATURE_COUNT, x, sizeof(x));
+    cal->rows++;
+  }
+  free(table.slots);
+  fclose(f);
+
+  if (cal->rows == 0) {
+    TM_ERROR("%s: no usable rows for calibration", csv_path);
+    qmlp_calibration_release(cal);
+    return -1;
+  }
+  cal->samples = cal->rows < QMLP_CALIBRATION_SAMPLES
+                     ? cal->rows
+                     : QMLP_CALIBRATION_SAMPLES;
+
+  for (uint32_t l = 0; l < model->n_layers; l++)
+    for (int o = 0; o < MLP_MAX_WIDTH; o++) {
+      cal->act_min[l][o] = INFINITY;
+      cal->act_max[l][o] = -INFINITY;
+    }
+  float act[MLP_MAX_LAYERS][MLP_MAX_WIDTH];
+  for (size_t s = 0; s < cal->samples; s++) {
+    float_forward(model, cal->sample_features + s * TM_FEATURE_COUNT, act);
+    for (uint32_t l = 0; l < model->n_layers; l++)
+      for (uint32_t o = 0; o < model->layers[l].n_out; o++) {
+        cal->act_min[l][o] = fminf(cal->act_min[l][o], act[l][o]);
+        cal->act_max[l][o] = fmaxf(cal->act_max[l][o], act[l][o]);
+      }
+  }
+  return 0;
+}
+
+void qmlp_calibration_release(qmlp_calibration_t *cal) {
+  free(cal->sample_features);
+  cal->sample_features = NULL;
+  cal->samples = 0;
+}
+
+/*============================================================================
+ * QUANTIZATION
+ *===========================================================================*/
+
+void qmlp_model_free(qmlp_model_t *model) {
+  if (model == NULL)
+    return;
+  for (uint32_t l = 0; l < model->n_layers; l++) {
+    free(model->layers[l].weights);
+    free(model->layers[l].scale);
+    free(model->layers[l].offset);
+  }
+  free(model);
+}
+
+/*
+ * Affine range x = lo + step * q covering [lo, hi] with q in [0, QMAX].
+ * A channel that was constant in calibration gets step 0: it always
+ * quantizes to 0 and its value is folded into the next layer's bias, so
+ * its weights cannot inflate that layer's per-row weight scale.
+ */
+static void quant_range(float lo, float hi, float *out_lo, float *out_step) {
+  if (!(hi > lo)) {
+    *out_lo = isfinite(lo) ? lo : 0.0f;
+    *out_step = 0.0f;
+    return;
+  }
+  *out_lo = lo;
+  *out_step = (hi - lo) / QMLP_QMAX;
+}
+
+/* q = v * scale + offset for a channel quantized with (lo, step) */
+static void quant_affine(float lo, float step, float *scale, float *offset) {
+  *scale = step > 0.0f ? 1.0f / step : 0.0f;
+  *offset = step > 0.0f ? -lo / step : 0.0f;
+}
+
+qmlp_model_t *qmlp_quantize(const mlp_model_t *model,
+                            const qmlp_calibration_t *cal) {
+  pthread_once(&g_kernel_once, select_kernel);
+
+  for (uint32_t l = 0; l + 1 < model->n_layers; l++) {
+    if (model->layers[l].activation == MLP_ACT_SIGMOID) {
+      TM_ERROR("Quantized MLP: sigmoid hidden layers are not supported");
+      return NULL;
+    }
+  }
+
+  qmlp_model_t *qmodel = calloc(1, sizeof(*qmodel));
+  if (qmodel == NULL)
+    return NULL;
+
+  /* Affine parameters of the current layer's inputs */
+  float in_lo[MLP_MAX_WIDTH], in_step[MLP_MAX_WIDTH];
+  for (int f = 0; f < TM_FEATURE_COUNT; f++) {
+    quant_range(cal->feature_min[f], cal->feature_max[f], &in_lo[f],
+                &in_step[f]);
+    quant_affine(in_lo[f], in_step[f], &qmodel->input_scale[f],
+                 &qmodel->input_offset[f]);
+  }
+
+  for (uint32_t l = 0; l < model->n_layers; l++) {
+    const mlp_layer_t *layer = &model->layers[l];
+    qmlp_layer_t *q = &qmodel->layers[l];
+    bool last = l + 1 == model->n_layers;
+
+    q->n_in = layer->n_in;
+    q->n_out = layer->n_out;
+    q->n_groups = (layer->n_in + QMLP_GROUP - 1) / QMLP_GROUP;
+    q->n_out_padded = (layer->n_out + QMLP_GROUP - 1) / QMLP_GROUP * QMLP_GROUP;
+    size_t row = (size_t)q->n_groups * QMLP_GROUP;
+    q->weights = calloc((size_t)q->n_out_padded * row, sizeof(int8_t));
+    q->scale = calloc(q->n_out_padded, sizeof(float));
+    q->offset = calloc(q->n_out_padded, sizeof(float));
+    qmodel->n_layers = l + 1; /* Owned arrays are freed on failure */
+    if (q->weights == NULL || q->scale == NULL || q->offset == NULL) {
+      qmlp_model_free(qmodel);
+      return NULL;
+    }
+
+    float out_lo[MLP_MAX_WIDTH], out_step[MLP_MAX_WIDTH];
+    for (uint32_t o = 0; o < layer->n_out; o++) {
+      /* Fold the input affine map: y = sum(w * step * q) + b + sum(w * lo) */
+      const float *w = layer->weights + (size_t)o * layer->n_in;
+      float folded[MLP_MAX_WIDTH];
+      float bias = layer->bias[o];
+      float wmax = 0.0f;
+      for (uint32_t i = 0; i < layer->n_in; i++) {
+        folded[i] = w[i] * in_step[i];
+        bias += w[i] * in_lo[i];
+        wmax = fmaxf(wmax, fabsf(folded[i]));
+      }
+      float wscale = wmax > 0.0f ? wmax / 127.0f : 1.0f;
+      for (uint32_t i = 0; i < layer->n_in; i++)
+        q->weights[o * row + i] = (int8_t)lrintf(folded[i] / wscale);
+
+      if (last) {
+        q->scale[o] = wscale;
+        q->offset[o] = bias;
+        continue;
+      }
+      float lo = layer->activation == MLP_ACT_RELU ? 0.0f : cal->act_min[l][o];
+      quant_range(lo, cal->act_max[l][o], &out_lo[o], &out_step[o]);
+      float inv_step, zero;
+      quant_affine(out_lo[o], out_step[o], &inv_step, &zero);
+      q->scale[o] = wscale * inv_step;
+      q->offset[o] = bias * inv_step + zero;
+    }
+    memcpy(in_lo, out_lo, sizeof(float) * layer->n_out);
+    memcpy(in_step, out_step, sizeof(float) * layer->n_out);
+  }
+  return qmodel;
+}
+
+/*============================================================================
+ * ACCURACY
+ *===========================================================================*/
+
+/* -1 demote, 0 keep, +1 promote, for a page in NVM resp. DRAM */
+static int logit_outcome(float logit, bool in_nvm, float hot, float cold) {
+  if (in_nvm)
+    return logit > hot ? 1 : 0;
+  return logit < cold ? -1 : 0;
+}
+
+void qmlp_measure_accuracy(const mlp_model_t *model, const qmlp_model_t *qmodel,
+                           const qmlp_calibration_t *cal,
+                           qmlp_accuracy_t *acc) {
+  float hot = probability_to_logit(g_policy_config.hot_threshold);
+  float cold = probability_to_logit(g_policy_config.cold_threshold);
+  float act[MLP_MAX_LAYERS][MLP_MAX_WIDTH];
+  float block[TM_FEATURE_COUNT * FEATURE_BLOCK] __attribute__((aligned(32)));
+  float qlogits[FEATURE_BLOCK];
+  size_t agree = 0;
+  double total_error = 0.0;
+
+  memset(acc, 0, sizeof(*acc));
+  for (size_t base = 0; base < cal->samples; base += FEATURE_BLOCK) {
+    size_t n = cal->samples - base < FEATURE_BLOCK ? cal->samples - base
+                                                   : FEATURE_BLOCK;
+    memset(block, 0, sizeof(block));
+    for (size_t p = 0; p < n; p++)
+      for (int f = 0; f < TM_FEATURE_COUNT; f++)
+        block[f * FEATURE_BLOCK + p] =
+            cal->sample_features[(base + p) * TM_FEATURE_COUNT + f];
+    qmlp_forward_block(qmodel, block, qlogits);
+
+    for (size_t p = 0; p < n; p++) {
+      const float *x = cal->sample_features + (base + p) * TM_FEATURE_COUNT;
+      float logit = float_forward(model, x, act);
+      double error = fabs((double)logit - qlogits[p]);
+      total_error += error;
+      acc->max_abs_error = fmax(acc->max_abs_error, error);
+      bool in_nvm = x[FEAT_IN_NVM] > 0.5f;
+      if (logit_outcome(logit, in_nvm, hot, cold) ==
+          logit_outcome(qlogits[p], in_nvm, hot, cold))
+        agree++;
+    }
+  }
+  acc->samples = cal->samples;
+  if (cal->samples > 0) {
+    acc->mean_abs_error = total_error / cal->samples;
+    acc->decision_agreement = (double)agree / cal->samples;
+  }
+}
+
+/*============================================================================
+ * MIGRATION POLICY
+ *===========================================================================*/
+
+static _Atomic(qmlp_model_t *) g_pending_model = NULL;
+static qmlp_model_t *g_active_model = NULL; /* Policy thread only */
+
+static const model_reasons_t g_qmlp_reasons = {"QMLP promotion",
+                                                "QMLP demotion"};
+
+int qmlp_policy_load(const char *model_path, const char *csv_path) {
+  mlp_model_t *model = mlp_model_load(model_path);
+  if (model == NULL)
+    return -1;
+
+  qmlp_calibration_t cal;
+  if (qmlp_calibrate_csv(model, csv_path, &cal) != 0) {
+    mlp_model_free(model);
+    return -1;
+  }
+  qmlp_model_t *qmodel = qmlp_quantize(model, &cal);
+  if (qmodel == NULL) {
+    qmlp_calibration_release(&cal);
+    mlp_model_free(model);
+    return -1;
+  }
+
+  qmlp_accuracy_t acc;
+  qmlp_measure_accuracy(model, qmodel, &cal, &acc);
+  TM_INFO("Quantized MLP %s (%s kernel): calibrated on %zu of %zu rows, "
+          "logit error mean %.4f max %.4f, decision agreement %.2f%%",
+          model_path, qmlp_kernel_name(), cal.samples, cal.rows,
+          acc.mean_abs_error, acc.max_abs_error,
+          100.0 * acc.decision_agreement);
+  qmlp_calibration_release(&cal);
+  mlp_model_free(model);
+
+  qmlp_model_free(atomic_exchange(&g_pending_model, qmodel));
+  set_batch_migration_policy(qmlp_batch_policy);
+  return 0;
+}
+
+size_t qmlp_batch_policy(const page_stats_t *const *pages, size_t count,
+                         migration_decision_t *decisions,
+                         size_t max_decisions) {
+  /* Adopt a newly quantized model; the old one is no longer referenced */
+  qmlp_model_t *pending = atomic_exchange(&g_pending_model, NULL);
+  if (pending != NULL) {
+    qmlp_model_free(g_active_model);
+    g_active_model = pending;
+  }
+  const qmlp_model_t *model = g_active_model;
+  if (model == NULL)
+    return 0;
+
+  float hot_logit = probability_to_logit(g_policy_config.hot_threshold);
+  float cold_logit = probability_to_logit(g_policy_config.cold_threshold);
+  uint64_t now = get_time_ns();
+
+  float features[TM_FEATURE_COUNT * FEATURE_BLOCK] __attribute__((aligned(32)));
+  float logits[FEATURE_BLOCK];
+  size_t ndecisions = 0;
+
+  for (size_t base = 0; base < count && ndecisions < max_decisions;
+       base += FEATURE_BLOCK) {
+    size_t n = count - base < FEATURE_BLOCK ? count - base : FEATURE_BLOCK;
+    extract_feature_block(pages + base, n, now, features);
+    qmlp_forward_block(model, features, logits);
+
+    for (size_t p = 0; p < n && ndecisions < max_decisions; p++) {
+      if (model_logit_decision(pages[base + p], logits[p], hot_logit,
+                               cold_logit, now, &g_qmlp_reasons,
+                               &decisions[ndecisions]))
+        ndecisions++;
+    }
+  }
+  return ndecisions;
+}
@@ -0,0 +1,148 @@
+/*
+ * qmlp.h - Quantized (int8) MLP Runtime
+ *
+ * Integer version of the built-in MLP engine (mlp.h) for scoring more
+ * pages per cycle on cores shared with the application:
+ *   - Features and hidden activations are quantized to 7-bit unsigned
+ *     values with per-feature / per-neuron affine scaling
+ *   - Weights are int8 with one scale per output neuron
+ *   - Dot products use AVX-VNNI (vpdpbusd) or AVX2 (vpmaddubsw) kernels,
+ *     selected at runtime, with a portable scalar fallback
+ *
+ * Activations are limited to [0, 127] rather than [0, 255] so that AVX2
+ * pairwise u8 x s8 products can never saturate their int16 sums.
+ *
+ * Quantization ranges come from a calibration pass over an exported
+ * ml_dataset_*.csv: page features are reconstructed from the CSV rows and
+ * run through the float model to record per-neuron activation ranges.
+ * The same samples are then scored by both models to report the
+ * accuracy cost of quantizing.
+ *
+ * LDOS Research Project, UT Austin
+ */
+
+#ifndef QMLP_H
+#define QMLP_H
+
+#include "mlp.h"
+#include "page_features.h"
+#include "tiered_memory.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/*============================================================================
+ * CONFIGURATION
+ *===========================================================================*/
+
+#define QMLP_QMAX 127                  /* Largest quantized activation */
+#define QMLP_GROUP 4                   /* Inputs packed per 32-bit lane */
+#define QMLP_CALIBRATION_SAMPLES 65536 /* Reservoir of calibration pages */
+
+/*============================================================================
+ * DATA STRUCTURES
+ *===========================================================================*/
+
+typedef struct qmlp_layer {
+  uint32_t n_in;
+  uint32_t n_out;
+  uint32_t n_groups;     /* ceil(n_in / QMLP_GROUP) */
+  uint32_t n_out_padded; /* n_out rounded up to QMLP_GROUP */
+  int8_t *weights;       /* [n_out_padded][n_groups * QMLP_GROUP] */
+
+  /*
+   * acc -> acc * scale + offset gives the next layer's quantized input
+   * (before rounding and clamping to [0, QMLP_QMAX]), or the logit for
+   * the last layer. Padded outputs have scale = offset = 0.
+   */
+  float *scale;  /* [n_out_padded] */
+  float *offset; /* [n_out_padded] */
+} qmlp_layer_t;
+
+typedef struct qmlp_model {
+  uint32_t n_layers;
+  float input_scale[TM_FEATURE_COUNT]; /* q = x * scale + offset */
+  float input_offset[TM_FEATURE_COUNT];
+  qmlp_layer_t layers[MLP_MAX_LAYERS];
+} qmlp_model_t;
+
+typedef struct qmlp_calibration {
+  size_t rows;            /* CSV rows read */
+  size_t samples;         /* Feature vectors used for activation ranges */
+  float *sample_features; /* [samples][TM_FEATURE_COUNT], owned */
+  float feature_min[TM_FEATURE_COUNT];
+  float feature_max[TM_FEATURE_COUNT];
+  float act_min[MLP_MAX_LAYERS][MLP_MAX_WIDTH]; /* Post-activation */
+  float act_max[MLP_MAX_LAYERS][MLP_MAX_WIDTH];
+} qmlp_calibration_t;
+
+/* Accuracy of a quantized model against its float original */
+typedef struct qmlp_accuracy {
+  size_t samples;
+  double mean_abs_error; /* In logits */
+  double max_abs_error;
+  double decision_agreement; /* Same promote/demote/keep outcome, [0, 1] */
+} qmlp_accuracy_t;
+
+/*============================================================================
+ * PUBLIC API
+ *===========================================================================*/
+
+/**
+ * Record feature and activation ranges of `model` over the pages in an
+ * exported dataset (ml_dataset_*.csv). Returns 0 on success.
+ */
+int qmlp_calibrate_csv(const mlp_model_t *model, const char *csv_path,
+                       qmlp_calibration_t *cal);
+
+/**
+ * Release the samples held by a calibration.
+ */
+void qmlp_calibration_release(qmlp_calibration_t *cal);
+
+/**
+ * Build the int8 version of `model` using calibrated ranges. Hidden layers
+ * must use ReLU or linear activations. Returns NULL on failure.
+ */
+qmlp_model_t *qmlp_quantize(const mlp_model_t *model,
+                            const qmlp_calibration_t *cal);
+
+/**
+ * Free a model returned by qmlp_quantize().
+ */
+void qmlp_model_free(qmlp_model_t *model);
+
+/**
+ * Score the calibration samples with both models and compare.
+ */
+void qmlp_measure_accuracy(const mlp_model_t *model, const qmlp_model_t *qmodel,
+                           const qmlp_calibration_t *cal,
+                           qmlp_accuracy_t *acc);
+
+/**
+ * Evaluate one block of pages; same input and output as
+ * mlp_forward_block().
+ */
+void qmlp_forward_block(const qmlp_model_t *model, const float *in,
+                        float logits[FEATURE_BLOCK]);
+
+/**
+ * Name of the kernel selected for this CPU ("avxvnni", "avx2" or "scalar").
+ */
+const char *qmlp_kernel_name(void);
+
+/**
+ * Load a float model, calibrate and quantize it from `csv_path`, and
+ * install qmlp_batch_policy() as the active batch policy. The accuracy
+ * loss on the calibration samples is logged.
+ */
+int qmlp_policy_load(const char *model_path, const char *csv_path);
+
+/**
+ * Batch policy backed by the most recently quantized model; decisions
+ * follow the same thresholds as mlp_batch_policy().
+ */
+size_t qmlp_batch_policy(const page_stats_t *const *pages, size_t count,
+                         migration_decision_t *decisions,
+                         size_t max_decisions);
+
+#endif /* QMLP_H */
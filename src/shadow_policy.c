@@ -0,0 +1,203 @@
+/*
+ * shadow_policy.c - Shadow Policy Evaluation
+ *
+ * Runs a secondary migration_policy_fn on the same page_stats_t snapshot
+ * the active policy sees. Shadow decisions are recorded but never executed.
+ *
+ * Reported metrics:
+ *   - Agreement rate with the active policy
+ *   - Shadow's would-be promotions/demotions
+ *   - Estimated DRAM hit-rate delta: for each disagreement, the page's
+ *     accesses over the following SHADOW_EVAL_CYCLES are credited to
+ *     whichever policy would have had the page in DRAM
+ *
+ * LDOS Research Project, UT Austin
+ */
+
+#define _GNU_SOURCE
+#include "tiered_memory.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+/*============================================================================
+ * CONFIGURATION
+ *===========================================================================*/
+
+#define SHADOW_EVAL_CYCLES 20    /* ~200ms lookahead for hit-rate estimate */
+#define SHADOW_MAX_PENDING 4096  /* Disagreements awaiting evaluation */
+#define SHADOW_RECENT_SLOTS 8192 /* Direct-mapped dedup of pending pages */
+
+/*============================================================================
+ * STATE
+ *===========================================================================*/
+
+/* A disagreement whose outcome is measured SHADOW_EVAL_CYCLES later */
+typedef struct shadow_pending {
+  const page_stats_t *stats;
+  uint64_t access_count; /* At decision time */
+  uint64_t cycle;
+  int sign; /* +1: shadow keeps page in DRAM, active does not; -1: reverse */
+} shadow_pending_t;
+
+static _Atomic(migration_policy_fn) g_shadow_policy = NULL;
+
+static struct {
+  uint64_t evaluated;
+  uint64_t agreements;
+  uint64_t shadow_promotions;
+  uint64_t shadow_demotions;
+  uint64_t active_promotions;
+  uint64_t active_demotions;
+
+  /* Hit-rate estimate */
+  uint64_t window_accesses; /* All accesses to observed pages */
+  uint64_t dram_accesses;   /* Of those, served by DRAM under active policy */
+  int64_t net_dram_accesses; /* Shadow minus active, over disagreements */
+  uint64_t dropped;          /* Disagreements not tracked (ring full) */
+
+  shadow_pending_t pending[SHADOW_MAX_PENDING];
+  size_t head, count;
+
+  /* Page -> cycle of its pending disagreement, so a page that keeps
+   * disagreeing every cycle is only credited once per lookahead window */
+  struct {
+    const page_stats_t *stats;
+    uint64_t cycle;
+  } recent[SHADOW_RECENT_SLOTS];
+} g_shadow;
+
+/*============================================================================
+ * PUBLIC API
+ *===========================================================================*/
+
+void set_shadow_policy(migration_policy_fn policy) {
+  /* Counters are reset by the policy thread when it sees the new policy */
+  atomic_store(&g_shadow_policy, policy);
+  TM_INFO("Shadow policy %s", policy ? "enabled" : "disabled");
+}
+
+/*============================================================================
+ * POLICY THREAD HOOKS
+ *===========================================================================*/
+
+/* Tier the page would occupy after acting on `decision` (or not acting) */
+static memory_tier_t resulting_tier(const page_stats_t *stats, bool acted,
+                                    const migration_decision_t *decision) {
+  return acted ? decision->to_tier : stats->current_tier;
+}
+
+/*
+ * Evaluate the shadow policy on `stats`, which the active policy just saw.
+ * `active_acted` is true if the active decision passed the confidence gate.
+ */
+void shadow_policy_observe(const page_stats_t *stats, bool active_acted,
+                           const migration_decision_t *active, uint64_t cycle) {
+  migration_policy_fn shadow = atomic_load(&g_shadow_policy);
+  if (shadow == NULL)
+    return;
+
+  migration_decision_t decision = {0};
+  bool shadow_acted = shadow(stats, &decision) &&
+                      decision.confidence >= g_policy_config.confidence_min;
+
+  g_shadow.evaluated++;
+  g_shadow.window_accesses += stats->access_delta;
+  if (stats->current_tier == TIER_DRAM)
+    g_shadow.dram_accesses += stats->access_delta;
+
+  if (shadow_acted) {
+    if (decision.to_tier == TIER_DRAM)
+      g_shadow.shadow_promotions++;
+    else
+      g_shadow.shadow_demotions++;
+  }
+  if (active_acted) {
+    if (active->to_tier == TIER_DRAM)
+      g_shadow.active_promotions++;
+    else
+      g_shadow.active_demotions++;
+  }
+
+  memory_tier_t shadow_tier = resulting_tier(stats, shadow_acted, &decision);
+  memory_tier_t active_tier = resulting_tier(stats, active_acted, active);
+  if (shadow_tier == active_tier) {
+    g_shadow.agreements++;
+    return;
+  }
+
+  size_t r = ((uintptr_t)stats->page_addr / PAGE_SIZE) % SHADOW_RECENT_SLOTS;
+  if (g_shadow.recent[r].stats == stats &&
+      g_shadow.recent[r].cycle + SHADOW_EVAL_CYCLES > cycle)
+    return; /* Outcome already being measured */
+
+  if (g_shadow.count == SHADOW_MAX_PENDING) {
+    g_shadow.dropped++;
+    return;
+  }
+  size_t slot = (g_shadow.head + g_shadow.count++) % SHADOW_MAX_PENDING;
+  g_shadow.pending[slot] = (shadow_pending_t){
+      .stats = stats,
+      .access_count = atomic_load(&stats->access_count),
+      .cycle = cycle,
+      .sign = shadow_tier == TIER_DRAM ? 1 : -1};
+  g_shadow.recent[r].stats = stats;
+  g_shadow.recent[r].cycle = cycle;
+}
+
+/* Settle disagreements whose lookahead window has elapsed */
+void shadow_policy_end_cycle(uint64_t cycle) {
+  static migration_policy_fn last_policy = NULL;
+  migration_policy_fn shadow = atomic_load(&g_shadow_policy);
+  if (shadow != last_policy) {
+    memset(&g_shadow, 0, sizeof(g_shadow));
+    last_policy = shadow;
+    return;
+  }
+
+  while (g_shadow.count > 0) {
+    shadow_pending_t *p = &g_shadow.pending[g_shadow.head];
+    if (p->cycle + SHADOW_EVAL_CYCLES > cycle)
+      break; /* FIFO: everything after is younger */
+
+    uint64_t now_count = atomic_load(&p->stats->access_count);
+    if (now_count > p->access_count)
+      g_shadow.net_dram_accesses +=
+          p->sign * (int64_t)(now_count - p->access_count);
+
+    g_shadow.head = (g_shadow.head + 1) % SHADOW_MAX_PENDING;
+    g_shadow.count--;
+  }
+}
+
+/*============================================================================
+ * REPORTING
+ *===========================================================================*/
+
+void print_shadow_policy_report(void) {
+  if (atomic_load(&g_shadow_policy) == NULL)
+    return;
+
+  double agreement = g_shadow.evaluated > 0 ? 100.0 * g_shadow.agreements /
+                                                  g_shadow.evaluated
+                                            : 0.0;
+  double active_hit = g_shadow.window_accesses > 0
+                          ? 100.0 * g_shadow.dram_accesses /
+                                g_shadow.window_accesses
+                          : 0.0;
+  double hit_delta = g_shadow.window_accesses > 0
+                         ? 100.0 * g_shadow.net_dram_accesses /
+                               (double)g_shadow.window_accesses
+                         : 0.0;
+
+  printf("\nShadow policy:\n");
+  printf("  Evaluated: %" PRIu64 "  Agreement: %.1f%%\n", g_shadow.evaluated,
+         agreement);
+  printf("  Would-be promotions: %" PRIu64 " (active %" PRIu64 ")"
+         "  demotions: %" PRIu64 " (active %" PRIu64 ")\n",
+         g_shadow.shadow_promotions, g_shadow.active_promotions,
+         g_shadow.shadow_demotions, g_shadow.active_demotions);
+  printf("  DRAM hit rate: active %.1f%%, shadow est. delta %+.2f%%"
+         " (%zu pending, %" PRIu64 " dropped)\n",
+         active_hit, hit_delta, g_shadow.count, g_shadow.dropped);
+}
@@ -9,6 +9,11 @@
 
 #define _GNU_SOURCE
 #include "tiered_memory.h"
+#include "bandit.h"
+#include "dataset_export.h"
+#include "decision_audit.h"
+#include "feature_stream.h"
+#include "page_history.h"
 #include "pebs.h"
 #include <inttypes.h>
 #include <stdio.h>
@@ -26,6 +31,8 @@ extern void stop_uffd_handler(void);
 extern void cleanup_userfaultfd(void);
 extern int start_policy_thread(void);
 extern void stop_policy_thread(void);
+extern int start_demotion_daemon(void);
+extern void stop_demotion_daemon(void);
 
 /*============================================================================
  * TIER INITIALIZATION
@@ -41,6 +48,10 @@ static int init_memory_tiers(void) {
   dram->write_latency_ns = 100;
   dram->backing_memory = NULL;
 
+  /* Keep 1.5-3% of DRAM free for fault-time placement */
+  dram->watermark_low = dram->capacity / 64;
+  dram->watermark_high = dram->capacity / 32;
+
   /* NVM tier: 16GB, ~300ns read latency */
   tier_config_t *nvm = &g_manager.tiers[TIER_NVM];
   nvm->name = "NVM";
@@ -57,6 +68,27 @@ static int init_memory_tiers(void) {
   return 0;
 }
 
+/*============================================================================
+ * TIER ACCOUNTING
+ *===========================================================================*/
+
+/*
+ * Lock-free, so fault handlers and migrations never overshoot capacity.
+ * A capacity the control socket lowers below `used` only stops new
+ * reservations; the demotion daemon brings DRAM back under it.
+ */
+bool tier_reserve_page(tier_config_t *tier) {
+  size_t capacity = atomic_load_explicit(&tier->capacity, memory_order_relaxed);
+  size_t used = atomic_load_explicit(&tier->used, memory_order_relaxed);
+  do {
+    if (used + PAGE_SIZE > capacity)
+      return false;
+  } while (!atomic_compare_exchange_weak_explicit(
+      &tier->used, &used, used + PAGE_SIZE, memory_order_relaxed,
+      memory_order_relaxed));
+  return true;
+}
+
 /*============================================================================
  * MANAGER LIFECYCLE
  *===========================================================================*/
@@ -72,8 +104,7 @@ int tiered_manager_init(void) {
   /* Initialize synchronization primitives */
   if (pthread_mutex_init(&g_manager.regions_lock, NULL) != 0 ||
       pthread_rwlock_init(&g_manager.stats_lock, NULL) != 0 ||
-      pthread_mutex_init(&g_manager.migration_lock, NULL) != 0 ||
-      pthread_cond_init(&g_manager.migration_cond, NULL) != 0) {
+      pthread_mutex_init(&g_manager.migration_lock, NULL) != 0) {
     TM_ERROR("Failed to initialize synchronization primitives");
     return -1;
   }
@@ -85,7 +116,15 @@ int tiered_manager_init(void) {
   atomic_store(&g_manager.total_pages_tracked, 0);
   atomic_store(&g_manager.total_faults, 0);
   atomic_store(&g_manager.total_migrations, 0);
+  atomic_store(&g_manager.total_swaps, 0);
+  atomic_store(&g_manager.proactive_demotions, 0);
+  atomic_store(&g_manager.total_oscillations, 0);
   atomic_store(&g_manager.policy_cycles, 0);
+  atomic_store(&g_manager.policy_interval_ns, POLICY_INTERVAL_MS * 1000000ULL);
+  atomic_store(&g_manager.migrations_paused, false);
+  atomic_store(&g_manager.phase_boost, 1);
+  for (int t = 0; t < TIER_COUNT; t++)
+    atomic_store(&g_manager.tier_accesses[t], 0);
 
   if (init_memory_tiers() < 0) {
     TM_ERROR("Failed to initialize memory tiers");
@@ -106,23 +145,42 @@ int tiered_manager_init(void) {
     TM_INFO("PEBS unavailable - using userfaultfd only");
   }
 
-  /* Start background threads */
+  /* Must be decided before the first page is tracked */
+  const char *history = getenv(PAGE_HISTORY_ENV);
+  if (history != NULL && history[0] != '\0')
+    g_policy_config.feature_history = history[0] != '0';
+  if (g_policy_config.feature_history)
+    TM_INFO("Feature history: %d entries per page (%zu bytes)",
+            PAGE_HISTORY_DEPTH, sizeof(page_history_t));
+
+  /* Optional: recorded from the first decision the threads execute */
+  const char *audit_path = getenv(AUDIT_FILE_ENV);
+  if (audit_path != NULL && audit_path[0] != '\0')
+    decision_audit_start(audit_path);
+
+  /* Start background threads; the daemon first, since faults wake it */
   g_manager.threads_running = true;
 
-  if (start_uffd_handler() < 0 || start_policy_thread() < 0) {
+  if (start_demotion_daemon() < 0 || start_uffd_handler() < 0 ||
+      start_policy_thread() < 0) {
     TM_ERROR("Failed to start background threads");
     g_manager.threads_running = false;
+    decision_audit_stop();
     pebs_shutdown();
     cleanup_userfaultfd();
     goto cleanup;
   }
 
+  /* Optional: a failure leaves the manager running without it */
+  const char *control_path = getenv("TM_CONTROL_SOCKET");
+  if (control_path != NULL && control_path[0] != '\0')
+    start_control_socket(control_path);
+
   g_manager.initialized = true;
   TM_INFO("Tiered memory manager initialized successfully");
   return 0;
 
 cleanup:
-  pthread_cond_destroy(&g_manager.migration_cond);
   pthread_mutex_destroy(&g_manager.migration_lock);
   pthread_rwlock_destroy(&g_manager.stats_lock);
   pthread_mutex_destroy(&g_manager.regions_lock);
@@ -135,22 +193,25 @@ void tiered_manager_shutdown(void) {
 
   TM_INFO("Shutting down tiered memory manager...");
 
+  stop_control_socket();
   g_manager.threads_running = false;
   stop_policy_thread();
   stop_uffd_handler();
+  stop_demotion_daemon(); /* After the fault handlers that signal it */
+  decision_audit_stop();
   pebs_shutdown();
 
   /* Final statistics */
   TM_INFO("Final stats: faults=%" PRIu64 ", migrations=%" PRIu64
-          ", cycles=%" PRIu64,
+          ", swaps=%" PRIu64 ", cycles=%" PRIu64,
           (uint64_t)atomic_load(&g_manager.total_faults),
           (uint64_t)atomic_load(&g_manager.total_migrations),
+          (uint64_t)atomic_load(&g_manager.total_swaps),
           (uint64_t)atomic_load(&g_manager.policy_cycles));
 
   cleanup_userfaultfd();
   cleanup_page_stats();
 
-  pthread_cond_destroy(&g_manager.migration_cond);
   pthread_mutex_destroy(&g_manager.migration_lock);
   pthread_rwlock_destroy(&g_manager.stats_lock);
   pthread_mutex_destroy(&g_manager.regions_lock);
@@ -166,27 +227,57 @@ void tiered_manager_print_status(void) {
   }
 
   printf("\n=== Tiered Memory Manager Status ===\n");
-  printf("Faults: %" PRIu64 "  Migrations: %" PRIu64 "  Cycles: %" PRIu64
-         "  Pages: %" PRIu64 "\n",
+  printf("Faults: %" PRIu64 "  Migrations: %" PRIu64 "  Swaps: %" PRIu64
+         "  Cycles: %" PRIu64 "  Pages: %" PRIu64 "\n",
          (uint64_t)atomic_load(&g_manager.total_faults),
          (uint64_t)atomic_load(&g_manager.total_migrations),
+         (uint64_t)atomic_load(&g_manager.total_swaps),
          (uint64_t)atomic_load(&g_manager.policy_cycles),
          (uint64_t)atomic_load(&g_manager.total_pages_tracked));
 
   printf("\nTiers:\n");
   for (int t = 1; t < TIER_COUNT; t++) {
     tier_config_t *tier = &g_manager.tiers[t];
-    printf("  %s: %lu/%lu bytes (%.1f%%)\n", tier->name, tier->used,
-           tier->capacity,
-           tier->capacity > 0 ? 100.0 * tier->used / tier->capacity : 0);
+    size_t used = atomic_load(&tier->used);
+    printf("  %s: %lu/%lu bytes (%.1f%%)\n", tier->name, used, tier->capacity,
+           tier->capacity > 0 ? 100.0 * used / tier->capacity : 0);
+    if (tier->watermark_low > 0)
+      printf("    watermarks: low=%zu high=%zu bytes free\n",
+             tier->watermark_low, tier->watermark_high);
   }
+  print_uffd_handler_report();
+  printf("Proactive demotions: %" PRIu64 "\n",
+         (uint64_t)atomic_load(&g_manager.proactive_demotions));
+
+  uint64_t oscillations = atomic_load(&g_manager.total_oscillations);
+  uint64_t max_residence = 0;
+  size_t backed_off = count_backed_off_pages(&max_residence);
+  printf("Ping-pong: %" PRIu64 " oscillations (%.1f MB moved back within"
+         " the window), %zu pages backed off (max residence %.0fms)\n",
+         oscillations, oscillations * PAGE_SIZE / (1024.0 * 1024.0),
+         backed_off, max_residence / 1e6);
+  print_policy_interval_report();
+  print_policy_scheduler_report();
+  print_migration_stages_report();
+  print_phase_detector_report();
+  print_dataset_export_report();
+  print_feature_stream_report();
+  print_decision_audit_report();
+
+  print_shadow_policy_report();
+  print_bandit_policy_report();
 
   printf("\nManaged Regions: %d\n", g_manager.region_count);
   pthread_mutex_lock(&g_manager.regions_lock);
   for (int i = 0; i < MAX_MANAGED_REGIONS; i++) {
     if (g_manager.regions[i].active) {
       managed_region_t *r = &g_manager.regions[i];
-      printf("  [%d] %p + %zu bytes\n", i, r->base_addr, r->length);
+      printf("  [%d] %p + %zu bytes", i, r->base_addr, r->length);
+      if (r->group == UFFD_GROUP_PRIVATE)
+        printf(" (own userfaultfd)");
+      else if (r->group != UFFD_GROUP_SHARED)
+        printf(" (userfaultfd group %d)", r->group);
+      printf("\n");
     }
   }
   pthread_mutex_unlock(&g_manager.regions_lock);
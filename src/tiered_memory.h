@@ -36,8 +36,9 @@
 
 #define LARGE_ALLOC_THRESHOLD (1UL << 30)  /* 1 GB - threshold for managed allocations */
 #define PAGE_SIZE 4096
-#define POLICY_INTERVAL_MS 10              /* ML inference interval */
+#define POLICY_INTERVAL_MS 10              /* Initial ML inference interval */
 #define MAX_MANAGED_REGIONS 64
+#define MAX_UFFD_GROUPS 16                 /* Regions with a userfaultfd of their own */
 #define MAX_TRACKED_PAGES (1 << 20)        /* ~1M pages = 4GB */
 #define PAGE_STATS_HASH_SIZE 1048583       /* Prime for better distribution */
 
@@ -54,17 +55,23 @@ typedef enum {
 
 typedef struct tier_config {
     const char *name;
-    size_t capacity;
-    size_t used;
+    _Atomic size_t capacity;        /* Set at runtime by the control socket */
+    _Atomic size_t used;            /* Grown with tier_reserve_page() */
     uint64_t read_latency_ns;
     uint64_t write_latency_ns;
     void *backing_memory;
+    
+    /* Free-space watermarks (bytes); 0 disables proactive demotion */
+    _Atomic size_t watermark_low;   /* Below this, wake the demotion daemon */
+    _Atomic size_t watermark_high;  /* Daemon demotes until free reaches this */
 } tier_config_t;
 
 /*============================================================================
  * PAGE STATISTICS (ML Features)
  *===========================================================================*/
 
+typedef struct page_history page_history_t; /* page_history.h */
+
 typedef struct page_stats {
     void *page_addr;                /* Page-aligned virtual address (key) */
     
@@ -81,11 +88,23 @@ typedef struct page_stats {
     /* Derived features (computed by policy thread) */
     double heat_score;              /* Hotness estimate [0.0, 1.0] */
     double access_rate;             /* Accesses per second */
+    uint64_t access_delta;          /* Accesses since previous feature update */
+    uint64_t prev_access_count;     /* access_count at previous feature update */
     
     /* Placement state */
     memory_tier_t current_tier;
     uint64_t last_migration_ns;
     uint32_t migration_count;
+    uint32_t oscillations;          /* Migrations that reversed a recent one */
+    uint64_t residence_ns;          /* Ping-pong backoff; 0 = global min_residence_ns */
+    
+    /* Dataset export (policy thread): values in the page's last emitted row */
+    uint64_t export_access_count;
+    double export_heat;
+    memory_tier_t export_tier;
+    bool exported;
+    
+    page_history_t *history;        /* Recent feature updates; NULL unless feature_history */
     
     struct page_stats *next;        /* Hash table chaining */
 } page_stats_t;
@@ -97,8 +116,10 @@ typedef struct page_stats {
 typedef struct managed_region {
     void *base_addr;
     size_t length;
-    int uffd;
+    int uffd;                       /* g_manager.uffd, or its group's own */
+    int group;                      /* UFFD_GROUP_* or a group id > 0 */
     bool active;
+    _Atomic uint32_t seq;           /* Odd while the slot is being rewritten */
     _Atomic uint64_t total_faults;
     _Atomic uint64_t pages_in_dram;
     _Atomic uint64_t pages_in_nvm;
@@ -112,9 +133,9 @@ typedef struct tiered_manager {
     bool initialized;
     int uffd;
     
-    /* Threads */
-    pthread_t uffd_thread;
+    /* Threads (the fault handler pool lives in uffd_handler.c) */
     pthread_t policy_thread;
+    pthread_t demotion_thread;
     bool threads_running;
     
     /* Managed regions */
@@ -123,8 +144,8 @@ typedef struct tiered_manager {
     pthread_mutex_t regions_lock;
     
     /* Page statistics */
-    page_stats_t *page_stats_table[PAGE_STATS_HASH_SIZE];
-    pthread_rwlock_t stats_lock;
+    page_stats_t *_Atomic page_stats_table[PAGE_STATS_HASH_SIZE]; /* Heads pushed with CAS */
+    pthread_rwlock_t stats_lock;           /* Exclusive only to free entries */
     _Atomic uint64_t total_pages_tracked;
     
     /* Tier configurations */
@@ -133,11 +154,17 @@ typedef struct tiered_manager {
     /* Global statistics */
     _Atomic uint64_t total_faults;
     _Atomic uint64_t total_migrations;
+    _Atomic uint64_t total_swaps;
+    _Atomic uint64_t proactive_demotions;
+    _Atomic uint64_t total_oscillations;   /* Migrations reversing a recent one */
     _Atomic uint64_t policy_cycles;
+    _Atomic uint64_t policy_interval_ns;   /* Period chosen for the next cycle */
+    _Atomic bool migrations_paused;        /* Set through the control socket */
+    _Atomic uint64_t tier_accesses[TIER_COUNT]; /* Access deltas seen by feature updates */
+    _Atomic uint32_t phase_boost;          /* 1, or phase_boost_factor after a phase change */
     
     /* Synchronization */
     pthread_mutex_t migration_lock;
-    pthread_cond_t migration_cond;
 } tiered_manager_t;
 
 extern tiered_manager_t g_manager;
@@ -154,6 +181,16 @@ typedef struct migration_decision {
     const char *reason;
 } migration_decision_t;
 
+/* Outcome of executing a migration decision */
+typedef enum {
+    MIGRATION_OK = 0,
+    MIGRATION_ERR_NO_STATS,     /* Page is not tracked */
+    MIGRATION_ERR_TIER_FULL,    /* Destination tier at capacity */
+    MIGRATION_ERR_STALE,        /* Page no longer in decision->from_tier */
+    MIGRATION_ERR_BACKOFF,      /* Page inside its ping-pong residence backoff */
+    MIGRATION_ERR_PAUSED        /* Migrations paused through the control socket */
+} migration_result_t;
+
 /*
  * Migration policy function signature.
  * Implement this to plug in your ML model.
@@ -165,6 +202,67 @@ typedef bool (*migration_policy_fn)(
 
 extern migration_policy_fn g_migration_policy;
 
+/*
+ * Batch policy signature: decide for `count` pages in one call, letting
+ * the model amortize per-call overhead and vectorize across pages.
+ * Writes up to `max_decisions` decisions (in the same order as `pages`)
+ * and returns how many were written. Takes precedence over the per-page
+ * policy when set.
+ */
+typedef size_t (*migration_batch_policy_fn)(
+    const page_stats_t *const *pages,
+    size_t count,
+    migration_decision_t *decisions,
+    size_t max_decisions
+);
+
+extern migration_batch_policy_fn g_batch_migration_policy;
+
+/*
+ * Native policy plugins, loaded with dlopen() from TM_POLICY_PLUGIN or
+ * load_policy_plugin(). A plugin exports:
+ *   uint32_t tm_policy_abi_version(void);            (required)
+ *   bool     tm_policy_decide_v1(...);               (migration_policy_fn)
+ *   size_t   tm_policy_decide_batch_v1(...);         (migration_batch_policy_fn)
+ *   int      tm_policy_init_v1(void);                (optional, 0 = ok)
+ *   void     tm_policy_fini_v1(void);                (optional)
+ * At least one decide entry point is required. Plugins should not call
+ * back into the manager: the demo binary does not export its symbols.
+ */
+#define TM_POLICY_ABI_VERSION 1
+
+/*============================================================================
+ * POLICY CONFIGURATION
+ *===========================================================================*/
+
+typedef struct policy_config {
+    double hot_threshold;           /* Heat > this -> promote */
+    double cold_threshold;          /* Heat < this -> demote */
+    double confidence_min;
+    uint64_t min_residence_ns;      /* Anti-thrashing: min time before migration */
+    uint32_t max_migrations_per_cycle; /* Promotion stage budget (a swap counts 2) */
+    uint32_t max_demotions_per_batch;  /* Demotion stage budget per run */
+    uint32_t demotion_interval_ms;     /* Min. time between demotion runs */
+    bool stage_threads;                /* Run each stage on its own thread */
+    bool swap_when_full;            /* Pair blocked promotions with cold DRAM victims */
+    double swap_margin;             /* Victim must be this much colder than the hot page */
+    uint32_t interval_min_ms;       /* Adaptive policy period bounds; */
+    uint32_t interval_max_ms;       /* equal values pin the period */
+    uint32_t cycle_budget_pct;      /* Policy thread CPU per cycle, % of period (0 = unlimited) */
+    uint64_t benefit_horizon_ns;    /* Cost model: time a moved page's savings accrue over */
+    double heat_decay_per_s;        /* Heat score recency decay (0.07: ~10s half-life) */
+    uint32_t phase_boost_factor;    /* Decay and budget multiplier after a phase change (1 = off) */
+    bool export_incremental;        /* Dataset: only pages changed since their last row */
+    double export_heat_epsilon;     /* Incremental: heat change that counts as a change */
+    uint32_t export_keyframe_interval; /* Incremental: every Nth snapshot is complete */
+    uint32_t export_label_cycles;   /* Dataset: future_accesses label horizon (0 = off) */
+    bool feature_history;           /* Per-page history ring (page_history.h); set before init */
+    uint32_t uffd_threads;          /* Fault handler pool size (TM_UFFD_THREADS); set before init */
+    bool uffd_per_region;           /* Own userfaultfd per region (TM_UFFD_PER_REGION); read at registration */
+} policy_config_t;
+
+extern policy_config_t g_policy_config;
+
 /*============================================================================
  * PUBLIC API
  *===========================================================================*/
@@ -176,21 +274,79 @@ void tiered_manager_print_status(void);
 
 /* Region management */
 int register_managed_region(void *addr, size_t length);
+
+/*
+ * Userfaultfd groups. UFFD_GROUP_SHARED regions use g_manager.uffd and the
+ * handler pool. Regions with the same group id > 0 share a userfaultfd and
+ * a single handler thread, created with the group's first region and
+ * stopped with its last. A UFFD_GROUP_PRIVATE region gets a group of its
+ * own, and its handler resolves faults without looking the region up.
+ * register_managed_region() uses UFFD_GROUP_PRIVATE when
+ * g_policy_config.uffd_per_region is set, UFFD_GROUP_SHARED otherwise.
+ */
+#define UFFD_GROUP_SHARED 0
+#define UFFD_GROUP_PRIVATE (-1)
+int register_managed_region_group(void *addr, size_t length, int group);
 void unregister_managed_region(void *addr);
 
 /* Page statistics */
 page_stats_t* get_page_stats(void *page_addr);
 page_stats_t* get_or_create_page_stats(void *page_addr);
+size_t find_coldest_pages(memory_tier_t tier, uint64_t min_residence_ns,
+                          page_stats_t **out, size_t max);
 void record_page_access(void *page_addr, bool is_write);
+void record_page_stats_access(page_stats_t *stats, bool is_write);
 void compute_page_features(page_stats_t *stats);
 void update_all_page_features(void);
+void update_page_features_range(size_t first_bucket, size_t end_bucket);
 void print_page_stats_summary(void);
+
+/* Per-page anti-thrashing (ping-pong backoff) */
+uint64_t page_min_residence_ns(const page_stats_t *stats);
+bool page_residence_elapsed(const page_stats_t *stats, uint64_t now);
+void record_page_migration(page_stats_t *stats, memory_tier_t to_tier,
+                           uint64_t now);
+size_t count_backed_off_pages(uint64_t *max_residence_ns);
 void cleanup_page_stats(void);
 
 /* Policy */
 void set_migration_policy(migration_policy_fn policy);
+void set_batch_migration_policy(migration_batch_policy_fn policy);
+int load_policy_plugin(const char *path);   /* Swapped in between cycles */
+void unload_policy_plugin(void);            /* Revert to default heuristic */
 void set_csv_label(const char *label);
 bool default_heuristic_policy(const page_stats_t *stats, migration_decision_t *decision);
+int execute_migration(migration_decision_t *decision);
+
+/* Shadow evaluation: run a second policy without executing its decisions */
+void set_shadow_policy(migration_policy_fn policy);
+void print_shadow_policy_report(void);
+
+/* Tier accounting: add a page to `used` unless it would exceed capacity */
+bool tier_reserve_page(tier_config_t *tier);
+
+/* Fault handler pool (g_policy_config.uffd_threads) and group handlers */
+void print_uffd_handler_report(void);
+
+/* Proactive demotion (kswapd-style watermarks on DRAM) */
+void wake_demotion_daemon(void);
+
+/* Adaptive policy period (g_manager.policy_interval_ns) */
+void print_policy_interval_report(void);
+
+/* Policy thread deadlines, CPU budget and phase yields */
+void print_policy_scheduler_report(void);
+
+/* Promotion and demotion stages (budgets, cadence, optional threads) */
+void print_migration_stages_report(void);
+
+/* Working-set phase changes (g_manager.phase_boost) */
+void print_phase_detector_report(void);
+
+/* Runtime control socket (TM_CONTROL_SOCKET=path, client: bin/tmctl) */
+int start_control_socket(const char *path);
+void stop_control_socket(void);
+int listen_unix_socket(const char *path, const char *what, int flags);
 
 /* Utilities */
 uint64_t get_time_ns(void);
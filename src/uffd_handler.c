@@ -1,9 +1,24 @@
 /*
  * uffd_handler.c - Userfaultfd Page Fault Handler
  *
- * Background thread that handles page faults via Linux userfaultfd.
+ * Background threads that handle page faults via Linux userfaultfd.
  * On fault, decides tier placement (DRAM or NVM) and resolves with UFFDIO_COPY.
  *
+ * A pool of g_policy_config.uffd_threads handlers (TM_UFFD_THREADS, default
+ * 1) reads the same descriptor; the kernel hands each message to one
+ * reader, and a read() drains up to UFFD_READ_BATCH of them. The resolution
+ * path takes no lock: tier space is reserved with CAS, page stats are found
+ * or pushed onto their bucket with CAS, the region lookup is a
+ * seqlock-validated scan behind a per-thread cache, and the demotion daemon
+ * is woken with a bare condvar signal. Two handlers can see
+ * faults on the same page (several threads touched it); the loser's
+ * UFFDIO_COPY fails with EEXIST and it returns its reservation.
+ *
+ * Regions can also be registered on a userfaultfd of their own (a group,
+ * see register_managed_region_group()), served by one handler thread that
+ * polls only that descriptor. A busy region then never queues another's
+ * faults, and a private region's handler knows the region from its fd.
+ *
  * Requires: /proc/sys/vm/unprivileged_userfaultfd = 1
  *
  * LDOS Research Project, UT Austin
@@ -14,24 +29,58 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <linux/userfaultfd.h>
+#include <inttypes.h>
 #include <poll.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/ioctl.h>
+#include <sys/eventfd.h>
 #include <sys/mman.h>
 #include <sys/syscall.h>
 #include <unistd.h>
 
+#define UFFD_MAX_THREADS 64
+#define UFFD_READ_BATCH 16 /* Messages per read() */
+
+/* Per-handler state; counters are written by their handler only */
+typedef struct uffd_worker {
+  _Alignas(64) pthread_t thread;
+  int index;
+  int uffd;                   /* Descriptor this handler reads */
+  int wake_fd;                /* Group handlers: eventfd signalled on stop */
+  _Atomic bool stop;
+  managed_region_t *region;   /* Private group: its only region */
+  int region_hint;            /* Slot of the last region faulted in */
+  _Atomic uint64_t faults;    /* Resolved */
+  _Atomic uint64_t duplicates; /* Already resolved by another handler */
+  _Atomic uint64_t reads;     /* read() calls that returned messages */
+  _Atomic uint64_t max_batch; /* Most messages from one read() */
+} uffd_worker_t;
+
+static uffd_worker_t g_workers[UFFD_MAX_THREADS];
+static int g_worker_count = 0;
+
+/* A userfaultfd of its own and one handler; changed under regions_lock */
+typedef struct uffd_group {
+  bool active;
+  bool running;               /* Handler started and not yet joined */
+  int id;                     /* > 0, or UFFD_GROUP_PRIVATE */
+  int regions;
+  uffd_worker_t worker;
+} uffd_group_t;
+
+static uffd_group_t g_groups[MAX_UFFD_GROUPS];
+
 static void *uffd_handler_thread(void *arg);
 
 /*============================================================================
  * USERFAULTFD INITIALIZATION
  *===========================================================================*/
 
-int init_userfaultfd(void) {
-  g_manager.uffd = syscall(__NR_userfaultfd, O_CLOEXEC | O_NONBLOCK);
-  if (g_manager.uffd < 0) {
+static int open_userfaultfd(void) {
+  int uffd = syscall(__NR_userfaultfd, O_CLOEXEC | O_NONBLOCK);
+  if (uffd < 0) {
     TM_ERROR("userfaultfd syscall failed: %s", strerror(errno));
     TM_ERROR(
         "Make sure you're running on Linux >= 4.3 and have CAP_SYS_PTRACE");
@@ -43,29 +92,56 @@ int init_userfaultfd(void) {
       .features = 0 /* Request minimal features for compatibility */
   };
 
-  if (ioctl(g_manager.uffd, UFFDIO_API, &uffdio_api) < 0) {
+  if (ioctl(uffd, UFFDIO_API, &uffdio_api) < 0) {
     TM_ERROR("UFFDIO_API ioctl failed: %s", strerror(errno));
     TM_ERROR("Kernel may not support userfaultfd properly");
-    close(g_manager.uffd);
-    g_manager.uffd = -1;
+    close(uffd);
     return -1;
   }
 
   TM_DEBUG("UFFD API version: %llu, features: 0x%llx",
            (unsigned long long)uffdio_api.api,
            (unsigned long long)uffdio_api.features);
+  return uffd;
+}
+
+int init_userfaultfd(void) {
+  g_manager.uffd = open_userfaultfd();
+  if (g_manager.uffd < 0)
+    return -1;
 
   TM_INFO("Userfaultfd initialized (fd=%d)", g_manager.uffd);
   return 0;
 }
 
 int start_uffd_handler(void) {
-  if (pthread_create(&g_manager.uffd_thread, NULL, uffd_handler_thread, NULL) !=
-      0) {
-    TM_ERROR("Failed to create UFFD handler thread: %s", strerror(errno));
-    return -1;
+  const char *env = getenv("TM_UFFD_THREADS");
+  if (env != NULL && env[0] != '\0')
+    g_policy_config.uffd_threads = (uint32_t)strtoul(env, NULL, 10);
+  if (g_policy_config.uffd_threads < 1)
+    g_policy_config.uffd_threads = 1;
+  if (g_policy_config.uffd_threads > UFFD_MAX_THREADS)
+    g_policy_config.uffd_threads = UFFD_MAX_THREADS;
+  env = getenv("TM_UFFD_PER_REGION");
+  if (env != NULL && env[0] != '\0')
+    g_policy_config.uffd_per_region = env[0] != '0';
+
+  g_worker_count = 0;
+  for (uint32_t i = 0; i < g_policy_config.uffd_threads; i++) {
+    uffd_worker_t *w = &g_workers[i];
+    *w = (uffd_worker_t){
+        .index = (int)i, .uffd = g_manager.uffd, .wake_fd = -1};
+    if (pthread_create(&w->thread, NULL, uffd_handler_thread, w) != 0) {
+      TM_ERROR("Failed to create UFFD handler thread %u: %s", i,
+               strerror(errno));
+      if (i == 0)
+        return -1;
+      break; /* Run with the handlers already started */
+    }
+    g_worker_count++;
   }
-  TM_INFO("UFFD handler thread started");
+  g_policy_config.uffd_threads = (uint32_t)g_worker_count;
+  TM_INFO("UFFD handler pool started (%d threads)", g_worker_count);
   return 0;
 }
 
@@ -73,11 +149,105 @@ int start_uffd_handler(void) {
  * REGION REGISTRATION
  *===========================================================================*/
 
+/*
+ * Slots are rewritten under regions_lock; the fault path reads them
+ * without it and retries if `seq` moved (see find_region()).
+ */
+static void region_write_begin(managed_region_t *r) {
+  atomic_fetch_add_explicit(&r->seq, 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+}
+
+static void region_write_end(managed_region_t *r) {
+  atomic_fetch_add_explicit(&r->seq, 1, memory_order_release);
+}
+
+/*
+ * Find or create the group for a new region. A new group gets its
+ * descriptors here and its handler from start_group(), once the region is
+ * in place. Called with regions_lock held.
+ */
+static uffd_group_t *get_group(int id) {
+  uffd_group_t *free_slot = NULL;
+  for (int i = 0; i < MAX_UFFD_GROUPS; i++) {
+    uffd_group_t *g = &g_groups[i];
+    if (g->active && id != UFFD_GROUP_PRIVATE && g->id == id)
+      return g;
+    if (!g->active && free_slot == NULL)
+      free_slot = g;
+  }
+  if (free_slot == NULL) {
+    TM_ERROR("No free userfaultfd groups (max=%d)", MAX_UFFD_GROUPS);
+    return NULL;
+  }
+
+  int uffd = open_userfaultfd();
+  if (uffd < 0)
+    return NULL;
+  int wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (wake_fd < 0) {
+    TM_ERROR("eventfd failed: %s", strerror(errno));
+    close(uffd);
+    return NULL;
+  }
+  *free_slot = (uffd_group_t){.active = true, .id = id};
+  free_slot->worker = (uffd_worker_t){.index = (int)(free_slot - g_groups),
+                                      .uffd = uffd,
+                                      .wake_fd = wake_fd};
+  return free_slot;
+}
+
+static int start_group(uffd_group_t *g) {
+  if (pthread_create(&g->worker.thread, NULL, uffd_handler_thread,
+                     &g->worker) != 0) {
+    TM_ERROR("Failed to create group handler thread: %s", strerror(errno));
+    return -1;
+  }
+  g->running = true;
+  return 0;
+}
+
+static void stop_group_handler(uffd_group_t *g) {
+  if (!g->running)
+    return;
+  atomic_store(&g->worker.stop, true);
+  if (eventfd_write(g->worker.wake_fd, 1) < 0)
+    TM_ERROR("eventfd_write failed: %s", strerror(errno));
+  pthread_join(g->worker.thread, NULL);
+  g->running = false;
+}
+
+/* Stop the handler and close the descriptors; its regions are gone */
+static void release_group(uffd_group_t *g) {
+  stop_group_handler(g);
+  close(g->worker.uffd);
+  close(g->worker.wake_fd);
+  g->active = false;
+}
+
+static uffd_group_t *find_group_by_fd(int uffd) {
+  for (int i = 0; i < MAX_UFFD_GROUPS; i++) {
+    if (g_groups[i].active && g_groups[i].worker.uffd == uffd)
+      return &g_groups[i];
+  }
+  return NULL;
+}
+
 int register_managed_region(void *addr, size_t length) {
+  return register_managed_region_group(
+      addr, length,
+      g_policy_config.uffd_per_region ? UFFD_GROUP_PRIVATE : UFFD_GROUP_SHARED);
+}
+
+int register_managed_region_group(void *addr, size_t length, int group) {
   if (g_manager.uffd < 0) {
     TM_ERROR("Userfaultfd not initialized");
     return -1;
   }
+  if (group < UFFD_GROUP_PRIVATE) {
+    TM_ERROR("Invalid userfaultfd group %d", group);
+    return -1;
+  }
 
   pthread_mutex_lock(&g_manager.regions_lock);
 
@@ -95,36 +265,93 @@ int register_managed_region(void *addr, size_t length) {
     return -1;
   }
 
+  uffd_group_t *g = NULL;
+  int uffd = g_manager.uffd;
+  if (group != UFFD_GROUP_SHARED) {
+    g = get_group(group);
+    if (g == NULL) {
+      pthread_mutex_unlock(&g_manager.regions_lock);
+      return -1;
+    }
+    uffd = g->worker.uffd;
+  }
+
   struct uffdio_register uffdio_register = {
       .range = {.start = (unsigned long)addr, .len = length},
       .mode = UFFDIO_REGISTER_MODE_MISSING};
 
-  if (ioctl(g_manager.uffd, UFFDIO_REGISTER, &uffdio_register) < 0) {
+  if (ioctl(uffd, UFFDIO_REGISTER, &uffdio_register) < 0) {
     TM_ERROR("UFFDIO_REGISTER failed for %p+%zu: %s", addr, length,
              strerror(errno));
+    if (g != NULL && g->regions == 0)
+      release_group(g);
     pthread_mutex_unlock(&g_manager.regions_lock);
     return -1;
   }
 
-  g_manager.regions[slot] = (managed_region_t){.base_addr = addr,
-                                               .length = length,
-                                               .uffd = g_manager.uffd,
-                                               .active = true};
+  managed_region_t *r = &g_manager.regions[slot];
+  region_write_begin(r);
+  r->base_addr = addr;
+  r->length = length;
+  r->uffd = uffd;
+  r->group = group;
+  r->active = true;
+  atomic_store_explicit(&r->total_faults, 0, memory_order_relaxed);
+  atomic_store_explicit(&r->pages_in_dram, 0, memory_order_relaxed);
+  atomic_store_explicit(&r->pages_in_nvm, 0, memory_order_relaxed);
+  region_write_end(r);
   g_manager.region_count++;
 
+  if (g != NULL && g->regions++ == 0) {
+    /* The handler may start faulting immediately: set its region first */
+    g->worker.region = group == UFFD_GROUP_PRIVATE ? r : NULL;
+    g->worker.region_hint = slot;
+    if (start_group(g) < 0) {
+      struct uffdio_range range = {.start = (unsigned long)addr,
+                                   .len = length};
+      ioctl(uffd, UFFDIO_UNREGISTER, &range);
+      region_write_begin(r);
+      r->active = false;
+      region_write_end(r);
+      g_manager.region_count--;
+      release_group(g);
+      pthread_mutex_unlock(&g_manager.regions_lock);
+      return -1;
+    }
+  }
+
   pthread_mutex_unlock(&g_manager.regions_lock);
-  TM_INFO("Registered region: %p + %zu bytes (slot %d)", addr, length, slot);
+  if (g != NULL)
+    TM_INFO("Registered region: %p + %zu bytes (slot %d, group %d, fd %d)",
+            addr, length, slot, group, uffd);
+  else
+    TM_INFO("Registered region: %p + %zu bytes (slot %d)", addr, length,
+            slot);
   return 0;
 }
 
+/* Called with regions_lock held */
+static void release_region(managed_region_t *r) {
+  struct uffdio_range range = {.start = (unsigned long)r->base_addr,
+                               .len = r->length};
+  ioctl(r->uffd, UFFDIO_UNREGISTER, &range);
+
+  /* A private handler uses the slot without checking it: stop it first */
+  uffd_group_t *g = r->group != UFFD_GROUP_SHARED ? find_group_by_fd(r->uffd)
+                                                  : NULL;
+  if (g != NULL && --g->regions == 0)
+    release_group(g);
+
+  region_write_begin(r);
+  r->active = false;
+  region_write_end(r);
+}
+
 void unregister_managed_region(void *addr) {
   pthread_mutex_lock(&g_manager.regions_lock);
   for (int i = 0; i < MAX_MANAGED_REGIONS; i++) {
     if (g_manager.regions[i].active && g_manager.regions[i].base_addr == addr) {
-      struct uffdio_range range = {.start = (unsigned long)addr,
-                                   .len = g_manager.regions[i].length};
-      ioctl(g_manager.uffd, UFFDIO_UNREGISTER, &range);
-      g_manager.regions[i].active = false;
+      release_region(&g_manager.regions[i]);
       g_manager.region_count--;
       TM_INFO("Unregistered region: %p", addr);
       break;
@@ -137,65 +364,91 @@ void unregister_managed_region(void *addr) {
  * FAULT HANDLING
  *===========================================================================*/
 
-/* Initial placement policy: DRAM first, fall back to NVM if full */
-static memory_tier_t decide_initial_placement(void *fault_addr) {
+/* Initial placement policy: DRAM first, fall back to NVM if full.
+ * Reserves the page in the chosen tier. */
+static memory_tier_t reserve_initial_placement(void *fault_addr) {
   (void)fault_addr; /* Reserved for ML-based placement */
 
   tier_config_t *dram = &g_manager.tiers[TIER_DRAM];
   tier_config_t *nvm = &g_manager.tiers[TIER_NVM];
 
-  if (dram->used + PAGE_SIZE <= dram->capacity)
+  if (tier_reserve_page(dram))
     return TIER_DRAM;
-  if (nvm->used + PAGE_SIZE <= nvm->capacity)
+  if (tier_reserve_page(nvm))
     return TIER_NVM;
 
   TM_ERROR("Both tiers full!");
+  atomic_fetch_add(&dram->used, PAGE_SIZE);
   return TIER_DRAM;
 }
 
-static int resolve_page_fault(void *fault_addr, memory_tier_t tier) {
+static bool region_contains(const managed_region_t *r, void *page_addr) {
+  return r->active && page_addr >= r->base_addr &&
+         page_addr < r->base_addr + r->length;
+}
+
+/* Lock-free lookup: a slot counts only if `seq` was even and unchanged */
+static managed_region_t *find_region(uffd_worker_t *w, void *page_addr) {
+  for (int n = 0; n < MAX_MANAGED_REGIONS; n++) {
+    int i = (w->region_hint + n) % MAX_MANAGED_REGIONS;
+    managed_region_t *r = &g_manager.regions[i];
+    uint32_t seq = atomic_load_explicit(&r->seq, memory_order_acquire);
+    if (seq & 1)
+      continue; /* Being registered or unregistered */
+    bool hit = region_contains(r, page_addr);
+    atomic_thread_fence(memory_order_acquire);
+    if (hit && atomic_load_explicit(&r->seq, memory_order_relaxed) == seq) {
+      w->region_hint = i;
+      return r;
+    }
+  }
+  return NULL;
+}
+
+static int resolve_page_fault(uffd_worker_t *w, void *fault_addr) {
   void *page_addr = page_align(fault_addr);
-  tier_config_t *tier_config = &g_manager.tiers[tier];
+  memory_tier_t tier = reserve_initial_placement(page_addr);
 
+  /* UFFDIO_COPY only reads it, so it stays zero */
   static __thread char zero_page[PAGE_SIZE] __attribute__((aligned(PAGE_SIZE)));
-  memset(zero_page, 0, PAGE_SIZE);
 
   struct uffdio_copy uffdio_copy = {.dst = (unsigned long)page_addr,
                                     .src = (unsigned long)zero_page,
                                     .len = PAGE_SIZE,
                                     .mode = 0};
 
-  if (ioctl(g_manager.uffd, UFFDIO_COPY, &uffdio_copy) < 0) {
-    if (errno == EEXIST)
-      return 0; /* Race condition, harmless */
-    TM_ERROR("UFFDIO_COPY failed for %p: %s", page_addr, strerror(errno));
+  if (ioctl(w->uffd, UFFDIO_COPY, &uffdio_copy) < 0) {
+    int err = errno;
+    atomic_fetch_sub(&g_manager.tiers[tier].used, PAGE_SIZE);
+    if (err == EEXIST) {
+      /* Race condition, harmless */
+      atomic_fetch_add_explicit(&w->duplicates, 1, memory_order_relaxed);
+      return 0;
+    }
+    TM_ERROR("UFFDIO_COPY failed for %p: %s", page_addr, strerror(err));
     return -1;
   }
 
-  tier_config->used += PAGE_SIZE;
+  if (tier == TIER_DRAM)
+    wake_demotion_daemon();
 
   page_stats_t *stats = get_or_create_page_stats(page_addr);
   if (stats) {
     stats->current_tier = tier;
-    record_page_access(page_addr, false);
+    record_page_stats_access(stats, false);
   }
 
   /* Update region stats */
-  pthread_mutex_lock(&g_manager.regions_lock);
-  for (int i = 0; i < MAX_MANAGED_REGIONS; i++) {
-    managed_region_t *r = &g_manager.regions[i];
-    if (r->active && page_addr >= r->base_addr &&
-        page_addr < r->base_addr + r->length) {
-      atomic_fetch_add(&r->total_faults, 1);
-      if (tier == TIER_DRAM)
-        atomic_fetch_add(&r->pages_in_dram, 1);
-      else
-        atomic_fetch_add(&r->pages_in_nvm, 1);
-      break;
-    }
+  managed_region_t *r = w->region ? w->region : find_region(w, page_addr);
+  if (r != NULL) {
+    atomic_fetch_add(&r->total_faults, 1);
+    if (tier == TIER_DRAM)
+      atomic_fetch_add(&r->pages_in_dram, 1);
+    else
+      atomic_fetch_add(&r->pages_in_nvm, 1);
   }
-  pthread_mutex_unlock(&g_manager.regions_lock);
 
+  atomic_fetch_add_explicit(&w->faults, 1, memory_order_relaxed);
   atomic_fetch_add(&g_manager.total_faults, 1);
   TM_DEBUG("Resolved fault at %p -> %s", page_addr,
            tier == TIER_DRAM ? "DRAM" : "NVM");
@@ -207,13 +460,18 @@ static int resolve_page_fault(void *fault_addr, memory_tier_t tier) {
  *===========================================================================*/
 
 static void *uffd_handler_thread(void *arg) {
-  (void)arg;
-  TM_INFO("UFFD handler thread running");
-
-  struct pollfd pollfd = {.fd = g_manager.uffd, .events = POLLIN};
-
-  while (g_manager.threads_running) {
-    int ret = poll(&pollfd, 1, 100);
+  uffd_worker_t *w = arg;
+  TM_DEBUG("UFFD handler thread %d running (fd=%d)", w->index, w->uffd);
+
+  /* Group handlers also watch their wake eventfd */
+  struct pollfd pollfds[2] = {{.fd = w->uffd, .events = POLLIN},
+                              {.fd = w->wake_fd, .events = POLLIN}};
+  nfds_t nfds = w->wake_fd >= 0 ? 2 : 1;
+  struct uffd_msg msgs[UFFD_READ_BATCH];
+
+  while (g_manager.threads_running &&
+         !atomic_load_explicit(&w->stop, memory_order_relaxed)) {
+    int ret = poll(pollfds, nfds, 100);
     if (ret < 0) {
       if (errno == EINTR)
         continue;
@@ -223,14 +481,14 @@ static void *uffd_handler_thread(void *arg) {
     if (ret == 0)
       continue;
 
-    if (pollfd.revents & POLLERR) {
+    if (pollfds[0].revents & POLLERR) {
       TM_ERROR("POLLERR on userfaultfd");
       break;
     }
 
-    if (pollfd.revents & POLLIN) {
-      struct uffd_msg msg;
-      ssize_t nread = read(g_manager.uffd, &msg, sizeof(msg));
+    if (pollfds[0].revents & POLLIN) {
+      /* Other handlers may have drained it first */
+      ssize_t nread = read(w->uffd, msgs, sizeof(msgs));
 
       if (nread < 0) {
         if (errno == EAGAIN)
@@ -238,36 +496,82 @@ static void *uffd_handler_thread(void *arg) {
         TM_ERROR("read() failed: %s", strerror(errno));
         break;
       }
-      if (nread != sizeof(msg))
+
+      uint64_t count = (uint64_t)nread / sizeof(msgs[0]);
+      if (count == 0)
         continue;
+      atomic_fetch_add_explicit(&w->reads, 1, memory_order_relaxed);
+      if (count > atomic_load_explicit(&w->max_batch, memory_order_relaxed))
+        atomic_store_explicit(&w->max_batch, count, memory_order_relaxed);
 
-      if (msg.event == UFFD_EVENT_PAGEFAULT) {
-        void *fault_addr = (void *)msg.arg.pagefault.address;
-        memory_tier_t tier = decide_initial_placement(fault_addr);
-        resolve_page_fault(fault_addr, tier);
+      for (uint64_t i = 0; i < count; i++) {
+        if (msgs[i].event == UFFD_EVENT_PAGEFAULT)
+          resolve_page_fault(w, (void *)msgs[i].arg.pagefault.address);
       }
     }
   }
 
-  TM_INFO("UFFD handler thread exiting");
+  TM_DEBUG("UFFD handler thread %d exiting", w->index);
   return NULL;
 }
 
 void stop_uffd_handler(void) {
-  pthread_join(g_manager.uffd_thread, NULL);
-  TM_INFO("UFFD handler thread stopped");
+  for (int i = 0; i < g_worker_count; i++)
+    pthread_join(g_workers[i].thread, NULL);
+
+  pthread_mutex_lock(&g_manager.regions_lock);
+  for (int i = 0; i < MAX_UFFD_GROUPS; i++) {
+    if (g_groups[i].active)
+      stop_group_handler(&g_groups[i]);
+  }
+  pthread_mutex_unlock(&g_manager.regions_lock);
+  TM_INFO("UFFD handler pool stopped (%d threads)", g_worker_count);
+}
+
+/*============================================================================
+ * REPORTING
+ *===========================================================================*/
+
+static void print_worker_stats(const uffd_worker_t *w) {
+  uint64_t reads = atomic_load(&w->reads);
+  uint64_t faults = atomic_load(&w->faults);
+  uint64_t duplicates = atomic_load(&w->duplicates);
+  printf("faults: %" PRIu64 "  duplicates: %" PRIu64 "  reads: %" PRIu64
+         " (%.1f msgs/read, max %" PRIu64 ")\n",
+         faults, duplicates, reads,
+         reads > 0 ? (double)(faults + duplicates) / reads : 0.0,
+         (uint64_t)atomic_load(&w->max_batch));
+}
+
+void print_uffd_handler_report(void) {
+  printf("Fault handlers: %d thread%s\n", g_worker_count,
+         g_worker_count == 1 ? "" : "s");
+  for (int i = 0; i < g_worker_count; i++) {
+    printf("  [%d] ", i);
+    print_worker_stats(&g_workers[i]);
+  }
+
+  pthread_mutex_lock(&g_manager.regions_lock);
+  for (int i = 0; i < MAX_UFFD_GROUPS; i++) {
+    const uffd_group_t *g = &g_groups[i];
+    if (!g->active)
+      continue;
+    if (g->id == UFFD_GROUP_PRIVATE)
+      printf("  private fd %d (%p) ", g->worker.uffd,
+             g->worker.region->base_addr);
+    else
+      printf("  group %d fd %d (%d region%s) ", g->id, g->worker.uffd,
+             g->regions, g->regions == 1 ? "" : "s");
+    print_worker_stats(&g->worker);
+  }
+  pthread_mutex_unlock(&g_manager.regions_lock);
 }
 
 void cleanup_userfaultfd(void) {
   pthread_mutex_lock(&g_manager.regions_lock);
   for (int i = 0; i < MAX_MANAGED_REGIONS; i++) {
-    if (g_manager.regions[i].active) {
-      struct uffdio_range range = {
-          .start = (unsigned long)g_manager.regions[i].base_addr,
-          .len = g_manager.regions[i].length};
-      ioctl(g_manager.uffd, UFFDIO_UNREGISTER, &range);
-      g_manager.regions[i].active = false;
-    }
+    if (g_manager.regions[i].active)
+      release_region(&g_manager.regions[i]);
   }
   g_manager.region_count = 0;
   pthread_mutex_unlock(&g_manager.regions_lock);
@@ -63,7 +63,9 @@ void testcase_hot_cold_split(void *region, size_t size) {
  * Expected behavior:
  *   - No single page should stay "hot" for long.
  *   - Anti-thrashing guard (min_residence_ns) should prevent
- *     excessive ping-ponging between tiers.
+ *     excessive ping-ponging between tiers; pages that still bounce
+ *     get a growing per-page residence backoff (see "Ping-pong" in
+ *     the status report).
  *===========================================================================*/
 
 void testcase_sequential_scan(void *region, size_t size) {
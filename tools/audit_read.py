@@ -0,0 +1,141 @@
+#!/usr/bin/env python3
+"""
+audit_read.py - Read a migration decision audit stream with numpy
+
+Loads files written with TM_AUDIT_FILE=path (layout: src/decision_audit.h).
+Record frames are viewed in place as a numpy structured array, so no record
+is parsed in Python.
+
+As a library:
+
+    from audit_read import read_audit
+    audit = read_audit("audit.bin")
+    audit["records"]["page_addr"], audit["records"]["outcome"], ...
+    audit["reasons"][code]             # decision->reason text
+
+Records are sorted by timestamp. Per-thread ring order is kept as
+"sequence". A gap in a thread's sequence numbers means the ring was full
+and records were dropped; audit["gaps"] counts them.
+
+As a script:
+
+    tools/audit_read.py audit.bin                 # outcome summary
+    tools/audit_read.py audit.bin --page 0x7f...  # one page's history
+
+LDOS Research Project, UT Austin
+"""
+
+import argparse
+import sys
+
+import numpy as np
+
+MAGIC = b"TMAU"
+VERSION = 1
+FRAME_RECORDS = 0x53434552
+FRAME_REASONS = 0x534E5352
+
+FILE_HEADER = np.dtype([
+    ("magic", "S4"), ("version", "<u4"), ("record_bytes", "<u4"),
+    ("reserved", "<u4"), ("start_time_ns", "<u8")])
+FRAME = np.dtype([("magic", "<u4"), ("count", "<u4"), ("bytes", "<u8")])
+RECORD = np.dtype([
+    ("timestamp_ns", "<u8"), ("page_addr", "<u8"), ("confidence", "<f4"),
+    ("reason", "<u2"), ("from_tier", "u1"), ("to_tier", "u1"),
+    ("outcome", "u1"), ("thread", "u1"), ("reserved", "<u2"),
+    ("sequence", "<u4")])
+
+OUTCOMES = {0: "executed", 1: "no_stats", 2: "tier_full", 3: "stale",
+            4: "backoff", 5: "paused", 16: "swapped", 17: "deferred",
+            18: "dropped_busy", 19: "unprofitable"}
+TIERS = {0: "?", 1: "DRAM", 2: "NVM"}
+
+
+def parse_reasons(payload, count, reasons):
+    pos = 0
+    for _ in range(count):
+        code, length = np.frombuffer(payload, "<u2", 2, pos)
+        pos += 4
+        reasons[int(code)] = bytes(payload[pos:pos + length]).decode()
+        pos += length
+
+
+def count_gaps(records):
+    gaps = 0
+    for thread in np.unique(records["thread"]):
+        seq = np.sort(records["sequence"][records["thread"] == thread])
+        gaps += int((np.diff(seq.astype(np.int64)) - 1).sum())
+    return gaps
+
+
+def read_audit(path):
+    data = np.memmap(path, np.uint8, "r")
+    header = np.frombuffer(data, FILE_HEADER, 1)[0]
+    if header["magic"] != MAGIC or header["version"] != VERSION:
+        raise ValueError(f"{path}: not a version {VERSION} audit file")
+    if header["record_bytes"] != RECORD.itemsize:
+        raise ValueError(f"{path}: {header['record_bytes']}-byte records")
+
+    reasons = {0: "unknown"}
+    frames = []
+    pos = FILE_HEADER.itemsize
+    while pos + FRAME.itemsize <= len(data):
+        frame = np.frombuffer(data, FRAME, 1, pos)[0]
+        start = pos + FRAME.itemsize
+        end = start + int(frame["bytes"])
+        if end > len(data):
+            break  # Cut short while the sink was writing
+        if frame["magic"] == FRAME_RECORDS:
+            frames.append(np.frombuffer(data, RECORD, int(frame["count"]),
+                                        start))
+        elif frame["magic"] == FRAME_REASONS:
+            parse_reasons(data[start:end], int(frame["count"]), reasons)
+        else:
+            raise ValueError(f"{path}: bad frame at offset {pos}")
+        pos = end
+
+    records = np.concatenate(frames) if frames else np.empty(0, RECORD)
+    records = records[np.argsort(records["timestamp_ns"], kind="stable")]
+    return {"records": records, "reasons": reasons,
+            "start_time_ns": int(header["start_time_ns"]),
+            "gaps": count_gaps(records)}
+
+
+def describe(record, audit):
+    t = (int(record["timestamp_ns"]) - audit["start_time_ns"]) / 1e6
+    return (f"{t:10.1f}ms  0x{int(record['page_addr']):x}  "
+            f"{TIERS.get(int(record['from_tier']), '?')}->"
+            f"{TIERS.get(int(record['to_tier']), '?')}  "
+            f"{OUTCOMES.get(int(record['outcome']), 'unknown'):12s} "
+            f"conf {record['confidence']:.2f}  "
+            f"{audit['reasons'].get(int(record['reason']), '?')}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[1])
+    parser.add_argument("path", help="TM_AUDIT_FILE output")
+    parser.add_argument("--page", type=lambda s: int(s, 0),
+                        help="print this page's decisions in order")
+    args = parser.parse_args()
+
+    audit = read_audit(args.path)
+    records = audit["records"]
+    if args.page is not None:
+        for record in records[records["page_addr"] == args.page]:
+            print(describe(record, audit))
+        return
+
+    print(f"{args.path}: {len(records)} decisions, "
+          f"{len(np.unique(records['page_addr']))} distinct pages, "
+          f"{len(np.unique(records['thread']))} threads, "
+          f"{audit['gaps']} dropped")
+    outcomes, counts = np.unique(records["outcome"], return_counts=True)
+    for outcome, count in zip(outcomes, counts):
+        print(f"  {OUTCOMES.get(int(outcome), 'unknown'):12s} {count}")
+    codes, counts = np.unique(records["reason"], return_counts=True)
+    for code, count in sorted(zip(codes, counts), key=lambda c: -c[1]):
+        print(f"  {count:8d}  {audit['reasons'].get(int(code), '?')}")
+
+
+if __name__ == "__main__":
+    sys.exit(main())
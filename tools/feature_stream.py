@@ -0,0 +1,182 @@
+#!/usr/bin/env python3
+"""
+feature_stream.py - Follow a running manager's feature stream
+
+Attaches to TM_FEATURE_STREAM=<socket> (protocol: src/feature_stream.h).
+The manager sends a read-only descriptor for its shared ring, which is
+mapped here. Each block's records are returned as a numpy structured array
+that views the shared memory directly, without a copy. Views are only
+valid until the producer laps them; follow() checks for that after the
+caller is done with a block. Detaching is just closing the connection, and
+the manager never waits for this process.
+
+As a library:
+
+    from feature_stream import FeatureStream
+    with FeatureStream("/tmp/tm.features") as stream:
+        for block, records in stream.follow():
+            model.partial_fit(records["heat_score"], ...)
+
+follow() yields (block, records). `block` is a dict (cycle, timestamp_ns,
+records, flags, keyframe, continued). A cycle's snapshot can arrive as
+several blocks; all but the first have `continued` set. `records` has the
+dataset_record_t fields: cycle, timestamp_ns, page_addr, heat_score,
+access_count, read_count, write_count, migration_count, current_tier and
+flags. stream.overruns
+counts blocks lost because the consumer fell behind.
+
+As a script (prints one line per cycle):
+
+    tools/feature_stream.py /tmp/tm.features [--blocks N]
+
+LDOS Research Project, UT Austin
+"""
+
+import argparse
+import mmap
+import os
+import socket
+import sys
+import time
+
+import numpy as np
+
+MAGIC = b"TMFS"
+VERSION = 1
+BLOCK_KEYFRAME = 0x1
+BLOCK_CONTINUED = 0x2
+
+HELLO = np.dtype([("magic", "S4"), ("version", "<u4"), ("map_bytes", "<u8")])
+HEADER = np.dtype([
+    ("magic", "S4"), ("version", "<u4"), ("record_bytes", "<u4"),
+    ("block_bytes", "<u4"), ("ring_records", "<u4"), ("block_slots", "<u4"),
+    ("blocks_offset", "<u8"), ("records_offset", "<u8"),
+    ("map_bytes", "<u8"), ("start_time_ns", "<u8")])
+HEAD_OFFSET = 64  # record_head, then block_head
+BLOCK = np.dtype([
+    ("sequence", "<u8"), ("cycle", "<u8"), ("timestamp_ns", "<u8"),
+    ("first_record", "<u8"), ("records", "<u4"), ("flags", "<u4"),
+    ("reserved", "<u8")])
+RECORD = np.dtype([
+    ("cycle", "<u8"), ("timestamp_ns", "<u8"), ("page_addr", "<u8"),
+    ("heat_score", "<f8"), ("access_count", "<u8"), ("read_count", "<u8"),
+    ("write_count", "<u8"), ("migration_count", "<u4"),
+    ("current_tier", "<u2"), ("flags", "<u2")])
+
+
+class FeatureStream:
+    def __init__(self, path):
+        self.sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        self.sock.connect(path)
+        msg, fds, _, _ = socket.recv_fds(self.sock, HELLO.itemsize, 1)
+        if len(msg) != HELLO.itemsize or not fds:
+            raise ConnectionError(f"{path}: no descriptor in handshake")
+        hello = np.frombuffer(msg, HELLO)[0]
+        if hello["magic"] != MAGIC or hello["version"] != VERSION:
+            raise ConnectionError(f"{path}: not a version {VERSION} stream")
+
+        self.map = mmap.mmap(fds[0], int(hello["map_bytes"]),
+                             mmap.MAP_SHARED, mmap.PROT_READ)
+        os.close(fds[0])
+        header = np.frombuffer(self.map, HEADER, 1)[0]
+        if header["record_bytes"] != RECORD.itemsize:
+            raise ConnectionError(f"{path}: {header['record_bytes']}-byte "
+                                  "records")
+        self.ring_records = int(header["ring_records"])
+        self.block_slots = int(header["block_slots"])
+        self.heads = np.frombuffer(self.map, "<u8", 2, HEAD_OFFSET)
+        self.blocks = np.frombuffer(self.map, BLOCK, self.block_slots,
+                                    int(header["blocks_offset"]))
+        self.records = np.frombuffer(self.map, RECORD, self.ring_records,
+                                     int(header["records_offset"]))
+        self.next_block = int(self.heads[1])  # Start with the next block
+        self.overruns = 0
+
+    def close(self):
+        self.sock.close()  # The manager sees the hangup and detaches us
+        self.heads = self.blocks = self.records = None
+        try:
+            self.map.close()
+        except BufferError:
+            pass  # Caller still holds record views; unmapped with them
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def poll(self):
+        """Return the available blocks as [(block, records)]."""
+        head = int(self.heads[1])
+        if head - self.next_block > self.block_slots:
+            self.overruns += head - self.block_slots - self.next_block
+            self.next_block = head - self.block_slots
+        out = []
+        for n in range(self.next_block, head):
+            desc = self.blocks[n % self.block_slots].copy()
+            if desc["sequence"] != n + 1:
+                self.overruns += 1
+                continue
+            first = int(desc["first_record"])
+            start = first % self.ring_records
+            records = self.records[start:start + int(desc["records"])]
+            block = {"cycle": int(desc["cycle"]),
+                     "timestamp_ns": int(desc["timestamp_ns"]),
+                     "records": int(desc["records"]),
+                     "flags": int(desc["flags"]),
+                     "keyframe": bool(desc["flags"] & BLOCK_KEYFRAME),
+                     "continued": bool(desc["flags"] & BLOCK_CONTINUED),
+                     "first_record": first}
+            out.append((block, records))
+        self.next_block = head
+        return out
+
+    def valid(self, block):
+        """True if a block's records were not overwritten while in use."""
+        return int(self.heads[0]) - block["first_record"] <= \
+            self.ring_records
+
+    def follow(self, interval=0.01):
+        """Yield blocks as they are published; skips lapped blocks."""
+        while True:
+            batch = self.poll()
+            if not batch:
+                time.sleep(interval)
+                continue
+            for block, records in batch:
+                if not self.valid(block):
+                    self.overruns += 1
+                    continue
+                yield block, records
+                if not self.valid(block):
+                    self.overruns += 1  # Caller read torn records
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[1])
+    parser.add_argument("path", help="TM_FEATURE_STREAM socket")
+    parser.add_argument("--blocks", type=int, default=0,
+                        help="detach after this many blocks (0: never)")
+    args = parser.parse_args()
+
+    seen = 0
+    with FeatureStream(args.path) as stream:
+        try:
+            for block, records in stream.follow():
+                print(f"cycle {block['cycle']:6d}  {len(records):6d} pages"
+                      f"{'  keyframe' if block['keyframe'] else ''}"
+                      f"{'  (cont.)' if block['continued'] else ''}"
+                      f"  heat mean {records['heat_score'].mean():.3f}"
+                      f"  in NVM {np.mean(records['current_tier'] == 2):.1%}",
+                      flush=True)
+                seen += 1
+                if seen == args.blocks:
+                    break
+        except KeyboardInterrupt:
+            pass
+        print(f"{seen} blocks, {stream.overruns} overrun", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
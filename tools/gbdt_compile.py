@@ -0,0 +1,256 @@
+#!/usr/bin/env python3
+"""
+gbdt_compile.py - Compile a tree ensemble into a C migration policy
+
+Reads a trained tree ensemble and emits a C translation unit defining
+`tm_gbdt_model` (see src/gbdt.h). Every tree is padded to the ensemble's
+maximum depth so evaluation is a fixed number of branch-free steps:
+
+    node = 2 * node + 1 + (x[split[node]] >= threshold[node])
+
+Thresholds, split features and leaf values are emitted as constants.
+
+Input: XGBoost's JSON dump (Booster.dump_model(fname, dump_format="json"))
+either as a bare list of trees or wrapped as
+
+    {"base_score": 0.5, "trees": [...]}     # base_score is a probability
+    {"base_margin": 0.0, "trees": [...]}    # or a logit
+
+Split features are named either after the runtime features ("heat_score",
+"log_idle_ms", ...; see feature_index_t in src/page_features.h) or
+positionally ("f0", "f1", ...). XGBoost's split rule is x < threshold ->
+"yes" child; the missing-value branch is ignored because runtime features
+are never missing.
+
+Usage:
+    tools/gbdt_compile.py model.json -o obj/gbdt_model.c
+
+LDOS Research Project, UT Austin
+"""
+
+import argparse
+import json
+import math
+import os
+import re
+import sys
+
+MAX_DEPTH = 12  # 4095 nodes per tree; deeper trees are almost certainly a mistake
+
+REPO_ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+FEATURES_HEADER = os.path.join(REPO_ROOT, "src", "page_features.h")
+
+
+def load_feature_names(header):
+    """Feature names in index order, parsed from feature_index_t."""
+    with open(header) as f:
+        text = f.read()
+    match = re.search(r"typedef enum \{(.*?)\} feature_index_t;", text, re.S)
+    if match is None:
+        sys.exit(f"error: feature_index_t not found in {header}")
+    names = re.findall(r"^\s*FEAT_(\w+)", match.group(1), re.M)
+    return [name.lower() for name in names]
+
+
+class Node:
+    __slots__ = ("feature", "threshold", "yes", "no", "leaf")
+
+    def __init__(self, feature=None, threshold=None, yes=None, no=None,
+                 leaf=None):
+        self.feature = feature
+        self.threshold = threshold
+        self.yes = yes
+        self.no = no
+        self.leaf = leaf
+
+
+def parse_feature(split, features):
+    if split in features:
+        return features.index(split)
+    match = re.fullmatch(r"f(\d+)", split)
+    if match and int(match.group(1)) < len(features):
+        return int(match.group(1))
+    sys.exit(f"error: unknown split feature '{split}' "
+             f"(expected one of {', '.join(features)} or f0..f{len(features) - 1})")
+
+
+def parse_tree(node, features):
+    if "leaf" in node:
+        return Node(leaf=float(node["leaf"]))
+
+    children = {child["nodeid"]: child for child in node["children"]}
+    return Node(feature=parse_feature(str(node["split"]), features),
+                threshold=float(node["split_condition"]),
+                yes=parse_tree(children[node["yes"]], features),
+                no=parse_tree(children[node["no"]], features))
+
+
+def tree_depth(node):
+    if node.leaf is not None:
+        return 0
+    return 1 + max(tree_depth(node.yes), tree_depth(node.no))
+
+
+def flatten(root, depth):
+    """
+    Complete binary tree of `depth` levels in heap order. A leaf above the
+    bottom level becomes a split that always goes left (x >= inf is false)
+    down to a copy of the leaf.
+    """
+    n_nodes = (1 << depth) - 1
+    split = [0] * n_nodes
+    threshold = [math.inf] * n_nodes
+    leaves = [0.0] * (1 << depth)
+
+    def place(node, index, level):
+        if level == depth:
+            leaves[index - n_nodes] = node.leaf
+            return
+        if node.leaf is not None:
+            place(node, 2 * index + 1, level + 1)
+            place(node, 2 * index + 2, level + 1)
+            return
+        split[index] = node.feature
+        threshold[index] = node.threshold
+        place(node.yes, 2 * index + 1, level + 1)
+        place(node.no, 2 * index + 2, level + 1)
+
+    place(root, 0, 0)
+    return split, threshold, leaves
+
+
+def c_float(value):
+    if math.isinf(value):
+        return "INFINITY" if value > 0 else "-INFINITY"
+    text = repr(float(value))
+    if "e" not in text and "." not in text:
+        text += ".0"
+    return text + "f"
+
+
+def c_array(values, fmt, per_line):
+    items = [fmt(v) for v in values]
+    lines = [", ".join(items[i:i + per_line])
+             for i in range(0, len(items), per_line)]
+    return "\n".join("        " + line + "," for line in lines)
+
+
+def generate(trees, base_margin, depth, n_features, source):
+    n_trees = len(trees)
+    n_nodes = (1 << depth) - 1
+    n_leaves = 1 << depth
+    tables = [flatten(tree, depth) for tree in trees]
+
+    out = []
+    emit = out.append
+    emit("/*")
+    emit(f" * Generated by tools/gbdt_compile.py from {source}")
+    emit(" * DO NOT EDIT - regenerate with `make gbdt GBDT_MODEL=...`")
+    emit(" */")
+    emit("")
+    emit('#include "gbdt.h"')
+    emit("#include <math.h>")
+    emit("")
+    emit(f"#define GBDT_TREES {n_trees}")
+    emit(f"#define GBDT_DEPTH {depth}")
+    emit(f"#define GBDT_NODES {n_nodes}")
+    emit(f"#define GBDT_LEAVES {n_leaves}")
+    emit("")
+    emit(f"_Static_assert(TM_FEATURE_COUNT == {n_features},")
+    emit('               "page_features.h changed since the model was compiled");')
+    emit("")
+    emit("static const uint8_t gbdt_split[GBDT_TREES][GBDT_NODES] = {")
+    for split, _, _ in tables:
+        emit("    {")
+        emit(c_array(split, str, 16))
+        emit("    },")
+    emit("};")
+    emit("")
+    emit("static const float gbdt_threshold[GBDT_TREES][GBDT_NODES] = {")
+    for _, threshold, _ in tables:
+        emit("    {")
+        emit(c_array(threshold, c_float, 4))
+        emit("    },")
+    emit("};")
+    emit("")
+    emit("static const float gbdt_leaf[GBDT_TREES][GBDT_LEAVES] = {")
+    for _, _, leaves in tables:
+        emit("    {")
+        emit(c_array(leaves, c_float, 4))
+        emit("    },")
+    emit("};")
+    emit("")
+    emit("static void gbdt_eval_block(const float *in, float logits[FEATURE_BLOCK]) {")
+    emit("  float acc[FEATURE_BLOCK];")
+    emit("  for (int p = 0; p < FEATURE_BLOCK; p++)")
+    emit(f"    acc[p] = {c_float(base_margin)};")
+    emit("")
+    emit("  for (int t = 0; t < GBDT_TREES; t++) {")
+    emit("    const uint8_t *split = gbdt_split[t];")
+    emit("    const float *threshold = gbdt_threshold[t];")
+    emit("    uint32_t node[FEATURE_BLOCK] = {0};")
+    emit("    for (int level = 0; level < GBDT_DEPTH; level++) {")
+    emit("      for (int p = 0; p < FEATURE_BLOCK; p++) {")
+    emit("        uint32_t n = node[p];")
+    emit("        float x = in[split[n] * FEATURE_BLOCK + p];")
+    emit("        node[p] = 2 * n + 1 + (uint32_t)(x >= threshold[n]);")
+    emit("      }")
+    emit("    }")
+    emit("    for (int p = 0; p < FEATURE_BLOCK; p++)")
+    emit("      acc[p] += gbdt_leaf[t][node[p] - GBDT_NODES];")
+    emit("  }")
+    emit("")
+    emit("  for (int p = 0; p < FEATURE_BLOCK; p++)")
+    emit("    logits[p] = acc[p];")
+    emit("}")
+    emit("")
+    emit("const gbdt_model_t tm_gbdt_model = {")
+    emit(f"    .source = {json.dumps(os.path.basename(source))},")
+    emit("    .n_trees = GBDT_TREES,")
+    emit("    .depth = GBDT_DEPTH,")
+    emit("    .n_features = TM_FEATURE_COUNT,")
+    emit("    .eval_block = gbdt_eval_block,")
+    emit("};")
+    return "\n".join(out) + "\n"
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Compile a tree ensemble into a C migration policy")
+    parser.add_argument("model", help="XGBoost JSON dump")
+    parser.add_argument("-o", "--output", required=True,
+                        help="generated C file")
+    args = parser.parse_args()
+
+    with open(args.model) as f:
+        dump = json.load(f)
+
+    base_margin = 0.0
+    if isinstance(dump, dict):
+        if "base_margin" in dump:
+            base_margin = float(dump["base_margin"])
+        elif "base_score" in dump:
+            p = min(max(float(dump["base_score"]), 1e-6), 1.0 - 1e-6)
+            base_margin = math.log(p / (1.0 - p))
+        dump = dump["trees"]
+
+    features = load_feature_names(FEATURES_HEADER)
+    if len(features) > 256:
+        sys.exit("error: split feature indices are stored as uint8_t")
+    trees = [parse_tree(tree, features) for tree in dump]
+    if not trees:
+        sys.exit("error: model has no trees")
+
+    depth = max(1, max(tree_depth(tree) for tree in trees))
+    if depth > MAX_DEPTH:
+        sys.exit(f"error: tree depth {depth} exceeds {MAX_DEPTH}")
+
+    code = generate(trees, base_margin, depth, len(features), args.model)
+    with open(args.output, "w") as f:
+        f.write(code)
+    print(f"{args.output}: {len(trees)} trees, depth {depth}, "
+          f"{len(features)} features")
+
+
+if __name__ == "__main__":
+    main()
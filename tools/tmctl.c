@@ -0,0 +1,96 @@
+/*
+ * tmctl.c - Control Socket Client
+ *
+ * Sends one command to a running manager's control socket
+ * (control_socket.c) and prints the reply:
+ *
+ *   tmctl [-s socket] get [name...]
+ *   tmctl [-s socket] set hot_threshold=0.8 max_migrations_per_cycle=32
+ *   tmctl [-s socket] stats | flush | scan | pause | resume | help
+ *   tmctl [-s socket] plugin load <path> | plugin unload
+ *
+ * The socket defaults to $TM_CONTROL_SOCKET. Exits 0 if the reply ends
+ * in "OK", 1 on "ERR", 2 if the manager could not be reached.
+ *
+ * LDOS Research Project, UT Austin
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "usage: %s [-s socket] command [args...]\n"
+          "commands: get [name...], set name=value [...], stats, flush,\n"
+          "          scan, pause, resume, help,\n"
+          "          plugin load <path>, plugin unload\n"
+          "socket defaults to $TM_CONTROL_SOCKET\n",
+          argv0);
+}
+
+int main(int argc, char **argv) {
+  const char *path = getenv("TM_CONTROL_SOCKET");
+  int first = 1;
+  if (argc > 2 && strcmp(argv[1], "-s") == 0) {
+    path = argv[2];
+    first = 3;
+  }
+  if (first >= argc || path == NULL || path[0] == '\0') {
+    usage(argv[0]);
+    return 2;
+  }
+
+  struct sockaddr_un addr = {.sun_family = AF_UNIX};
+  if (strlen(path) >= sizeof(addr.sun_path)) {
+    fprintf(stderr, "tmctl: socket path too long\n");
+    return 2;
+  }
+  strcpy(addr.sun_path, path);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    fprintf(stderr, "tmctl: %s: %s\n", path, strerror(errno));
+    return 2;
+  }
+
+  /* One command line: the arguments joined by spaces */
+  char line[4096];
+  size_t len = 0;
+  for (int i = first; i < argc; i++) {
+    int n = snprintf(line + len, sizeof(line) - len, "%s%s",
+                     i > first ? " " : "", argv[i]);
+    if (n < 0 || (size_t)n >= sizeof(line) - len - 1) {
+      fprintf(stderr, "tmctl: command too long\n");
+      return 2;
+    }
+    len += (size_t)n;
+  }
+  line[len++] = '\n';
+  if (write(fd, line, len) != (ssize_t)len) {
+    fprintf(stderr, "tmctl: write: %s\n", strerror(errno));
+    return 2;
+  }
+  shutdown(fd, SHUT_WR);
+
+  /* Print the reply; its last line decides the exit status */
+  FILE *in = fdopen(fd, "r");
+  if (in == NULL)
+    return 2;
+  char reply[4096];
+  int status = 2;
+  while (fgets(reply, sizeof(reply), in) != NULL) {
+    fputs(reply, stdout);
+    if (strncmp(reply, "OK", 2) == 0)
+      status = 0;
+    else if (strncmp(reply, "ERR", 3) == 0)
+      status = 1;
+  }
+  fclose(in);
+  return status;
+}
@@ -0,0 +1,342 @@
+#!/usr/bin/env python3
+"""
+tmds_read.py - Read a binary columnar dataset (TMDS) with numpy
+
+Loads ml_dataset_<label>.tmds files written with TM_DATASET_FORMAT=binary
+(layout: src/dataset_format.h). The file is mmap'ed. Each block's columns
+are decoded with vectorized numpy operations, so no row is parsed in
+Python.
+
+As a library:
+
+    from tmds_read import read_tmds
+    data = read_tmds("ml_dataset_default.tmds")
+    data["heat_score"], data["access_count"], data["page_addr"], ...
+
+Every column comes back as one array over all rows. "cycle" and
+"timestamp_ns" are expanded per row, so the arrays line up with the CSV
+columns. In incremental files (data["incremental"]) the boolean
+"keyframe" column marks rows from complete snapshots; other rows are pages
+that changed since their previous row. data["region_maps"] lists each
+managed-region map as (cycle, [(base, length), ...]), together with the
+cycle from which it applies. The header's map comes first, at cycle 0.
+In labeled files (data["labeled"], TM_DATASET_LABEL_CYCLES) the
+"future_accesses" column is each row's label: the page's accesses over the
+next K cycles.
+
+Compressed files (TM_DATASET_FORMAT=compressed) are decompressed chunk by
+chunk, using the lz4 package if it is installed and a pure-Python LZ4
+block decoder otherwise. Pass cycles=(first, last) to read only that cycle
+range. For compressed files, only the chunks that overlap the range are
+decompressed; the chunk index in the file footer is used if present.
+Region maps are then only those seen in the chunks that were read.
+
+As a script:
+
+    tools/tmds_read.py ml_dataset_default.tmds             # summary
+    tools/tmds_read.py ml_dataset_default.tmds --csv out.csv
+    tools/tmds_read.py ml_dataset_default.tmds --cycles 1000 2000
+
+LDOS Research Project, UT Austin
+"""
+
+import argparse
+import sys
+
+import numpy as np
+
+MAGIC = b"TMDS"
+VERSIONS = (1, 2)  # Version 1 blocks have 7 column_bytes slots, not 8
+BLOCK_SAMPLES = 0x4B4C4253
+BLOCK_REGIONS = 0x4B4C4752
+FILE_INCREMENTAL = 0x1
+FILE_COMPRESSED = 0x2
+FILE_LABELED = 0x4
+BLOCK_KEYFRAME = 0x1
+CHUNK_MAGIC = 0x4B4E4843
+FOOTER_MAGIC = 0x58444954
+
+ENC_DELTA_VARINT = 1
+ENC_VARINT = 2
+ENC_U8 = 3
+ENC_FIXED16 = 4
+
+FILE_HEADER = np.dtype([
+    ("magic", "S4"), ("version", "<u4"), ("header_bytes", "<u4"),
+    ("column_count", "<u4"), ("region_count", "<u4"), ("page_shift", "<u4"),
+    ("heat_scale", "<u4"), ("flags", "<u4"), ("start_time_ns", "<u8"),
+])
+COLUMN = np.dtype([("name", "S24"), ("encoding", "<u4"), ("reserved", "<u4")])
+REGION = np.dtype([("base", "<u8"), ("length", "<u8")])
+BLOCK_PREFIX = np.dtype([
+    ("magic", "<u4"), ("records", "<u4"), ("cycle", "<u8"),
+    ("timestamp_ns", "<u8"), ("block_bytes", "<u4"),
+])
+BLOCK_HEADER_BYTES = 64
+CHUNK_HEADER = np.dtype([
+    ("magic", "<u4"), ("compressed_bytes", "<u4"), ("raw_bytes", "<u4"),
+    ("blocks", "<u4"), ("first_cycle", "<u8"), ("last_cycle", "<u8"),
+])
+INDEX_ENTRY = np.dtype([
+    ("offset", "<u8"), ("first_cycle", "<u8"), ("last_cycle", "<u8"),
+])
+FOOTER = np.dtype([("index_offset", "<u8"), ("chunk_count", "<u4"),
+                   ("magic", "<u4")])
+
+CSV_COLUMNS = ["cycle", "timestamp_ns", "page_addr", "current_tier",
+               "heat_score", "access_count", "read_count", "write_count",
+               "migration_count"]
+
+
+def decode_varints(buf, count):
+    """Decode `count` unsigned LEB128 varints from a uint8 array."""
+    ends = np.flatnonzero(buf < 0x80)
+    if len(ends) != count:
+        raise ValueError(f"expected {count} varints, found {len(ends)}")
+    if count == 0:
+        return np.zeros(0, dtype=np.uint64)
+    starts = np.empty_like(ends)
+    starts[0] = 0
+    starts[1:] = ends[:-1] + 1
+    lengths = ends - starts + 1
+    position = np.arange(len(buf)) - np.repeat(starts, lengths)
+    parts = (buf & 0x7F).astype(np.uint64) << (7 * position).astype(np.uint64)
+    return np.bitwise_or.reduceat(parts, starts)
+
+
+def lz4_block_decompress(src, raw_size):
+    """Decode one LZ4 block (the format written by src/lz_block.c)."""
+    try:
+        import lz4.block
+        return lz4.block.decompress(bytes(src), uncompressed_size=raw_size)
+    except ImportError:
+        pass
+
+    src = bytes(src)
+    out = bytearray()
+    i, n = 0, len(src)
+    while i < n:
+        token = src[i]
+        i += 1
+        length = token >> 4
+        if length == 15:
+            while True:
+                length += src[i]
+                i += 1
+                if src[i - 1] != 255:
+                    break
+        out += src[i:i + length]
+        i += length
+        if i >= n:
+            break  # Last sequence has no match
+
+        offset = src[i] | (src[i + 1] << 8)
+        i += 2
+        length = token & 15
+        if length == 15:
+            while True:
+                length += src[i]
+                i += 1
+                if src[i - 1] != 255:
+                    break
+        length += 4
+        start = len(out) - offset
+        if offset >= length:
+            out += out[start:start + length]
+        else:  # Overlapping copy repeats the last `offset` bytes
+            pattern = bytes(out[start:])
+            out += (pattern * (length // offset + 1))[:length]
+    if len(out) != raw_size:
+        raise ValueError(f"LZ4 chunk decoded to {len(out)}, not {raw_size}")
+    return bytes(out)
+
+
+def decode_column(buf, encoding, count, header):
+    if encoding == ENC_DELTA_VARINT:
+        pages = np.cumsum(decode_varints(buf, count), dtype=np.uint64)
+        return pages << np.uint64(header["page_shift"])
+    if encoding == ENC_VARINT:
+        return decode_varints(buf, count)
+    if encoding == ENC_U8:
+        return np.frombuffer(buf, dtype=np.uint8, count=count)
+    if encoding == ENC_FIXED16:
+        raw = np.frombuffer(buf, dtype="<u2", count=count)
+        return raw.astype(np.float64) / header["heat_scale"]
+    raise ValueError(f"unknown column encoding {encoding}")
+
+
+def chunk_offsets(data, start, cycles):
+    """Offsets of the chunk headers to read, from the footer or by walking."""
+    if len(data) >= start + FOOTER.itemsize:
+        footer = np.frombuffer(data, dtype=FOOTER, count=1,
+                               offset=len(data) - FOOTER.itemsize)[0]
+        if footer["magic"] == FOOTER_MAGIC:
+            index = np.frombuffer(data, dtype=INDEX_ENTRY,
+                                  count=int(footer["chunk_count"]),
+                                  offset=int(footer["index_offset"]))
+            if cycles is not None:
+                index = index[(index["last_cycle"] >= cycles[0]) &
+                              (index["first_cycle"] <= cycles[1])]
+            return [int(o) for o in index["offset"]]
+
+    offsets, offset = [], start
+    while offset + CHUNK_HEADER.itemsize <= len(data):
+        chunk = np.frombuffer(data, dtype=CHUNK_HEADER, count=1,
+                              offset=offset)[0]
+        end = offset + CHUNK_HEADER.itemsize + int(chunk["compressed_bytes"])
+        if chunk["magic"] != CHUNK_MAGIC or end > len(data):
+            break  # Index, or a chunk cut short
+        if cycles is None or (chunk["last_cycle"] >= cycles[0] and
+                              chunk["first_cycle"] <= cycles[1]):
+            offsets.append(offset)
+        offset = end
+    return offsets
+
+
+def block_streams(data, header, cycles):
+    """Yield uint8 arrays that each hold a whole number of blocks."""
+    start = int(header["header_bytes"])
+    if not header["flags"] & FILE_COMPRESSED:
+        yield data[start:]
+        return
+    for offset in chunk_offsets(data, start, cycles):
+        chunk = np.frombuffer(data, dtype=CHUNK_HEADER, count=1,
+                              offset=offset)[0]
+        begin = offset + CHUNK_HEADER.itemsize
+        payload = data[begin:begin + int(chunk["compressed_bytes"])]
+        if chunk["compressed_bytes"] == chunk["raw_bytes"]:
+            yield payload
+        else:
+            raw = lz4_block_decompress(payload, int(chunk["raw_bytes"]))
+            yield np.frombuffer(raw, dtype=np.uint8)
+
+
+def read_tmds(path, cycles=None):
+    data = np.memmap(path, dtype=np.uint8, mode="r")
+    header = np.frombuffer(data, dtype=FILE_HEADER, count=1)[0]
+    if header["magic"] != MAGIC:
+        raise ValueError(f"{path}: not a TMDS file")
+    if header["version"] not in VERSIONS:
+        raise ValueError(f"{path}: unsupported version {header['version']}")
+
+    offset = FILE_HEADER.itemsize
+    schema = np.frombuffer(data, dtype=COLUMN, count=header["column_count"],
+                           offset=offset)
+    offset += schema.nbytes
+    regions = np.frombuffer(data, dtype=REGION, count=header["region_count"],
+                            offset=offset)
+
+    parts = {c["name"].decode(): [] for c in schema}
+    parts.update(cycle=[], timestamp_ns=[], keyframe=[])
+    region_maps = [(0, regions)]
+    for stream in block_streams(data, header, cycles):
+        read_blocks(stream, path, header, schema, cycles, parts, region_maps)
+
+    result = {name: np.concatenate(chunks) if chunks else
+              np.zeros(0, dtype=bool if name == "keyframe" else np.uint64)
+              for name, chunks in parts.items()}
+    result["incremental"] = bool(header["flags"] & FILE_INCREMENTAL)
+    result["labeled"] = bool(header["flags"] & FILE_LABELED)
+    result["region_maps"] = [
+        (cycle, [(int(r["base"]), int(r["length"])) for r in regions])
+        for cycle, regions in region_maps]
+    result["start_time_ns"] = int(header["start_time_ns"])
+    return result
+
+
+def read_blocks(data, path, header, schema, cycles, parts, region_maps):
+    """Decode the blocks in `data`, appending per-block arrays to `parts`."""
+    offset = 0
+    while offset + BLOCK_HEADER_BYTES <= len(data):
+        block = np.frombuffer(data, dtype=BLOCK_PREFIX, count=1,
+                              offset=offset)[0]
+        records = int(block["records"])
+        end = offset + int(block["block_bytes"])
+        if end > len(data):
+            break  # Truncated final block (writer still running)
+        in_range = cycles is None or cycles[0] <= block["cycle"] <= cycles[1]
+
+        if block["magic"] == BLOCK_REGIONS:
+            regions = np.frombuffer(data, dtype=REGION, count=records,
+                                    offset=offset + BLOCK_HEADER_BYTES)
+            region_maps.append((int(block["cycle"]), regions))
+        elif block["magic"] != BLOCK_SAMPLES:
+            raise ValueError(f"{path}: bad block magic at offset {offset}")
+        elif in_range:
+            slots = 7 if header["version"] == 1 else 8
+            fields = np.frombuffer(data, dtype="<u4", count=slots + 1,
+                                   offset=offset + BLOCK_PREFIX.itemsize)
+            column_bytes, flags = fields[:len(schema)], int(fields[slots])
+            position = offset + BLOCK_HEADER_BYTES
+            for column, length in zip(schema, column_bytes):
+                buf = data[position:position + int(length)]
+                parts[column["name"].decode()].append(
+                    decode_column(buf, column["encoding"], records, header))
+                position += (int(length) + 7) & ~7
+            parts["cycle"].append(
+                np.full(records, block["cycle"], dtype=np.uint64))
+            parts["timestamp_ns"].append(
+                np.full(records, block["timestamp_ns"], dtype=np.uint64))
+            parts["keyframe"].append(
+                np.full(records, bool(flags & BLOCK_KEYFRAME), dtype=bool))
+        offset = end
+
+
+def write_csv(data, out):
+    incremental, labeled = data["incremental"], data["labeled"]
+    out.write(",".join(CSV_COLUMNS + ["keyframe"] * incremental +
+                       ["future_accesses"] * labeled) + "\n")
+    for i in range(len(data["cycle"])):
+        out.write("%d,%d,0x%x,%d,%f,%d,%d,%d,%d" % (
+            data["cycle"][i], data["timestamp_ns"][i], data["page_addr"][i],
+            data["current_tier"][i], data["heat_score"][i],
+            data["access_count"][i], data["read_count"][i],
+            data["write_count"][i], data["migration_count"][i]))
+        if incremental:
+            out.write(",%d" % data["keyframe"][i])
+        if labeled:
+            out.write(",%d" % data["future_accesses"][i])
+        out.write("\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[1])
+    parser.add_argument("path", help="ml_dataset_<label>.tmds")
+    parser.add_argument("--csv", metavar="OUT",
+                        help="convert to the CSV dataset format ('-': stdout)")
+    parser.add_argument("--cycles", nargs=2, type=int,
+                        metavar=("FIRST", "LAST"),
+                        help="only rows sampled in this cycle range")
+    args = parser.parse_args()
+
+    data = read_tmds(args.path, args.cycles)
+    if args.csv:
+        if args.csv == "-":
+            write_csv(data, sys.stdout)
+        else:
+            with open(args.csv, "w") as out:
+                write_csv(data, out)
+        return
+
+    rows = len(data["cycle"])
+    cycles = np.unique(data["cycle"])
+    print(f"{args.path}: {rows} rows, {len(cycles)} cycles, "
+          f"{len(np.unique(data['page_addr']))} distinct pages")
+    if data["incremental"]:
+        print(f"  incremental: {int(data['keyframe'].sum())} keyframe rows, "
+              f"{int((~data['keyframe']).sum())} change rows")
+    for cycle, regions in data["region_maps"]:
+        spans = ", ".join(f"0x{b:x}+{n}" for b, n in regions) or "none"
+        print(f"  regions from cycle {cycle}: {spans}")
+    if rows:
+        print(f"  heat mean {data['heat_score'].mean():.3f}  "
+              f"accesses {int(data['access_count'].sum())}  "
+              f"in NVM {np.mean(data['current_tier'] == 2):.1%}")
+    if data["labeled"] and rows:
+        print(f"  labeled: {np.mean(data['future_accesses'] > 0):.1%} of "
+              f"rows accessed again, mean "
+              f"{data['future_accesses'].mean():.2f} future accesses")
+
+
+if __name__ == "__main__":
+    main()